@@ -3,6 +3,12 @@
 
 #include <Arduino.h>
 
+// Hourly barograph samples exported by nodes (48 hours)
+#define BAROGRAPH_HOURS 48
+
+// Nodes the hub tracks at once (addresses 0x01-0xFE)
+#define MAX_NODES 32
+
 // Alarm modes
 enum AlarmMode {
   MODE_DISARMED = 0,
@@ -22,6 +28,39 @@ enum SystemState {
   STATE_ERROR = 5
 };
 
+// Node settings, in NodeConfig's blob order. Also the field IDs of the
+// remote config protocol, so existing values must never be renumbered.
+enum ConfigField : uint8_t {
+  CFG_NODE_ID,
+  CFG_HUB_ID,
+  CFG_NODE_NAME,
+  CFG_ALARM_MODE,
+  CFG_SENSITIVITY,
+  CFG_QUIET_ENABLED,
+  CFG_QUIET_START,
+  CFG_QUIET_END,
+  CFG_NEAR_ZONE,
+  CFG_MIDDLE_ZONE,
+  CFG_FAR_ZONE,
+  CFG_BRIGHTNESS,
+  CFG_DISPLAY_TIMEOUT,
+  CFG_TEMP_F,
+  CFG_LORA_FREQ,
+  CFG_LORA_POWER,
+  CFG_LORA_SF,
+  CFG_ENV_INTERVAL,
+  CFG_HB_INTERVAL,
+  CFG_FIELD_COUNT
+};
+
+// Detection event lifecycle: one ONSET per approach, rate-limited UPDATEs
+// while presence persists, one CLEAR when it ends
+enum DetectionPhase {
+  DETECTION_ONSET = 0,
+  DETECTION_UPDATE = 1,
+  DETECTION_CLEAR = 2
+};
+
 // Detection event structure
 struct DetectionEvent {
   bool detected;
@@ -31,6 +70,7 @@ struct DetectionEvent {
   unsigned long timestamp;
   unsigned long duration;    // milliseconds
   uint8_t eventType;         // 0x01=Approach, 0x02=Entry, 0x03=Doorbell
+  uint8_t phase;             // DetectionPhase
 };
 
 // Environmental data structure
@@ -47,6 +87,8 @@ struct EnvData {
 struct NodeInfo {
   uint8_t id;
   String name;
+  uint8_t capabilities;      // NODE_CAP_* bits from the node's announce
+  uint8_t fwVersion;
   unsigned long lastContact;
   float temperature;
   float humidity;
@@ -55,6 +97,8 @@ struct NodeInfo {
   int rssi;
   bool online;
   SystemState state;
+  uint16_t barograph[BAROGRAPH_HOURS]; // hourly hPa * 10, oldest first, 0 = gap
+  uint8_t barographCount;
 };
 
 // Alarm event structure
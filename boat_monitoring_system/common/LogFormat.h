@@ -0,0 +1,154 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * Binary log file layout (hub SD card, read back by tools/logtool)
+ *
+ * Plain stdint structs so the same header builds for the hub and the host.
+ * All fields are little-endian, which both the ESP32 and x86/ARM hosts are.
+ *
+ *   [file header, 512 B]
+ *   [block 0, 4096 B][block 1, 4096 B] ... [block N-1, may be partial]
+ *   [index: one LogIndexEntry per block] ... [LogIndexFooter]   (closed files)
+ *
+ * Files may be preallocated: slots never written are all zero, and a
+ * closed file keeps its footer in its last 16 bytes wherever the index ends.
+ *
+ * Blocks sit at fixed offsets, so block i is at LOG_FILE_HEADER_SIZE +
+ * i * LOG_BLOCK_SIZE. Each starts with a LogBlockHeader giving its time
+ * range and a bitmap of the node addresses it contains, followed by
+ * fixed-width 12-byte records. The index and footer are appended when the
+ * file is closed; a file cut short by power loss has no footer and readers
+ * fall back to walking the block headers. The last block of such a file is
+ * unsealed: its header count is not final, and its records run until the
+ * first empty (type 0) slot.
+ *
+ * Times are UTC seconds (seconds since boot if the hub has no clock); dt in
+ * each record is relative to the block's firstTime, so a block is sealed
+ * early if it would span more than 65535 s.
+ */
+
+#define LOG_FILE_MAGIC          "BOATLOG"
+#define LOG_FORMAT_VERSION      1
+#define LOG_FILE_HEADER_SIZE    512
+#define LOG_BLOCK_SIZE          4096
+#define LOG_BLOCK_MAGIC         0x4B4C4242UL   // "BBLK"
+#define LOG_INDEX_MAGIC         0x58444942UL   // "BIDX"
+
+// Record types (0 marks an empty slot)
+enum LogRecordType {
+  LOG_REC_EMPTY = 0,
+  LOG_REC_ENV = 1,
+  LOG_REC_DETECT = 2,
+  LOG_REC_ALARM = 3,
+  LOG_REC_EVENT = 4,
+  LOG_REC_TEXT_MORE = 5        // continues the text of the preceding record
+};
+
+// LogBlockHeader.flags
+#define LOG_BLOCK_SEALED        0x01
+
+struct LogFileHeader {
+  char magic[8];               // LOG_FILE_MAGIC, NUL padded
+  uint16_t version;
+  uint16_t headerSize;         // LOG_FILE_HEADER_SIZE
+  uint16_t blockSize;          // LOG_BLOCK_SIZE
+  uint8_t recordSize;          // sizeof(LogRecord)
+  uint8_t reserved0;
+  uint16_t boot;               // incremented each time the hub opens the file
+  uint16_t reserved1;
+  uint32_t reserved2;
+};
+
+struct LogBlockHeader {
+  uint32_t magic;              // LOG_BLOCK_MAGIC
+  uint32_t seq;                // block number within the file
+  uint32_t firstTime;
+  uint32_t lastTime;
+  uint16_t count;              // records, including text continuations
+  uint16_t boot;               // LogFileHeader.boot when the block was written
+  uint8_t flags;               // LOG_BLOCK_SEALED once complete
+  uint8_t typeMask;            // bit (1 << LogRecordType) per type present
+  uint16_t reserved0;
+  uint32_t reserved1[2];
+  uint32_t nodes[8];           // bit per 8-bit node address present
+};
+
+struct LogEnvFields {
+  int16_t tempC100;            // Celsius * 100
+  uint16_t pressure10;         // hPa * 10
+  uint16_t batteryMv;
+  uint8_t humidity2;           // percent * 2
+  int8_t rssi;                 // dBm
+};
+
+struct LogDetectFields {
+  uint8_t eventType;
+  uint8_t confidence;
+  uint16_t distance;           // cm
+  uint8_t zone;
+  uint8_t reserved[3];
+};
+
+// ALARM/EVENT text: length and the first 7 bytes, then LOG_REC_TEXT_MORE
+// records carrying 8 bytes each. A text never spans two blocks.
+struct LogTextFields {
+  uint8_t length;
+  char text[7];
+};
+
+struct LogRecord {
+  uint16_t dt;                 // seconds since LogBlockHeader.firstTime
+  uint8_t type;                // LogRecordType
+  uint8_t node;                // LoRa address; HUB_ADDRESS for hub events
+  union {
+    LogEnvFields env;
+    LogDetectFields detect;
+    LogTextFields text;
+    char more[8];
+  };
+};
+
+struct LogIndexEntry {
+  uint32_t firstTime;
+  uint32_t lastTime;
+  uint16_t count;
+  uint16_t boot;
+  uint8_t typeMask;
+  uint8_t flags;
+  uint16_t reserved;
+};
+
+// Last 16 bytes of a closed file
+struct LogIndexFooter {
+  uint32_t magic;              // LOG_INDEX_MAGIC
+  uint32_t blockCount;
+  uint32_t indexOffset;        // file offset of the first LogIndexEntry
+  uint32_t reserved;
+};
+
+#define LOG_TEXT_FIRST_BYTES    7
+#define LOG_TEXT_MORE_BYTES     8
+#define LOG_RECORDS_PER_BLOCK \
+  ((LOG_BLOCK_SIZE - sizeof(LogBlockHeader)) / sizeof(LogRecord))
+
+static_assert(sizeof(LogFileHeader) == 24, "LogFileHeader layout");
+static_assert(sizeof(LogBlockHeader) == 64, "LogBlockHeader layout");
+static_assert(sizeof(LogRecord) == 12, "LogRecord layout");
+static_assert(sizeof(LogIndexEntry) == 16, "LogIndexEntry layout");
+static_assert(sizeof(LogIndexFooter) == 16, "LogIndexFooter layout");
+
+// Records needed for a text of the given length
+inline uint16_t logTextRecords(uint16_t length) {
+  if (length <= LOG_TEXT_FIRST_BYTES) return 1;
+  return 1 + (length - LOG_TEXT_FIRST_BYTES + LOG_TEXT_MORE_BYTES - 1) /
+                 LOG_TEXT_MORE_BYTES;
+}
+
+inline uint32_t logBlockOffset(uint32_t seq) {
+  return LOG_FILE_HEADER_SIZE + seq * (uint32_t)LOG_BLOCK_SIZE;
+}
+
+#endif // LOG_FORMAT_H
@@ -2,12 +2,15 @@
 #define MESSAGE_PROTOCOL_H
 
 #include <Arduino.h>
+#include "CommonTypes.h"
 
 // LoRa Message Types
 #define MSG_TYPE_ENVIRONMENTAL  0x01
 #define MSG_TYPE_DETECTION      0x02
 #define MSG_TYPE_ALARM          0x03
 #define MSG_TYPE_HEARTBEAT      0x04
+#define MSG_TYPE_BAROGRAPH      0x05
+#define MSG_TYPE_ANNOUNCE       0x06
 #define MSG_TYPE_CONFIG         0x20
 #define MSG_TYPE_TIME_SYNC      0x21
 #define MSG_TYPE_WIND           0x22
@@ -24,6 +27,34 @@
 #define ALARM_PACKET_SIZE       6
 #define HEARTBEAT_PACKET_SIZE   5
 #define WIND_PACKET_SIZE        16
+#define BAROGRAPH_MAX_PACKET_SIZE 53
+#define ANNOUNCE_MAX_PACKET_SIZE  22
+#define ANNOUNCE_NAME_MAX         16
+#define CONFIG_MAX_PACKET_SIZE    48
+#define CONFIG_HEADER_SIZE        7
+#define CONFIG_ENTRIES_MAX        (CONFIG_MAX_PACKET_SIZE - CONFIG_HEADER_SIZE - 1)
+
+// Node capability bits (announce packet)
+#define NODE_CAP_ENV            0x01
+#define NODE_CAP_DETECTION      0x02
+#define NODE_CAP_DISPLAY        0x04
+#define NODE_CAP_BAROGRAPH      0x08
+#define NODE_CAP_WIND           0x10
+
+// Remote config operations (config packet byte 3)
+#define CONFIG_OP_QUERY         0x01  // hub -> node: report revision
+#define CONFIG_OP_SET           0x02  // hub -> node: apply entries to a revision
+#define CONFIG_OP_CONFIRM       0x03  // hub -> node: keep a radio change
+#define CONFIG_OP_ACK           0x04  // node -> hub: status and revision
+
+// Remote config status (config packet byte 6, ACK only)
+#define CONFIG_OK               0x00
+#define CONFIG_PENDING          0x01  // radio change applied, awaiting CONFIRM
+#define CONFIG_STALE            0x02  // base revision is not the node's
+#define CONFIG_BUSY             0x03  // another change is awaiting CONFIRM
+#define CONFIG_BAD_FIELD        0x04
+#define CONFIG_BAD_VALUE        0x05
+#define CONFIG_ROLLED_BACK      0x06  // no CONFIRM in time, old settings back
 
 // Helper functions for packing/unpacking data
 
@@ -113,7 +144,8 @@ inline bool unpackEnvironmentalPacket(uint8_t* packet, uint8_t* nodeID,
 // Detection event packet (8 bytes)
 // Byte 0:      Node ID
 // Byte 1:      Packet Type (0x02)
-// Byte 2:      Event Type (0x01=Approach, 0x02=Entry, 0x03=Doorbell)
+// Byte 2:      Bits 0-3 Event Type (0x01=Approach, 0x02=Entry, 0x03=Doorbell)
+//              Bits 4-5 Phase (0=Onset, 1=Update, 2=Clear)
 // Byte 3:      Confidence Level (0-100%)
 // Byte 4-5:    Distance (uint16, cm)
 // Byte 6:      Detection Zone (0=Near, 1=Middle, 2=Far)
@@ -121,10 +153,11 @@ inline bool unpackEnvironmentalPacket(uint8_t* packet, uint8_t* nodeID,
 
 inline void packDetectionPacket(uint8_t* packet, uint8_t nodeID,
                                uint8_t eventType, uint8_t confidence,
-                               uint16_t distance, uint8_t zone) {
+                               uint16_t distance, uint8_t zone,
+                               uint8_t phase = 0) {
   packet[0] = nodeID;
   packet[1] = MSG_TYPE_DETECTION;
-  packet[2] = eventType;
+  packet[2] = (eventType & 0x0F) | ((phase & 0x03) << 4);
   packet[3] = confidence;
   packUint16(packet, 4, distance);
   packet[6] = zone;
@@ -133,11 +166,13 @@ inline void packDetectionPacket(uint8_t* packet, uint8_t nodeID,
 
 inline bool unpackDetectionPacket(uint8_t* packet, uint8_t* nodeID,
                                  uint8_t* eventType, uint8_t* confidence,
-                                 uint16_t* distance, uint8_t* zone) {
+                                 uint16_t* distance, uint8_t* zone,
+                                 uint8_t* phase = nullptr) {
   if (!verifyChecksum(packet, DETECTION_PACKET_SIZE)) return false;
 
   *nodeID = packet[0];
-  *eventType = packet[2];
+  *eventType = packet[2] & 0x0F;
+  if (phase) *phase = (packet[2] >> 4) & 0x03;
   *confidence = packet[3];
   *distance = unpackUint16(packet, 4);
   *zone = packet[6];
@@ -194,6 +229,8 @@ inline bool unpackHeartbeatPacket(uint8_t* packet, uint8_t* nodeID, uint16_t* ba
   *nodeID = packet[0];
   *batteryMv = unpackUint16(packet, 2);
 
+  return true;
+}
 
 // Wind data packet (16 bytes)
 // Byte 0:      Node ID (0x05)
@@ -243,4 +280,281 @@ inline bool unpackWindPacket(uint8_t* packet, uint8_t* nodeID,
   return true;
 }
 
+// Barograph packet (variable, N + 5 bytes, N <= 48)
+// Byte 0:      Node ID
+// Byte 1:      Packet Type (0x05)
+// Byte 2:      Sample count N (hourly, oldest first)
+// Byte 3-4:    First sample (uint16, hPa * 10)
+// Byte 5..N+3: Change from previous sample (int8, hPa * 10; -128 = no data)
+// Byte N+4:    Checksum
+// Leading hours with no data are dropped.
+
+#define BAROGRAPH_GAP (-128)
+
+inline int packBarographPacket(uint8_t* packet, uint8_t nodeID,
+                               const uint16_t* samples, uint8_t count) {
+  while (count > 0 && samples[0] == 0) {
+    samples++;
+    count--;
+  }
+  if (count > BAROGRAPH_HOURS) {
+    samples += count - BAROGRAPH_HOURS;
+    count = BAROGRAPH_HOURS;
+  }
+  if (count == 0) return 0;
+
+  packet[0] = nodeID;
+  packet[1] = MSG_TYPE_BAROGRAPH;
+  packet[2] = count;
+  packUint16(packet, 3, samples[0]);
+
+  // Deltas are taken against the value the receiver will reconstruct, so
+  // clamping a jump never accumulates error
+  int32_t prev = samples[0];
+  for (uint8_t i = 1; i < count; i++) {
+    if (samples[i] == 0) {
+      packet[4 + i] = (uint8_t)(int8_t)BAROGRAPH_GAP;
+      continue;
+    }
+    int32_t delta = (int32_t)samples[i] - prev;
+    if (delta > 127) delta = 127;
+    if (delta < -127) delta = -127;
+    prev += delta;
+    packet[4 + i] = (uint8_t)(int8_t)delta;
+  }
+
+  int len = count + 5;
+  packet[len - 1] = calculateChecksum(packet, len - 1);
+  return len;
+}
+
+inline bool unpackBarographPacket(uint8_t* packet, uint8_t len, uint8_t* nodeID,
+                                  uint16_t* samples, uint8_t* count) {
+  if (len < 6 || len > BAROGRAPH_MAX_PACKET_SIZE) return false;
+  if (packet[2] + 5 != len) return false;
+  if (!verifyChecksum(packet, len)) return false;
+
+  *nodeID = packet[0];
+  *count = packet[2];
+
+  int32_t prev = unpackUint16(packet, 3);
+  samples[0] = prev;
+  for (uint8_t i = 1; i < *count; i++) {
+    int8_t delta = (int8_t)packet[4 + i];
+    if (delta == BAROGRAPH_GAP) {
+      samples[i] = 0;
+      continue;
+    }
+    prev += delta;
+    samples[i] = (uint16_t)prev;
+  }
+
+  return true;
+}
+
+// Announce / join packet (variable, N + 6 bytes, N <= 16)
+// Byte 0:      Node ID
+// Byte 1:      Packet Type (0x06)
+// Byte 2:      Capabilities (NODE_CAP_* bits)
+// Byte 3:      Firmware version (major << 4 | minor)
+// Byte 4:      Name length N
+// Byte 5..N+4: Name (ASCII, not terminated)
+// Byte N+5:    Checksum
+
+inline int packAnnouncePacket(uint8_t* packet, uint8_t nodeID,
+                              uint8_t capabilities, uint8_t fwVersion,
+                              const char* name) {
+  uint8_t n = 0;
+  while (name[n] && n < ANNOUNCE_NAME_MAX) n++;
+
+  packet[0] = nodeID;
+  packet[1] = MSG_TYPE_ANNOUNCE;
+  packet[2] = capabilities;
+  packet[3] = fwVersion;
+  packet[4] = n;
+  memcpy(packet + 5, name, n);
+
+  int len = n + 6;
+  packet[len - 1] = calculateChecksum(packet, len - 1);
+  return len;
+}
+
+// name must hold ANNOUNCE_NAME_MAX + 1 bytes
+inline bool unpackAnnouncePacket(uint8_t* packet, uint8_t len, uint8_t* nodeID,
+                                 uint8_t* capabilities, uint8_t* fwVersion,
+                                 char* name) {
+  if (len < 6 || len > ANNOUNCE_MAX_PACKET_SIZE) return false;
+  if (packet[4] + 6 != len) return false;
+  if (!verifyChecksum(packet, len)) return false;
+
+  *nodeID = packet[0];
+  *capabilities = packet[2];
+  *fwVersion = packet[3];
+  memcpy(name, packet + 5, packet[4]);
+  name[packet[4]] = '\0';
+
+  return true;
+}
+
+// Config packet (variable, N + 8 bytes, N <= 40)
+// Byte 0:      Sender (hub for QUERY/SET/CONFIRM, node for ACK)
+// Byte 1:      Packet Type (0x20)
+// Byte 2:      Target Node
+// Byte 3:      Operation (CONFIG_OP_*)
+// Byte 4-5:    Revision (uint16; SET: the node revision the entries apply
+//              to, CONFIRM: the revision to keep, ACK: the node's revision)
+// Byte 6:      Status (CONFIG_OK etc., ACK only)
+// Byte 7..N+6: Entries, each: field (ConfigField), length, value
+// Byte N+7:    Checksum
+// Values are big-endian like the rest of the protocol; floats go as their
+// IEEE-754 bits and text as ASCII, not terminated.
+
+enum ConfigValueType : uint8_t {
+  CFG_TYPE_U8,
+  CFG_TYPE_U16,
+  CFG_TYPE_U32,
+  CFG_TYPE_FLOAT,
+  CFG_TYPE_TEXT
+};
+
+struct ConfigFieldSpec {
+  const char* name;
+  uint8_t type;              // ConfigValueType
+};
+
+inline const ConfigFieldSpec& configFieldSpec(uint8_t field) {
+  static const ConfigFieldSpec specs[CFG_FIELD_COUNT] = {
+    { "nodeID",      CFG_TYPE_U8 },
+    { "hubID",       CFG_TYPE_U8 },
+    { "nodeName",    CFG_TYPE_TEXT },
+    { "alarmMode",   CFG_TYPE_U8 },
+    { "sensitivity", CFG_TYPE_U8 },
+    { "quietHours",  CFG_TYPE_U8 },
+    { "quietStart",  CFG_TYPE_U8 },
+    { "quietEnd",    CFG_TYPE_U8 },
+    { "nearZone",    CFG_TYPE_U16 },
+    { "middleZone",  CFG_TYPE_U16 },
+    { "farZone",     CFG_TYPE_U16 },
+    { "brightness",  CFG_TYPE_U8 },
+    { "dispTimeout", CFG_TYPE_U16 },
+    { "tempF",       CFG_TYPE_U8 },
+    { "loraFreq",    CFG_TYPE_FLOAT },
+    { "loraPower",   CFG_TYPE_U8 },
+    { "loraSF",      CFG_TYPE_U8 },
+    { "envInterval", CFG_TYPE_U32 },
+    { "hbInterval",  CFG_TYPE_U32 },
+  };
+  return specs[field < CFG_FIELD_COUNT ? field : 0];
+}
+
+// Returns CFG_FIELD_COUNT for an unknown name
+inline uint8_t configFieldByName(const char* name) {
+  for (uint8_t f = 0; f < CFG_FIELD_COUNT; f++) {
+    if (strcmp(configFieldSpec(f).name, name) == 0) return f;
+  }
+  return CFG_FIELD_COUNT;
+}
+
+// Bytes on the wire for a numeric type; 0 for text
+inline uint8_t configValueSize(uint8_t type) {
+  switch (type) {
+    case CFG_TYPE_U8: return 1;
+    case CFG_TYPE_U16: return 2;
+    case CFG_TYPE_U32:
+    case CFG_TYPE_FLOAT: return 4;
+    default: return 0;
+  }
+}
+
+// Append a numeric entry (a float's bits for CFG_TYPE_FLOAT). Returns the
+// new entries length, or -1 if it does not fit.
+inline int addConfigEntry(uint8_t* entries, int len, uint8_t field, uint32_t value) {
+  if (field >= CFG_FIELD_COUNT) return -1;
+  uint8_t size = configValueSize(configFieldSpec(field).type);
+  if (size == 0) return -1;
+  if (len + 2 + size > CONFIG_ENTRIES_MAX) return -1;
+
+  entries[len++] = field;
+  entries[len++] = size;
+  for (int8_t shift = (size - 1) * 8; shift >= 0; shift -= 8) {
+    entries[len++] = (value >> shift) & 0xFF;
+  }
+  return len;
+}
+
+inline int addConfigFloat(uint8_t* entries, int len, uint8_t field, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return addConfigEntry(entries, len, field, bits);
+}
+
+inline int addConfigText(uint8_t* entries, int len, uint8_t field, const char* text) {
+  uint8_t n = strlen(text);
+  if (field >= CFG_FIELD_COUNT || configFieldSpec(field).type != CFG_TYPE_TEXT) return -1;
+  if (len + 2 + n > CONFIG_ENTRIES_MAX) return -1;
+
+  entries[len++] = field;
+  entries[len++] = n;
+  memcpy(entries + len, text, n);
+  return len + n;
+}
+
+// Step through entries from *pos. Returns false at the end or at an entry
+// that runs past len; *pos == len afterwards means they were well formed.
+inline bool nextConfigEntry(const uint8_t* entries, uint8_t len, uint8_t* pos,
+                            uint8_t* field, uint8_t* size, const uint8_t** value) {
+  if (*pos + 2 > len) return false;
+  if (*pos + 2 + entries[*pos + 1] > len) return false;
+
+  *field = entries[*pos];
+  *size = entries[*pos + 1];
+  *value = entries + *pos + 2;
+  *pos += 2 + *size;
+  return true;
+}
+
+// Numeric value of an entry (size 1, 2 or 4)
+inline uint32_t configEntryValue(const uint8_t* value, uint8_t size) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < size; i++) v = (v << 8) | value[i];
+  return v;
+}
+
+inline int packConfigPacket(uint8_t* packet, uint8_t fromID, uint8_t targetNode,
+                            uint8_t op, uint16_t revision, uint8_t status,
+                            const uint8_t* entries, uint8_t entriesLen) {
+  if (entriesLen > CONFIG_ENTRIES_MAX) return 0;
+
+  packet[0] = fromID;
+  packet[1] = MSG_TYPE_CONFIG;
+  packet[2] = targetNode;
+  packet[3] = op;
+  packUint16(packet, 4, revision);
+  packet[6] = status;
+  if (entriesLen) memcpy(packet + CONFIG_HEADER_SIZE, entries, entriesLen);
+
+  int len = CONFIG_HEADER_SIZE + entriesLen + 1;
+  packet[len - 1] = calculateChecksum(packet, len - 1);
+  return len;
+}
+
+// *entries points into packet
+inline bool unpackConfigPacket(uint8_t* packet, uint8_t len, uint8_t* fromID,
+                               uint8_t* targetNode, uint8_t* op, uint16_t* revision,
+                               uint8_t* status, const uint8_t** entries,
+                               uint8_t* entriesLen) {
+  if (len < CONFIG_HEADER_SIZE + 1 || len > CONFIG_MAX_PACKET_SIZE) return false;
+  if (!verifyChecksum(packet, len)) return false;
+
+  *fromID = packet[0];
+  *targetNode = packet[2];
+  *op = packet[3];
+  *revision = unpackUint16(packet, 4);
+  *status = packet[6];
+  *entries = packet + CONFIG_HEADER_SIZE;
+  *entriesLen = len - CONFIG_HEADER_SIZE - 1;
+
+  return true;
+}
+
 #endif // MESSAGE_PROTOCOL_H
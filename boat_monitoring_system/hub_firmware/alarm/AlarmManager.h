@@ -2,10 +2,26 @@
 #define ALARM_MANAGER_H
 
 #include "../../common/CommonTypes.h"
+#include "DetectionCorrelator.h"
+#include "../../../lib/common/alarm_journal.h"
+
+#define ALARM_MODE_COUNT 5
+#define ALARM_TIMEOUT_MS 600000   // hard stop, whatever the alert rules say
 
 /**
  * Alarm State Manager for Hub
  * Coordinates alarm state across all nodes
+ *
+ * Detections go through a DetectionCorrelator. Each mode has a policy:
+ * PERIMETER needs a confirmed track (two adjacent nodes in sequence, or
+ * one node seeing the target close in), FULL also fires on a single very
+ * confident detection. QUIET only notifies, like DISARMED and DOORBELL:
+ * none of them raise the alarm from detections unless a policy is set
+ * for them with setPolicy().
+ *
+ * Every change of mode or triggered state is appended to a journal in NVS
+ * and restored by begin(), so a brown-out or watchdog reset during an
+ * intrusion comes back armed and sounding rather than disarmed.
  */
 class AlarmManager {
 private:
@@ -14,14 +30,41 @@ private:
   uint8_t triggeringNode;
   unsigned long alarmTime;
   String alarmPin;
+  DetectionCorrelator correlator;
+  CorrelationPolicy policies[ALARM_MODE_COUNT];
+  journal::Journal journal;
+
+  void record() {
+    journal.append(alarmTriggered, currentMode, triggeringNode);
+  }
 
 public:
   AlarmManager() : currentMode(MODE_DISARMED), alarmTriggered(false),
-                  triggeringNode(0), alarmTime(0), alarmPin("1234") {}
+                  triggeringNode(0), alarmTime(0), alarmPin("1234"),
+                  journal("alarm") {
+    memset(policies, 0, sizeof(policies));
+    policies[MODE_PERIMETER] = { 0, 150 };
+    policies[MODE_FULL] = { 95, 120 };
+  }
 
   void begin() {
     currentMode = MODE_DISARMED;
     alarmTriggered = false;
+
+    journal::Entry last;
+    if (journal.begin() && journal.latest(last) && last.mode < ALARM_MODE_COUNT) {
+      currentMode = (AlarmMode)last.mode;
+      alarmTriggered = last.state != 0;
+      triggeringNode = last.node;
+      alarmTime = millis();  // the alarm's age restarts with the hub
+
+      char buf[96];
+      snprintf(buf, sizeof(buf), "Alarm state restored in %luus: %s%s (#%lu)",
+               (unsigned long)journal.stats().restore_us,
+               alarmModeToString(currentMode), alarmTriggered ? ", TRIGGERED" : "",
+               (unsigned long)last.seq);
+      Serial.println(buf);
+    }
     Serial.println("Alarm Manager initialized");
   }
 
@@ -32,6 +75,8 @@ public:
     }
     currentMode = mode;
     alarmTriggered = false;
+    correlator.reset();
+    record();
   }
 
   void disarm() {
@@ -39,8 +84,39 @@ public:
     currentMode = MODE_DISARMED;
     alarmTriggered = false;
     triggeringNode = 0;
+    correlator.reset();
+    record();
   }
 
+  // Movement between these two nodes is possible (for correlation)
+  void setAdjacent(uint8_t a, uint8_t b) { correlator.setAdjacent(a, b); }
+
+  void setPolicy(AlarmMode mode, const CorrelationPolicy& policy) {
+    if (mode < ALARM_MODE_COUNT) policies[mode] = policy;
+  }
+
+  // Correlate a detection and trigger the alarm if the mode's policy says so
+  CorrelationResult onDetection(uint8_t nodeID, uint8_t confidence, uint8_t zone,
+                                uint8_t phase) {
+    const CorrelationPolicy& policy =
+        policies[currentMode < ALARM_MODE_COUNT ? currentMode : MODE_DISARMED];
+    CorrelationResult result =
+        correlator.evaluate(policy, nodeID, confidence, zone, phase, millis());
+    if (result == CORR_CONFIRMED || result == CORR_INSTANT) triggerAlarm(nodeID);
+    return result;
+  }
+
+  // The approach path that led to nodeID, e.g. "02>03>01"
+  void describeTrack(uint8_t nodeID, char* out, size_t outSize) const {
+    correlator.describePath(nodeID, out, outSize);
+  }
+
+  const DetectionCorrelator::Stats& getCorrelationStats() const {
+    return correlator.getStats();
+  }
+
+  const journal::Journal::Stats& getJournalStats() const { return journal.stats(); }
+
   void triggerAlarm(uint8_t nodeID) {
     if (currentMode == MODE_DISARMED) return; // Can't trigger when disarmed
 
@@ -50,6 +126,7 @@ public:
       alarmTriggered = true;
       triggeringNode = nodeID;
       alarmTime = millis();
+      record();
     }
   }
 
@@ -69,12 +146,16 @@ public:
     return alarmTriggered ? (millis() - alarmTime) / 1000 : 0;
   }
 
-  void process() {
-    // Auto-timeout after 10 minutes (optional safety feature)
-    if (alarmTriggered && (millis() - alarmTime) > 600000) {
+  // Auto-timeout after ALARM_TIMEOUT_MS. An alarm_age rule may reset the
+  // alarm sooner; this keeps it from latching if /rules.txt has none.
+  // Returns true when it disarmed.
+  bool process() {
+    if (alarmTriggered && millis() - alarmTime > ALARM_TIMEOUT_MS) {
       Serial.println("Alarm auto-timeout after 10 minutes");
       disarm();
+      return true;
     }
+    return false;
   }
 };
 
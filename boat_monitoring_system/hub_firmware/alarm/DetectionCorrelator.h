@@ -0,0 +1,210 @@
+#ifndef DETECTION_CORRELATOR_H
+#define DETECTION_CORRELATOR_H
+
+#include "../../common/CommonTypes.h"
+
+#define CORR_WINDOW_MS       30000   // how long a detection supports the next one
+#define CORR_MIN_STEP_MS     500     // a neighbour must have fired this much earlier
+#define CORR_APPROACH_BONUS  25      // same node, zone moved closer
+#define CORR_SCORE_MAX       1000
+#define CORR_PATH_MAX        6       // hops reported for a confirmed track
+#define CORR_NO_SLOT         0xFF
+
+enum CorrelationResult {
+  CORR_IGNORED = 0,      // mode does not act on detections, or a CLEAR
+  CORR_WATCHING = 1,     // scored, below the confirm threshold
+  CORR_CONFIRMED = 2,    // track score reached the confirm threshold
+  CORR_INSTANT = 3       // single detection above the instant threshold
+};
+
+// What a mode needs before it raises the alarm; 0 disables either path
+struct CorrelationPolicy {
+  uint8_t instantConfidence;   // one detection at or above this triggers
+  uint16_t confirmScore;       // track score that triggers
+};
+
+/**
+ * Detection correlation across nodes
+ *
+ * Nodes are placed on an adjacency graph along the ways someone can move
+ * around the boat (Foredeck - Cockpit - Companionway - Cabin). Every
+ * detection gets a score: its confidence weighted by zone (near counts
+ * fully, far half), plus the decayed score of the strongest track it
+ * continues. A track is continued by an adjacent node that fired between
+ * CORR_MIN_STEP_MS and CORR_WINDOW_MS earlier, or by the same node when
+ * the target has moved to a nearer zone. Detections on unrelated nodes,
+ * or repeats from one node that is not getting closer, do not add up, so
+ * a lone flapping sensor cannot confirm itself. Such a repeat keeps the
+ * better of the track's decayed score and its own, along with the path
+ * and the nearest zone reached so far, so it neither breaks an approach
+ * that is under way nor lets far/near flapping count as approaches.
+ *
+ * State is one entry per node slot (the node's latest detection), which
+ * doubles as the time window; per event the work is bounded by the
+ * node's neighbour count. Memory is fixed at MAX_NODES slots.
+ */
+class DetectionCorrelator {
+public:
+  struct Stats {
+    uint32_t events;
+    uint32_t chained;        // detections that continued a track
+    uint32_t confirmed;
+    uint32_t instant;
+  };
+
+private:
+  struct Track {
+    uint8_t nodeID;
+    uint8_t zone;
+    uint8_t prev;            // slot of the node the track came from
+    uint16_t score;
+    unsigned long time;
+  };
+
+  uint8_t slotOf[256];       // node ID -> slot
+  Track tracks[MAX_NODES];
+  uint32_t adjacent[MAX_NODES];  // neighbour slots as bits
+  uint8_t slotCount;
+  Stats stats;
+
+  uint8_t slotFor(uint8_t nodeID) {
+    if (slotOf[nodeID] != CORR_NO_SLOT) return slotOf[nodeID];
+    if (slotCount >= MAX_NODES) return CORR_NO_SLOT;
+
+    uint8_t slot = slotCount++;
+    slotOf[nodeID] = slot;
+    memset(&tracks[slot], 0, sizeof(Track));
+    tracks[slot].nodeID = nodeID;
+    tracks[slot].prev = CORR_NO_SLOT;
+    return slot;
+  }
+
+  // A track's score fades linearly to nothing over the window
+  static uint16_t decayed(const Track& t, unsigned long now) {
+    unsigned long age = now - t.time;
+    if (t.score == 0 || age >= CORR_WINDOW_MS) return 0;
+    return (uint32_t)t.score * (CORR_WINDOW_MS - age) / CORR_WINDOW_MS;
+  }
+
+  static uint16_t zoneWeighted(uint8_t confidence, uint8_t zone) {
+    static const uint8_t weight[] = {4, 3, 2};   // near, middle, far (quarters)
+    return (uint16_t)min(confidence, (uint8_t)100) * weight[zone < 3 ? zone : 2] / 4;
+  }
+
+public:
+  DetectionCorrelator() : slotCount(0) {
+    memset(slotOf, CORR_NO_SLOT, sizeof(slotOf));
+    memset(tracks, 0, sizeof(tracks));
+    memset(adjacent, 0, sizeof(adjacent));
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // Someone can walk directly between these two nodes
+  bool setAdjacent(uint8_t a, uint8_t b) {
+    uint8_t sa = slotFor(a), sb = slotFor(b);
+    if (sa == CORR_NO_SLOT || sb == CORR_NO_SLOT || sa == sb) return false;
+    adjacent[sa] |= 1UL << sb;
+    adjacent[sb] |= 1UL << sa;
+    return true;
+  }
+
+  // Score a detection and update the node's track. Returns the score.
+  uint16_t add(uint8_t nodeID, uint8_t confidence, uint8_t zone, unsigned long now) {
+    stats.events++;
+    uint16_t own = zoneWeighted(confidence, zone);
+    uint8_t slot = slotFor(nodeID);
+    if (slot == CORR_NO_SLOT) return own;
+
+    Track& t = tracks[slot];
+    uint16_t carry = 0;
+    uint8_t from = CORR_NO_SLOT;
+
+    // Same node: only an approach (nearer zone) continues the track
+    uint16_t self = decayed(t, now);
+    bool stepped = false;
+    if (self > 0 && zone < t.zone) {
+      carry = self + CORR_APPROACH_BONUS;
+      from = t.prev;
+      stepped = true;
+    }
+
+    // Neighbours that fired a little earlier
+    for (uint32_t bits = adjacent[slot]; bits; bits &= bits - 1) {
+      const Track& n = tracks[__builtin_ctz(bits)];
+      if (now - n.time < CORR_MIN_STEP_MS) continue;
+      uint16_t d = decayed(n, now);
+      if (d > carry) {
+        carry = d;
+        from = __builtin_ctz(bits);
+        stepped = true;
+      }
+    }
+
+    if (stepped) {
+      stats.chained++;
+      t.score = min((uint32_t)own + carry, (uint32_t)CORR_SCORE_MAX);
+      t.zone = zone;
+      t.prev = from;
+    } else if (self > 0) {
+      // A repeat that did not move closer: no gain, but the track stays
+      t.score = max(self, own);
+      t.zone = min(t.zone, zone);
+    } else {
+      t.score = own;
+      t.zone = zone;
+      t.prev = CORR_NO_SLOT;
+    }
+    t.time = now;
+    return t.score;
+  }
+
+  // Score the detection and apply a mode's policy
+  CorrelationResult evaluate(const CorrelationPolicy& policy, uint8_t nodeID,
+                             uint8_t confidence, uint8_t zone, uint8_t phase,
+                             unsigned long now) {
+    if (phase == DETECTION_CLEAR) return CORR_IGNORED;
+    uint16_t score = add(nodeID, confidence, zone, now);
+
+    if (policy.instantConfidence && confidence >= policy.instantConfidence) {
+      stats.instant++;
+      return CORR_INSTANT;
+    }
+    if (policy.confirmScore && score >= policy.confirmScore) {
+      stats.confirmed++;
+      return CORR_CONFIRMED;
+    }
+    return policy.confirmScore ? CORR_WATCHING : CORR_IGNORED;
+  }
+
+  // Node IDs of the track ending at nodeID, oldest first, as "02>03>01"
+  void describePath(uint8_t nodeID, char* out, size_t outSize) const {
+    uint8_t path[CORR_PATH_MAX];
+    uint8_t hops = 0;
+    uint8_t slot = slotOf[nodeID];
+    while (slot != CORR_NO_SLOT && hops < CORR_PATH_MAX) {
+      path[hops++] = tracks[slot].nodeID;
+      uint8_t prev = tracks[slot].prev;
+      // Stop at a link that was overwritten by a later detection
+      if (prev == CORR_NO_SLOT || tracks[prev].time > tracks[slot].time) break;
+      slot = prev;
+    }
+
+    size_t len = 0;
+    if (outSize) out[0] = '\0';
+    for (int8_t i = hops - 1; i >= 0 && len + 4 <= outSize; i--) {
+      len += snprintf(out + len, outSize - len, i ? "%02X>" : "%02X", path[i]);
+    }
+  }
+
+  // Forget all tracks (on arm/disarm); adjacency is kept
+  void reset() {
+    for (uint8_t i = 0; i < slotCount; i++) {
+      tracks[i].score = 0;
+      tracks[i].prev = CORR_NO_SLOT;
+    }
+  }
+
+  const Stats& getStats() const { return stats; }
+};
+
+#endif // DETECTION_CORRELATOR_H
@@ -0,0 +1,196 @@
+#ifndef RTC_CLOCK_H
+#define RTC_CLOCK_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define DS3231_ADDRESS      0x68
+#define RTC_SYNC_INTERVAL_MS 3600000UL   // re-read the DS3231 hourly
+
+/**
+ * Wall clock backed by a DS3231
+ *
+ * The DS3231 is read over I2C at begin() and on sync(); now() extrapolates
+ * from that reading with millis(), so it is cheap enough to stamp every log
+ * record and safe to call from any task. sync() and set() touch I2C and
+ * belong to the task that owns the bus (the Arduino loop).
+ *
+ * Times are UTC seconds since 1970. If the DS3231 is missing or reports an
+ * oscillator stop (battery lost), valid() is false and now() counts seconds
+ * since boot instead.
+ */
+class RtcClock {
+private:
+  TwoWire* wire;
+  bool present;
+  bool stopped;                // oscillator-stop flag seen; time unusable
+  bool timeValid;
+  uint32_t baseEpoch;          // epoch at baseMillis
+  unsigned long baseMillis;
+  unsigned long lastSync;
+  portMUX_TYPE lock;
+
+  static uint8_t bcd2bin(uint8_t v) { return (v >> 4) * 10 + (v & 0x0F); }
+  static uint8_t bin2bcd(uint8_t v) { return ((v / 10) << 4) | (v % 10); }
+
+  // Days since 1970-01-01 for a proleptic Gregorian date
+  static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+  }
+
+  bool readRegisters(uint8_t reg, uint8_t* buf, uint8_t len) {
+    wire->beginTransmission(DS3231_ADDRESS);
+    wire->write(reg);
+    if (wire->endTransmission(false) != 0) return false;
+    if (wire->requestFrom((uint8_t)DS3231_ADDRESS, len) != len) return false;
+    for (uint8_t i = 0; i < len; i++) buf[i] = wire->read();
+    return true;
+  }
+
+  bool readEpoch(uint32_t& epoch) {
+    uint8_t r[7];
+    if (!readRegisters(0x00, r, sizeof(r))) return false;
+
+    uint8_t sec = bcd2bin(r[0] & 0x7F);
+    uint8_t minute = bcd2bin(r[1] & 0x7F);
+    uint8_t hour = (r[2] & 0x40)   // 12-hour mode
+                     ? bcd2bin(r[2] & 0x1F) % 12 + ((r[2] & 0x20) ? 12 : 0)
+                     : bcd2bin(r[2] & 0x3F);
+    uint8_t day = bcd2bin(r[4] & 0x3F);
+    uint8_t month = bcd2bin(r[5] & 0x1F);
+    uint16_t year = 2000 + bcd2bin(r[6]) + ((r[5] & 0x80) ? 100 : 0);
+
+    epoch = (uint32_t)daysFromCivil(year, month, day) * 86400UL +
+            hour * 3600UL + minute * 60UL + sec;
+    return true;
+  }
+
+  void setBase(uint32_t epoch) {
+    portENTER_CRITICAL(&lock);
+    baseEpoch = epoch;
+    baseMillis = millis();
+    portEXIT_CRITICAL(&lock);
+  }
+
+public:
+  // UTC calendar date of an epoch time (inverse of daysFromCivil)
+  static void civil(uint32_t epoch, uint16_t& year, uint8_t& month, uint8_t& day) {
+    int32_t z = epoch / 86400 + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = yoe + era * 400 + (month <= 2);
+  }
+
+  RtcClock()
+    : wire(nullptr), present(false), stopped(false), timeValid(false),
+      baseEpoch(0), baseMillis(0), lastSync(0) {
+    lock = portMUX_INITIALIZER_UNLOCKED;
+  }
+
+  // Call after Wire.begin(). Returns true if the DS3231 holds a valid time.
+  bool begin(TwoWire& w = Wire) {
+    wire = &w;
+
+    uint8_t status;
+    present = readRegisters(0x0F, &status, 1);
+    if (!present) {
+      Serial.println("DS3231 not found - log times are seconds since boot");
+      return false;
+    }
+
+    // OSF: the oscillator stopped at some point, so the time is garbage
+    if (status & 0x80) {
+      stopped = true;
+      Serial.println("DS3231 lost power - set the clock with: time <epoch>");
+      return false;
+    }
+
+    return sync();
+  }
+
+  // Re-read the DS3231 to cancel millis() drift
+  bool sync() {
+    lastSync = millis();
+    uint32_t epoch;
+    if (!present || stopped || !readEpoch(epoch)) return false;
+    setBase(epoch);
+    timeValid = true;
+    return true;
+  }
+
+  // Call from the I2C owner's loop; syncs every RTC_SYNC_INTERVAL_MS.
+  // Without a DS3231 the base is still advanced so millis() wrapping
+  // (every 49.7 days) does not step the clock back.
+  void process() {
+    if (millis() - lastSync < RTC_SYNC_INTERVAL_MS) return;
+    if (!sync()) {
+      portENTER_CRITICAL(&lock);
+      unsigned long secs = (millis() - baseMillis) / 1000;
+      baseEpoch += secs;
+      baseMillis += secs * 1000;
+      portEXIT_CRITICAL(&lock);
+    }
+  }
+
+  // Set the DS3231 (UTC epoch seconds) and clear the oscillator-stop flag
+  bool set(uint32_t epoch) {
+    if (!present) return false;
+
+    uint32_t days = epoch / 86400;
+    uint32_t secs = epoch % 86400;
+
+    uint16_t year;
+    uint8_t month, day;
+    civil(epoch, year, month, day);
+    if (year < 2000 || year > 2199) return false;
+
+    uint8_t yy = year % 100;
+    wire->beginTransmission(DS3231_ADDRESS);
+    wire->write(0x00);
+    wire->write(bin2bcd(secs % 60));
+    wire->write(bin2bcd((secs / 60) % 60));
+    wire->write(bin2bcd(secs / 3600));           // 24-hour mode
+    wire->write(bin2bcd((days + 4) % 7 + 1));    // 1970-01-01 was a Thursday
+    wire->write(bin2bcd(day));
+    wire->write(bin2bcd(month) | (year >= 2100 ? 0x80 : 0));
+    wire->write(bin2bcd(yy));
+    if (wire->endTransmission() != 0) return false;
+
+    uint8_t status;
+    if (readRegisters(0x0F, &status, 1)) {
+      wire->beginTransmission(DS3231_ADDRESS);
+      wire->write(0x0F);
+      wire->write(status & ~0x80);
+      wire->endTransmission();
+    }
+
+    setBase(epoch);
+    stopped = false;
+    timeValid = true;
+    return true;
+  }
+
+  // UTC seconds (or seconds since boot when !valid())
+  uint32_t now() {
+    portENTER_CRITICAL(&lock);
+    uint32_t epoch = baseEpoch;
+    unsigned long since = millis() - baseMillis;
+    portEXIT_CRITICAL(&lock);
+    return epoch + since / 1000;
+  }
+
+  bool valid() const { return timeValid; }
+  bool isPresent() const { return present; }
+};
+
+#endif // RTC_CLOCK_H
@@ -4,20 +4,85 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ILI9488.h>
 #include "../../common/CommonTypes.h"
+#include "../history/TrendStore.h"
+#include "../spi/SpiArbiter.h"
 
 #define MAX_DISPLAY_NODES 6
 
+// ILI9488 SPI cost: an address window (CASET/PASET/RAMWR with their
+// parameters) per primitive, then 18-bit pixels sent as 3 bytes
+#define TFT_WINDOW_BYTES     11
+#define TFT_BYTES_PER_PIXEL  3
+
+/**
+ * ILI9488 driver that counts the bytes it sends. Every GFX drawing call
+ * ends up in one of these primitives, so the count covers text and lines.
+ *
+ * Each primitive is a complete SPI transaction, so the bus can be handed
+ * to the radio after any of them; large fills are split into bands of at
+ * most SPI_TFT_CHUNK_PIXELS for the same reason.
+ */
+class MeteredILI9488 : public Adafruit_ILI9488 {
+  SpiArbiter& spi;
+
+public:
+  uint32_t bytes;
+
+  MeteredILI9488(uint8_t cs, uint8_t dc, uint8_t rst, SpiArbiter& arbiter)
+    : Adafruit_ILI9488(cs, dc, rst), spi(arbiter), bytes(0) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    bytes += TFT_WINDOW_BYTES + TFT_BYTES_PER_PIXEL;
+    Adafruit_ILI9488::drawPixel(x, y, color);
+    spi.yieldToRadio();
+  }
+
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override {
+    bytes += TFT_WINDOW_BYTES + (uint32_t)w * TFT_BYTES_PER_PIXEL;
+    Adafruit_ILI9488::drawFastHLine(x, y, w, color);
+    spi.yieldToRadio();
+  }
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override {
+    bytes += TFT_WINDOW_BYTES + (uint32_t)h * TFT_BYTES_PER_PIXEL;
+    Adafruit_ILI9488::drawFastVLine(x, y, h, color);
+    spi.yieldToRadio();
+  }
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+    if (w <= 0 || h <= 0) return;
+    int16_t band = max(1, SPI_TFT_CHUNK_PIXELS / w);
+    for (int16_t row = 0; row < h; row += band) {
+      int16_t rows = min(band, (int16_t)(h - row));
+      bytes += TFT_WINDOW_BYTES + (uint32_t)w * rows * TFT_BYTES_PER_PIXEL;
+      Adafruit_ILI9488::fillRect(x, y + row, w, rows, color);
+      spi.yieldToRadio();
+    }
+  }
+};
+
 /**
  * Hub Display Manager
  * Manages larger TFT display showing all nodes and system status
+ *
+ * Retained mode: the header, each node tile and the alarm banner remember
+ * the values they last drew and repaint only their own box (or a row of a
+ * tile) when one changes. The screen is cleared only at startup, so an
+ * idle screen sends nothing over the SPI bus shared with the radio and SD.
  */
 class HubDisplay {
 private:
-  Adafruit_ILI9488* tft;
+  MeteredILI9488* tft;
   uint8_t csPin, dcPin, rstPin;
+  TrendStore* trends;          // barograph fallback for nodes without one
+  uint32_t trendNow;
 
   static const int WIDTH = 480;
   static const int HEIGHT = 320;
+  static const int HEADER_H = 30;
+  static const int TILE_W = 140;
+  static const int TILE_H = 70;
+  static const int BANNER_H = 60;
 
   static const uint16_t COLOR_BG = 0x0000;
   static const uint16_t COLOR_TEXT = 0xFFFF;
@@ -25,10 +90,63 @@ private:
   static const uint16_t COLOR_ALARM = 0xF800;
   static const uint16_t COLOR_OK = 0x07E0;
 
+  static const int16_t UNSET = -32768;
+
+  // What a node tile currently shows
+  struct TileCache {
+    bool drawn;                // false forces a full tile repaint
+    uint8_t id;
+    bool online;
+    String name;
+    int16_t temp10;            // 0.1 C, as printed
+    int16_t humidity;
+    int16_t pressure;
+    int16_t battery100;        // 0.1 V, as printed
+    int16_t rssi;
+    uint32_t traceHash;
+  };
+
+  TileCache tiles[MAX_DISPLAY_NODES];
+  bool screenReady;            // false until the first full clear
+  bool screenBlank;            // cleared this frame; tiles need no erase
+  bool headerDrawn;
+  AlarmMode headerMode;
+  bool headerAlarm;
+  bool bannerShown;
+  String bannerNode;
+
 public:
-  HubDisplay(uint8_t cs, uint8_t dc, uint8_t rst)
-    : csPin(cs), dcPin(dc), rstPin(rst) {
-    tft = new Adafruit_ILI9488(cs, dc, rst);
+  struct Stats {
+    uint32_t bytesPushed;      // SPI bytes sent to the panel
+    uint32_t repaints;         // widget boxes repainted
+    uint32_t frames;           // drawMainScreen calls
+    uint32_t frameMaxUs;
+  };
+
+private:
+  Stats stats;
+
+  // Erase a widget box before redrawing it; `blank` skips the fill when
+  // the area was just cleared
+  void repaint(int x, int y, int w, int h, uint16_t color = COLOR_BG, bool blank = false) {
+    if (!blank) tft->fillRect(x, y, w, h, color);
+    stats.repaints++;
+  }
+
+  void invalidate() {
+    for (uint8_t i = 0; i < MAX_DISPLAY_NODES; i++) tiles[i].drawn = false;
+    headerDrawn = false;
+    bannerShown = false;
+  }
+
+public:
+  HubDisplay(uint8_t cs, uint8_t dc, uint8_t rst, SpiArbiter& spi)
+    : csPin(cs), dcPin(dc), rstPin(rst), trends(nullptr), trendNow(0),
+      screenReady(false), screenBlank(false), headerDrawn(false), headerMode(MODE_DISARMED),
+      headerAlarm(false), bannerShown(false) {
+    tft = new MeteredILI9488(cs, dc, rst, spi);
+    memset(&stats, 0, sizeof(stats));
+    invalidate();
   }
 
   ~HubDisplay() {
@@ -54,28 +172,35 @@ public:
     tft->setCursor(100, 160);
     tft->println("Boat Monitor Hub");
     delay(2000);
+    screenReady = false;       // next drawMainScreen starts from a clear screen
   }
 
-  void drawMainScreen(NodeInfo* nodes, int nodeCount, AlarmMode mode, bool alarmActive) {
-    tft->fillScreen(COLOR_BG);
+  // `history` (optional) supplies hourly pressure for nodes that do not
+  // send their own barograph; `now` is the time the samples were stamped with
+  void drawMainScreen(NodeInfo* nodes, int nodeCount, AlarmMode mode, bool alarmActive,
+                      TrendStore* history = nullptr, uint32_t now = 0) {
+    unsigned long start = micros();
+    trends = history;
+    trendNow = now;
 
-    // Header
-    tft->fillRect(0, 0, WIDTH, 30, COLOR_HEADER);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(2);
-    tft->setCursor(10, 8);
-    tft->print("LIBERTY - ");
-    tft->print(alarmModeToString(mode));
-
-    // Alarm indicator
-    if (alarmActive) {
-      tft->fillCircle(WIDTH - 20, 15, 10, COLOR_ALARM);
+    if (!screenReady) {
+      tft->fillScreen(COLOR_BG);
+      invalidate();
+      screenReady = true;
+      screenBlank = true;
     }
 
+    drawHeader(mode, alarmActive);
+
     // Node status grid
     int x = 10, y = 50;
-    for (int i = 0; i < nodeCount && i < MAX_DISPLAY_NODES; i++) {
-      drawNodeStatus(&nodes[i], x, y);
+    for (int i = 0; i < MAX_DISPLAY_NODES; i++) {
+      if (i < nodeCount) {
+        drawNodeStatus(&nodes[i], tiles[i], x, y);
+      } else if (tiles[i].drawn) {
+        repaint(x, y, TILE_W, TILE_H);   // node removed
+        tiles[i].drawn = false;
+      }
 
       x += 150;
       if (x > WIDTH - 150) {
@@ -83,53 +208,207 @@ public:
         y += 80;
       }
     }
+
+    screenBlank = false;
+    stats.frames++;
+    uint32_t us = micros() - start;
+    if (us > stats.frameMaxUs) stats.frameMaxUs = us;
+    stats.bytesPushed = tft->bytes;
   }
 
   void showAlarm(const char* triggeringNode) {
-    tft->fillRect(0, HEIGHT - 60, WIDTH, 60, COLOR_ALARM);
+    if (bannerShown && bannerNode == triggeringNode) return;
+
+    repaint(0, HEIGHT - BANNER_H, WIDTH, BANNER_H, COLOR_ALARM);
     tft->setTextColor(COLOR_TEXT);
     tft->setTextSize(3);
     tft->setCursor(20, HEIGHT - 45);
     tft->print("ALARM: ");
     tft->println(triggeringNode);
+    bannerShown = true;
+    bannerNode = triggeringNode;
+    stats.bytesPushed = tft->bytes;
+  }
+
+  void hideAlarm() {
+    if (!bannerShown) return;
+    repaint(0, HEIGHT - BANNER_H, WIDTH, BANNER_H);
+    bannerShown = false;
+    stats.bytesPushed = tft->bytes;
   }
 
+  const Stats& getStats() const { return stats; }
+
 private:
-  void drawNodeStatus(NodeInfo* node, int x, int y) {
-    // Draw node box
-    uint16_t boxColor = node->online ? 0x18C3 : 0x7BEF;
-    tft->drawRect(x, y, 140, 70, boxColor);
+  void drawHeader(AlarmMode mode, bool alarmActive) {
+    if (!headerDrawn || mode != headerMode) {
+      repaint(0, 0, WIDTH, HEADER_H, COLOR_HEADER);
+      tft->setTextColor(COLOR_TEXT);
+      tft->setTextSize(2);
+      tft->setCursor(10, 8);
+      tft->print("LIBERTY - ");
+      tft->print(alarmModeToString(mode));
+      headerDrawn = true;
+      headerMode = mode;
+      headerAlarm = !alarmActive;  // header fill erased the indicator
+    }
+
+    // Alarm indicator
+    if (alarmActive != headerAlarm) {
+      repaint(WIDTH - 32, 3, 24, 24, COLOR_HEADER);
+      if (alarmActive) {
+        tft->fillCircle(WIDTH - 20, 15, 10, COLOR_ALARM);
+      }
+      headerAlarm = alarmActive;
+    }
+  }
+
+  // Hourly hPa * 10 for the barograph: the node's own trace if it sends
+  // one, else the hub's hourly means. Returns the number of hours.
+  uint8_t barographTrace(NodeInfo* node, uint16_t* trace) {
+    if (node->barographCount >= 2 || !trends || trendNow < 3600UL * BAROGRAPH_HOURS) {
+      memcpy(trace, node->barograph, node->barographCount * sizeof(uint16_t));
+      return node->barographCount;
+    }
+
+    TrendPoint pts[BAROGRAPH_HOURS];
+    uint32_t from = (trendNow / 3600 - (BAROGRAPH_HOURS - 1)) * 3600;
+    uint16_t n = trends->query(node->id, TREND_PRESSURE, TREND_HOUR,
+                               from, trendNow, pts, BAROGRAPH_HOURS);
+    memset(trace, 0, BAROGRAPH_HOURS * sizeof(uint16_t));
+    for (uint16_t i = 0; i < n; i++) {
+      trace[(pts[i].time - from) / 3600] = (uint16_t)lroundf(pts[i].mean * 10);
+    }
+    return n ? BAROGRAPH_HOURS : 0;
+  }
+
+  static uint32_t traceHash(const uint16_t* trace, uint8_t count) {
+    uint32_t h = 2166136261UL ^ count;   // FNV-1a
+    for (uint8_t i = 0; i < count; i++) {
+      h = (h ^ (trace[i] & 0xFF)) * 16777619UL;
+      h = (h ^ (trace[i] >> 8)) * 16777619UL;
+    }
+    return h;
+  }
+
+  // 48-hour pressure trace, scaled to the node's own min/max
+  void drawBarograph(const uint16_t* trace, uint8_t count, int x, int y, int w, int h) {
+    if (count < 2) return;
+
+    uint16_t lo = 0xFFFF, hi = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      uint16_t v = trace[i];
+      if (!v) continue;
+      if (v < lo) lo = v;
+      if (v > hi) hi = v;
+    }
+    if (hi == 0) return;
+    uint16_t span = hi - lo < 20 ? 20 : hi - lo; // at least 2 hPa tall
+
+    // Newest hour at the right edge
+    int offset = BAROGRAPH_HOURS - count;
+    int prevX = -1, prevY = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      uint16_t v = trace[i];
+      if (!v) { prevX = -1; continue; }
+      int px = x + (int)(i + offset) * (w - 1) / (BAROGRAPH_HOURS - 1);
+      int py = y + h - 1 - (int)(v - lo) * (h - 1) / span;
+      if (prevX >= 0) {
+        tft->drawLine(prevX, prevY, px, py, COLOR_HEADER);
+      }
+      prevX = px;
+      prevY = py;
+    }
+  }
 
-    // Node name
+  // Node name and status indicator
+  void drawTitle(NodeInfo* node, int x, int y) {
     tft->setTextSize(1);
     tft->setTextColor(COLOR_TEXT);
     tft->setCursor(x + 5, y + 5);
     tft->println(node->name);
 
-    // Status indicator
     uint16_t statusColor = node->online ? COLOR_OK : 0x7BEF;
     tft->fillCircle(x + 130, y + 10, 5, statusColor);
+  }
+
+  void drawNodeStatus(NodeInfo* node, TileCache& c, int x, int y) {
+    // Whole tile when it is new, shows another node, or goes on/offline
+    bool blank = false;
+    if (!c.drawn || c.id != node->id || c.online != node->online) {
+      repaint(x, y, TILE_W, TILE_H, COLOR_BG, screenBlank);
+      blank = true;
 
-    // Environmental data (if online)
-    if (node->online) {
+      // Draw node box
+      uint16_t boxColor = node->online ? 0x18C3 : 0x7BEF;
+      tft->drawRect(x, y, TILE_W, TILE_H, boxColor);
+
+      c.drawn = true;
+      c.id = node->id;
+      c.online = node->online;
+      c.name = node->name;
+      drawTitle(node, x, y);
+
+      if (!node->online) {
+        tft->setCursor(x + 5, y + 35);
+        tft->println("OFFLINE");
+      }
+
+      c.temp10 = c.humidity = c.pressure = c.battery100 = c.rssi = UNSET;
+      c.traceHash = 0;
+    }
+
+    // Renamed by an announce
+    if (c.name != node->name) {
+      repaint(x + 1, y + 1, TILE_W - 2, 16);
+      drawTitle(node, x, y);
+      c.name = node->name;
+    }
+
+    if (!node->online) return;
+
+    // Environmental data, one row at a time
+    int16_t temp10 = (int16_t)lroundf(node->temperature * 10);
+    int16_t humidity = (int16_t)node->humidity;
+    if (temp10 != c.temp10 || humidity != c.humidity) {
+      repaint(x + 1, y + 19, 68, 10, COLOR_BG, blank);
       tft->setCursor(x + 5, y + 20);
       tft->print(node->temperature, 1);
       tft->print("C ");
       tft->print((int)node->humidity);
       tft->println("%");
+      c.temp10 = temp10;
+      c.humidity = humidity;
+    }
 
+    int16_t pressure = (int16_t)node->pressure;
+    if (pressure != c.pressure) {
+      repaint(x + 1, y + 34, 68, 10, COLOR_BG, blank);
       tft->setCursor(x + 5, y + 35);
       tft->print((int)node->pressure);
       tft->println(" hPa");
+      c.pressure = pressure;
+    }
+
+    uint16_t trace[BAROGRAPH_HOURS];
+    uint8_t count = barographTrace(node, trace);
+    uint32_t hash = traceHash(trace, count);
+    if (hash != c.traceHash) {
+      repaint(x + 70, y + 20, 62, 24, COLOR_BG, blank);
+      drawBarograph(trace, count, x + 70, y + 20, 62, 24);
+      c.traceHash = hash;
+    }
 
+    int16_t battery100 = (int16_t)((node->batteryVoltage + 50) / 100);
+    if (battery100 != c.battery100 || node->rssi != c.rssi) {
+      repaint(x + 1, y + 49, TILE_W - 2, 10, COLOR_BG, blank);
       tft->setCursor(x + 5, y + 50);
       tft->print(node->batteryVoltage / 1000.0, 1);
       tft->print("V ");
       tft->print(node->rssi);
       tft->println("dBm");
-    } else {
-      tft->setCursor(x + 5, y + 35);
-      tft->println("OFFLINE");
+      c.battery100 = battery100;
+      c.rssi = node->rssi;
     }
   }
 };
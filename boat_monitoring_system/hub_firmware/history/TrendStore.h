@@ -0,0 +1,447 @@
+#ifndef TREND_STORE_H
+#define TREND_STORE_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include "../../common/CommonTypes.h"
+#include "../../common/LogFormat.h"
+#include "../storage/LogReader.h"
+#include "../storage/DataLogger.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+// Retention per resolution
+#define TREND_MINUTES           1440   // 1-minute buckets: 24 hours
+#define TREND_HOURS             720    // 1-hour buckets: 30 days
+#define TREND_DAYS              365    // 1-day buckets: 1 year
+
+// Shorter retention for boards without PSRAM, kept in internal RAM
+// (about 7 KB per node); the hourly ring still covers the barograph
+#define TREND_SMALL_MINUTES     60
+#define TREND_SMALL_HOURS       BAROGRAPH_HOURS
+#define TREND_SMALL_DAYS        14
+#define TREND_INTERNAL_RESERVE  (48 * 1024)  // internal heap left for everything else
+#define TREND_REHYDRATE_DAYS    30     // log history replayed at boot
+#define TREND_REHYDRATE_FILES   64
+#define TREND_REHYDRATE_BLOCKS  2      // log blocks replayed per loop pass
+
+enum TrendMetric {
+  TREND_TEMPERATURE = 0,       // Celsius
+  TREND_HUMIDITY = 1,          // percent
+  TREND_PRESSURE = 2,          // hPa
+  TREND_BATTERY = 3,           // volts
+  TREND_RSSI = 4,              // dBm
+  TREND_METRICS = 5
+};
+
+enum TrendResolution {
+  TREND_MINUTE = 0,
+  TREND_HOUR = 1,
+  TREND_DAY = 2,
+  TREND_RESOLUTIONS = 3
+};
+
+// One rollup bucket as returned by query()
+struct TrendPoint {
+  uint32_t time;               // bucket start (seconds, same clock as the log)
+  float min;
+  float max;
+  float mean;
+  uint16_t count;
+};
+
+/**
+ * Hub Trend Store - per-node environmental history
+ *
+ * Every ENV sample updates min/max/sum/count rollups at 1-minute, 1-hour
+ * and 1-day resolution for each metric. Each resolution is a ring indexed
+ * by bucket number (time / period) modulo its length, so an update touches
+ * exactly one bucket per resolution; buckets skipped over by a gap are
+ * cleared as the ring head moves past them. Values are stored in the same
+ * fixed-point units as the binary log (12-byte buckets).
+ *
+ * Node histories are allocated in PSRAM on a node's first sample (about
+ * 150 KB each with the default retention). Boards without PSRAM get the
+ * TREND_SMALL_* rings in internal RAM instead, for as many nodes as fit
+ * above TREND_INTERNAL_RESERVE. Once the clock is set, beginRehydrate()
+ * and rehydrateStep() replay the last TREND_REHYDRATE_DAYS of SD logs a few
+ * blocks at a time, alongside live samples.
+ *
+ * Not thread-safe: add and query from the loop task only.
+ */
+class TrendStore {
+private:
+  static const uint8_t NO_SLOT = 0xFF;
+
+  struct Bucket {
+    int32_t sum;
+    int16_t min;
+    int16_t max;
+    uint16_t count;
+  };
+
+  struct Series {
+    uint8_t id;
+    uint8_t primed;                        // bit per resolution with a head
+    uint32_t head[TREND_RESOLUTIONS];      // newest bucket number
+    Bucket* buckets;                       // [resolution][metric][ring slot]
+  };
+
+  // Boot replay of the SD logs, a few blocks per rehydrateStep()
+  struct Replay {
+    char names[TREND_REHYDRATE_FILES][20];  // oldest first
+    uint8_t files;
+    uint8_t file;                          // next or current file
+    bool open;
+    uint32_t block;                        // next block in it
+    uint32_t from;                         // window start
+    uint32_t until;                        // first time added live
+    LogReader reader;
+  };
+
+  Series series[MAX_NODES];
+  uint16_t lengths[TREND_RESOLUTIONS];     // ring lengths, fixed at first use
+  bool sized;
+  bool internal;                           // no PSRAM: small rings in internal RAM
+  uint8_t count;
+  uint8_t slotOf[256];
+  uint32_t samples;
+  uint32_t dropped;                        // too old, or out of memory
+  Replay* replay;                          // on the heap while replaying
+  uint32_t replayed;                       // samples taken from the SD logs
+
+  uint16_t ringLength(uint8_t res) const { return lengths[res]; }
+
+  // Pick the ring lengths before the first node is allocated
+  void chooseMemory() {
+    static const uint16_t small[TREND_RESOLUTIONS] = {
+      TREND_SMALL_MINUTES, TREND_SMALL_HOURS, TREND_SMALL_DAYS
+    };
+#if defined(ESP_PLATFORM)
+    internal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) == 0;
+#endif
+    if (internal) {
+      memcpy(lengths, small, sizeof(lengths));
+      Serial.println("Trend store: no PSRAM, keeping a short history in internal RAM");
+    }
+    sized = true;
+  }
+
+  static uint32_t period(uint8_t res) {
+    static const uint32_t periods[TREND_RESOLUTIONS] = { 60, 3600, 86400 };
+    return periods[res];
+  }
+
+  // Offset of a resolution's first bucket within a node's allocation
+  uint32_t ringBase(uint8_t res) const {
+    uint32_t base = 0;
+    for (uint8_t r = 0; r < res; r++) base += ringLength(r) * TREND_METRICS;
+    return base;
+  }
+
+  uint32_t bucketsPerNode() const { return ringBase(TREND_RESOLUTIONS); }
+
+  // Stored units -> display units
+  static float scale(uint8_t metric) {
+    static const float scales[TREND_METRICS] = { 0.01f, 0.5f, 0.1f, 0.001f, 1.0f };
+    return scales[metric];
+  }
+
+  Bucket& bucket(Series& s, uint8_t res, uint8_t metric, uint32_t number) {
+    uint16_t len = ringLength(res);
+    return s.buckets[ringBase(res) + metric * len + number % len];
+  }
+
+  Series* seriesFor(uint8_t id, bool create) {
+    if (slotOf[id] != NO_SLOT) return &series[slotOf[id]];
+    if (!create || count >= MAX_NODES) return nullptr;
+
+    if (!sized) chooseMemory();
+    size_t bytes = bytesPerNode();
+#if defined(ESP_PLATFORM)
+    Bucket* mem = nullptr;
+    if (!internal) {
+      mem = (Bucket*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    } else if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL) >= bytes + TREND_INTERNAL_RESERVE) {
+      mem = (Bucket*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+#else
+    Bucket* mem = (Bucket*)malloc(bytes);
+#endif
+    if (!mem) {
+      if (dropped == 0) Serial.println("Trend store: out of memory for node history");
+      return nullptr;
+    }
+
+    Series& s = series[count];
+    s.id = id;
+    s.primed = 0;
+    memset(s.head, 0, sizeof(s.head));
+    s.buckets = mem;
+    slotOf[id] = count++;
+    return &s;
+  }
+
+  // Move a ring's head forward to `number`, clearing every slot passed.
+  // Returns false if `number` has already fallen out of the ring.
+  bool advance(Series& s, uint8_t res, uint32_t number) {
+    uint16_t len = ringLength(res);
+    uint8_t bit = 1 << res;
+
+    if (!(s.primed & bit) || number >= s.head[res] + len) {
+      // First sample, or a gap longer than the ring: start over
+      memset(&s.buckets[ringBase(res)], 0, len * TREND_METRICS * sizeof(Bucket));
+      s.head[res] = number;
+      s.primed |= bit;
+      return true;
+    }
+    if (number + len <= s.head[res]) return false;
+
+    while (s.head[res] < number) {
+      s.head[res]++;
+      for (uint8_t m = 0; m < TREND_METRICS; m++) {
+        memset(&bucket(s, res, m, s.head[res]), 0, sizeof(Bucket));
+      }
+    }
+    return true;
+  }
+
+  // Once count saturates the sum stops too, so the mean stays that of the
+  // first 65535 samples (their sum always fits in 32 bits)
+  static void accumulate(Bucket& b, int16_t v) {
+    if (b.count == 0 || v < b.min) b.min = v;
+    if (b.count == 0 || v > b.max) b.max = v;
+    if (b.count == 0xFFFF) return;
+    b.sum += v;
+    b.count++;
+  }
+
+  void addFixed(uint8_t id, uint32_t time, const int16_t* values) {
+    Series* s = seriesFor(id, true);
+    if (!s) {
+      dropped++;
+      return;
+    }
+
+    bool stored = false;
+    for (uint8_t r = 0; r < TREND_RESOLUTIONS; r++) {
+      uint32_t number = time / period(r);
+      if (!advance(*s, r, number)) continue;
+      for (uint8_t m = 0; m < TREND_METRICS; m++) {
+        accumulate(bucket(*s, r, m, number), values[m]);
+      }
+      stored = true;
+    }
+    if (stored) samples++;
+    else dropped++;
+  }
+
+  // Logged ENV record -> stored units
+  static void fromRecord(const LogEnvFields& env, int16_t* values) {
+    values[TREND_TEMPERATURE] = env.tempC100;
+    values[TREND_HUMIDITY] = env.humidity2;
+    values[TREND_PRESSURE] = (int16_t)min((uint16_t)env.pressure10, (uint16_t)32767);
+    values[TREND_BATTERY] = (int16_t)min(env.batteryMv, (uint16_t)32767);
+    values[TREND_RSSI] = env.rssi;
+  }
+
+public:
+  TrendStore()
+    : sized(false), internal(false), count(0), samples(0), dropped(0),
+      replay(nullptr), replayed(0) {
+    lengths[TREND_MINUTE] = TREND_MINUTES;
+    lengths[TREND_HOUR] = TREND_HOURS;
+    lengths[TREND_DAY] = TREND_DAYS;
+    memset(slotOf, NO_SLOT, sizeof(slotOf));
+  }
+
+  // O(1) per sample (plus clearing any buckets skipped by a gap)
+  void add(uint8_t nodeID, uint32_t time, float temp, float humidity,
+           float pressure, uint16_t batteryMv, int16_t rssi) {
+    LogEnvFields env;
+    env.tempC100 = (int16_t)lroundf(constrain(temp, -300.0f, 300.0f) * 100);
+    env.humidity2 = (uint8_t)lroundf(constrain(humidity, 0.0f, 100.0f) * 2);
+    env.pressure10 = (uint16_t)lroundf(constrain(pressure, 0.0f, 3276.0f) * 10);
+    env.batteryMv = batteryMv;
+    env.rssi = (int8_t)constrain(rssi, -128, 127);
+
+    int16_t values[TREND_METRICS];
+    fromRecord(env, values);
+    addFixed(nodeID, time, values);
+  }
+
+  // Start replaying ENV records from the last `days` of SD logs (files
+  // named by date; 00000000-* files have no wall-clock times and are
+  // skipped). Records from `now` on are left out: samples since then are
+  // added live. Needs the card; returns false if there is nothing to replay.
+  bool beginRehydrate(uint32_t now, uint16_t days = TREND_REHYDRATE_DAYS) {
+    if (replay || now < 86400UL * days) return false;   // no wall clock yet
+
+    char cutoff[12];
+    DataLogger::datePrefix(now / 86400 - days, cutoff, sizeof(cutoff));
+
+    File dir = SD.open(LOG_DIR);
+    if (!dir) return false;
+    Replay* rp = new Replay();
+    rp->files = 0;
+
+    // Log names sort by age; collect the ones in range, oldest first
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      const char* name = f.name();
+      const char* slash = strrchr(name, '/');
+      if (slash) name = slash + 1;
+      if (f.isDirectory() || !DataLogger::isLogName(name) ||
+          strncmp(name, cutoff, 8) < 0) {
+        continue;
+      }
+
+      // Insertion sort; when full, drop the oldest
+      uint8_t& n = rp->files;
+      uint8_t i = n < TREND_REHYDRATE_FILES ? n++ : 0;
+      if (i == 0 && n == TREND_REHYDRATE_FILES) {
+        if (strcmp(name, rp->names[0]) < 0) continue;
+        memmove(rp->names[0], rp->names[1], (TREND_REHYDRATE_FILES - 1) * sizeof(rp->names[0]));
+        i = TREND_REHYDRATE_FILES - 1;
+      }
+      while (i > 0 && strcmp(rp->names[i - 1], name) > 0) {
+        strcpy(rp->names[i], rp->names[i - 1]);
+        i--;
+      }
+      strcpy(rp->names[i], name);
+    }
+    dir.close();
+
+    if (rp->files == 0) {
+      delete rp;
+      return false;
+    }
+    rp->file = 0;
+    rp->block = 0;
+    rp->open = false;
+    rp->from = now - 86400UL * days;
+    rp->until = now;
+    replayed = 0;
+    replay = rp;
+    return true;
+  }
+
+  // Replay up to maxBlocks log blocks; true while there is more to do.
+  // Spreading the replay over calls keeps the caller's loop running.
+  bool rehydrateStep(uint16_t maxBlocks) {
+    if (!replay) return false;
+    Replay& rp = *replay;
+
+    while (maxBlocks > 0 && rp.file < rp.files) {
+      if (!rp.open) {
+        String path = String(LOG_DIR "/") + rp.names[rp.file];
+        rp.open = rp.reader.open(path.c_str());
+        rp.block = 0;
+        if (!rp.open) rp.file++;
+        continue;
+      }
+      if (rp.block >= rp.reader.getBlockCount()) {
+        rp.reader.close();
+        rp.open = false;
+        rp.file++;
+        continue;
+      }
+
+      const LogBlockHeader* h;
+      const LogRecord* r;
+      uint16_t records;
+      maxBlocks--;
+      if (!rp.reader.readBlock(rp.block++, h, r, records)) continue;
+      if (!(h->typeMask & (1 << LOG_REC_ENV))) continue;
+      if ((h->flags & LOG_BLOCK_SEALED) && h->lastTime < rp.from) continue;
+
+      for (uint16_t i = 0; i < records; i++) {
+        uint32_t time = h->firstTime + r[i].dt;
+        if (r[i].type != LOG_REC_ENV || time >= rp.until) continue;
+        int16_t values[TREND_METRICS];
+        fromRecord(r[i].env, values);
+        uint32_t before = samples;
+        addFixed(r[i].node, time, values);
+        replayed += samples - before;
+      }
+    }
+
+    if (rp.file < rp.files) return true;
+    delete replay;
+    replay = nullptr;
+    return false;
+  }
+
+  // Buckets of one node/metric whose start lies in [from, to], oldest
+  // first; empty buckets are skipped. Returns the number written to out.
+  uint16_t query(uint8_t nodeID, TrendMetric metric, TrendResolution res,
+                 uint32_t from, uint32_t to, TrendPoint* out, uint16_t maxOut) {
+    Series* s = seriesFor(nodeID, false);
+    if (!s || !(s->primed & (1 << res)) || metric >= TREND_METRICS) return 0;
+
+    uint32_t p = period(res);
+    uint32_t head = s->head[res];
+    uint32_t oldest = head >= ringLength(res) ? head - ringLength(res) + 1 : 0;
+    uint32_t first = max(from / p + (from % p ? 1 : 0), oldest);
+    uint32_t last = min(to / p, head);
+
+    uint16_t n = 0;
+    float k = scale(metric);
+    for (uint32_t number = first; number <= last && n < maxOut; number++) {
+      const Bucket& b = bucket(*s, res, metric, number);
+      if (b.count == 0) continue;
+      TrendPoint& pt = out[n++];
+      pt.time = number * p;
+      pt.min = b.min * k;
+      pt.max = b.max * k;
+      pt.mean = (float)b.sum / b.count * k;
+      pt.count = b.count;
+    }
+    return n;
+  }
+
+  // Finest resolution that covers [from, to] in at most maxPoints buckets
+  // and still reaches back to `from`
+  TrendResolution pickResolution(uint32_t from, uint32_t to, uint32_t now,
+                                 uint16_t maxPoints) const {
+    for (uint8_t r = 0; r < TREND_RESOLUTIONS; r++) {
+      uint32_t span = ringLength(r) * period(r);
+      if ((to - from) / period(r) < maxPoints && now - from < span) {
+        return (TrendResolution)r;
+      }
+    }
+    return TREND_DAY;
+  }
+
+  // CSV export of one node/metric: time,min,max,mean,count
+  void printSeries(Print& out, uint8_t nodeID, TrendMetric metric,
+                   TrendResolution res, uint32_t from, uint32_t to) {
+    TrendPoint pts[32];
+    char line[64];
+    uint32_t p = period(res);
+    while (from <= to) {
+      uint16_t n = query(nodeID, metric, res, from, to, pts, 32);
+      if (n == 0) break;
+      for (uint16_t i = 0; i < n; i++) {
+        snprintf(line, sizeof(line), "%lu,%.2f,%.2f,%.2f,%u",
+                 (unsigned long)pts[i].time, pts[i].min, pts[i].max,
+                 pts[i].mean, pts[i].count);
+        out.println(line);
+      }
+      if (pts[n - 1].time > to - p) break;
+      from = pts[n - 1].time + p;
+    }
+  }
+
+  bool hasNode(uint8_t nodeID) const { return slotOf[nodeID] != NO_SLOT; }
+  uint8_t getNodeCount() const { return count; }
+  uint32_t getSamples() const { return samples; }
+  uint32_t getDropped() const { return dropped; }
+  bool isRehydrating() const { return replay != nullptr; }
+  uint32_t getRehydrated() const { return replayed; }
+  bool isInternal() const { return internal; }
+  size_t bytesPerNode() const { return bucketsPerNode() * sizeof(Bucket); }
+};
+
+#endif // TREND_STORE_H
@@ -13,18 +13,37 @@
  *   - DS3231 RTC for accurate timestamps
  *   - Buzzer/speaker for alarms
  *
+ * Tasks:
+ *   - radio   (core 0): LoRa RX/TX only; decoded frames go out as HubEvents
+ *   - loop    (core 1): node registry, alarm, buttons, display
+ *   - storage (core 1): SD writes from the log queue
+ * Tasks only talk through bounded SPSC rings, so a slow SD write or a
+ * full-screen redraw never delays reception. The radio, display and SD
+ * card share one SPI bus through SpiArbiter: display and SD transfers go
+ * out in bounded chunks and step aside for the radio between chunks.
+ *
  * Author: Auto-generated from design document
  * Version: 1.0.0
  */
 
 #include <Arduino.h>
 #include <Wire.h>
+#include <atomic>
+#include "spi/SpiArbiter.h"
 #include "lora/LoRaHub.h"
 #include "display/HubDisplay.h"
 #include "storage/DataLogger.h"
+#include "clock/RtcClock.h"
+#include "history/TrendStore.h"
 #include "alarm/AlarmManager.h"
+#include "nodes/NodeRegistry.h"
+#include "nodes/RemoteConfig.h"
+#include "queue/SpscRing.h"
+#include "queue/HubEvent.h"
+#include "storage/LogQueue.h"
 #include "../common/CommonTypes.h"
 #include "../common/MessageProtocol.h"
+#include "../../lib/common/alert_rules.h"
 
 // ============================================================================
 // PIN DEFINITIONS
@@ -59,22 +78,59 @@
 // CONFIGURATION
 // ============================================================================
 
-#define MAX_NODES 10
 #define LORA_FREQUENCY 915.0  // MHz (915 for US, 868 for EU, 433 for Asia)
 #define NODE_TIMEOUT 600000   // 10 minutes - mark node offline if no contact
 
+// Alert rules: /rules.txt on the SD card replaces the built-in set
+// (syntax in lib/common/alert_rules.h)
+#define RULES_FILE      "/rules.txt"
+#define RULES_FILE_MAX  2048
+static const char DEFAULT_RULES[] =
+  "low_battery   battery < 3300 hyst 100 for 5m notify\n"
+  "cabin_hot     temp > 45 hyst 2 for 2m notify\n"
+  "baro_falling  pressure rate 3h < -3 hyst 0.5 notify\n"
+  "alarm_timeout alarm_age > 600 reset\n";
+
+// Serial console (remote node config; see README)
+#define CONSOLE_LINE_MAX 96
+
+// Task layout
+#define RADIO_CORE      0
+#define APP_CORE        1
+#define RX_QUEUE_DEPTH  32
+#define RX_QUEUE_URGENT 8     // rx slots only detections and alarms may fill
+#define TX_QUEUE_DEPTH  8
+
 // ============================================================================
 // GLOBAL OBJECTS
 // ============================================================================
 
-LoRaHub lora(LORA_CS, LORA_INT, LORA_RST);
-HubDisplay display(TFT_CS, TFT_DC, TFT_RST);
-DataLogger logger(SD_CS);
+SpiArbiter spiBus;            // radio > display, SD on the shared SPI bus
+LoRaHub lora(LORA_CS, LORA_INT, LORA_RST, spiBus);
+HubDisplay display(TFT_CS, TFT_DC, TFT_RST, spiBus);
+RtcClock rtc;
+DataLogger logger(SD_CS, rtc, spiBus);
+TrendStore trends;            // loop task only
 AlarmManager alarmMgr;
+rules::Engine alertRules;     // loop task only
+static_assert(rules::Engine::MAX_NODE_SLOTS > MAX_NODES,
+              "alert rules need state for every node plus the hub's own (node 0)");
+
+// Node registry (MAX_NODES in CommonTypes.h)
+NodeRegistry registry;
+RemoteConfig remoteConfig;    // loop task only
+
+// Inter-task queues: each has exactly one producer and one consumer task
+SpscRing<HubEvent, RX_QUEUE_DEPTH> rxEvents;    // radio -> loop
+SpscRing<TxCommand, TX_QUEUE_DEPTH> txCommands; // loop -> radio
+LogQueue logQueue;                              // loop -> storage
+std::atomic<uint32_t> rxUrgentDropped(0);       // detections/alarms lost (radio task)
+
+TaskHandle_t appTask = nullptr;
 
-// Node registry
-NodeInfo nodes[MAX_NODES];
-int nodeCount = 0;
+// Radio-to-app latency of decoded events (microseconds)
+uint32_t rxLatencyMaxUs = 0;
+uint32_t rxLatencyAvgUs = 0;
 
 // ============================================================================
 // TIMING VARIABLES
@@ -84,21 +140,40 @@ unsigned long lastDisplayUpdate = 0;
 unsigned long lastNodeHealthCheck = 0;
 unsigned long lastTimeSync = 0;
 unsigned long lastButtonCheck = 0;
+unsigned long lastQueueReport = 0;
+unsigned long lastRuleTick = 0;
 
 // ============================================================================
 // FUNCTION DECLARATIONS
 // ============================================================================
 
 void setupPins();
-void registerNode(uint8_t id, const String& name);
-NodeInfo* findNode(uint8_t id);
+void taskRadio(void* param);
+void taskStorage(void* param);
+void dispatchEvent(const HubEvent& ev);
+void printQueueStats();
+void loadAlertRules();
+void onAlertRule(const rules::Event& ev, void* ctx);
+void enqueueEnv(uint8_t nodeID, float temp, float humidity, float pressure, uint16_t batteryMv, int8_t rssi);
+void enqueueDetection(uint8_t nodeID, uint8_t eventType, uint8_t confidence, uint16_t distance, uint8_t zone, uint8_t phase);
+void enqueueAlarm(uint8_t nodeID, uint8_t command, uint8_t mode);
+void enqueueBarograph(uint8_t nodeID, const uint16_t* samples, uint8_t count);
+void enqueueAnnounce(uint8_t nodeID, uint8_t capabilities, uint8_t fwVersion, const char* name);
+void enqueueConfigAck(uint8_t nodeID, uint8_t status, uint16_t revision);
+void rehydrateTrends();
+void handleConsole();
+void setClock(uint32_t epoch);
+void onConfigResult(uint8_t nodeID, uint8_t status, uint16_t revision);
 void checkNodeHealth();
 void handleButtons();
+void queueAlarmCommand(uint8_t target, uint8_t command, uint8_t mode);
 void soundAlarm();
-void updateDisplay();
+bool updateDisplay();
 void onEnvDataReceived(uint8_t nodeID, float temp, float humidity, float pressure, uint16_t batteryMv, int8_t rssi);
-void onDetectionReceived(uint8_t nodeID, uint8_t eventType, uint8_t confidence, uint16_t distance, uint8_t zone);
+void onDetectionReceived(uint8_t nodeID, uint8_t eventType, uint8_t confidence, uint16_t distance, uint8_t zone, uint8_t phase);
 void onAlarmReceived(uint8_t nodeID, uint8_t command, uint8_t mode);
+void onBarographReceived(uint8_t nodeID, const uint16_t* samples, uint8_t count);
+void onAnnounceReceived(uint8_t nodeID, uint8_t capabilities, uint8_t fwVersion, const char* name);
 
 // ============================================================================
 // SETUP
@@ -114,10 +189,17 @@ void setup() {
   Serial.println("========================================\n");
 
   setupPins();
+  spiBus.begin();
 
   // Initialize I2C
   Wire.begin(I2C_SDA, I2C_SCL);
 
+  // Wall clock for log timestamps and file names
+  if (rtc.begin()) {
+    Serial.print("RTC time: ");
+    Serial.println(rtc.now());
+  }
+
   // Initialize LoRa Hub
   Serial.println("Initializing LoRa Hub...");
   if (!lora.begin(LORA_FREQUENCY)) {
@@ -125,10 +207,14 @@ void setup() {
     while (1) delay(1000);
   }
 
-  // Set LoRa callbacks
-  lora.setEnvDataCallback(onEnvDataReceived);
-  lora.setDetectionCallback(onDetectionReceived);
-  lora.setAlarmCallback(onAlarmReceived);
+  // LoRa callbacks run in the radio task and only enqueue
+  lora.setEnvDataCallback(enqueueEnv);
+  lora.setDetectionCallback(enqueueDetection);
+  lora.setAlarmCallback(enqueueAlarm);
+  lora.setBarographCallback(enqueueBarograph);
+  lora.setAnnounceCallback(enqueueAnnounce);
+  lora.setConfigAckCallback(enqueueConfigAck);
+  remoteConfig.setResultCallback(onConfigResult);
 
   // Initialize display
   Serial.println("Initializing display...");
@@ -146,15 +232,32 @@ void setup() {
 
   // Initialize alarm manager
   alarmMgr.begin();
+  loadAlertRules();
+
+  // Restore nodes that have announced before; on first boot seed the
+  // original installation so it shows up before any node has announced
+  if (registry.begin() == 0) {
+    registry.add(0x01, "Companionway");
+    registry.add(0x02, "Foredeck");
+    registry.add(0x03, "Cockpit");
+    registry.add(0x04, "Cabin");
+    registry.add(0x05, "Engine");
+  }
+
+  // Ways between node locations, for detection correlation
+  alarmMgr.setAdjacent(0x02, 0x03);  // Foredeck - Cockpit (side decks)
+  alarmMgr.setAdjacent(0x03, 0x01);  // Cockpit - Companionway
+  alarmMgr.setAdjacent(0x01, 0x04);  // Companionway - Cabin
+  alarmMgr.setAdjacent(0x04, 0x05);  // Cabin - Engine
+  Serial.print("Nodes registered: ");
+  Serial.println(registry.size());
 
-  // Register known nodes
-  registerNode(0x01, "Companionway");
-  registerNode(0x02, "Foredeck");
-  registerNode(0x03, "Cockpit");
-  registerNode(0x04, "Cabin");
-  registerNode(0x05, "Engine");
+  logQueue.logEvent("Hub started");
 
-  logger.logEvent("Hub started");
+  // setup() and loop() share the Arduino loop task (core 1)
+  appTask = xTaskGetCurrentTaskHandle();
+  xTaskCreatePinnedToCore(taskRadio, "radio", 4096, nullptr, 3, nullptr, RADIO_CORE);
+  xTaskCreatePinnedToCore(taskStorage, "storage", 4096, nullptr, 1, nullptr, APP_CORE);
 
   Serial.println("\nHub initialized successfully!");
   Serial.println("Listening for nodes...\n");
@@ -165,10 +268,22 @@ void setup() {
 // ============================================================================
 
 void loop() {
-  unsigned long now = millis();
+  // Before any new sample, so the replay knows where live data starts
+  rehydrateTrends();
+
+  // Handle everything the radio task decoded since the last pass
+  HubEvent ev;
+  while (rxEvents.pop(ev)) {
+    uint32_t latency = micros() - ev.rxMicros;
+    if (latency > rxLatencyMaxUs) rxLatencyMaxUs = latency;
+    rxLatencyAvgUs = rxLatencyAvgUs - (rxLatencyAvgUs >> 3) + (latency >> 3);
+    dispatchEvent(ev);
+  }
 
-  // Process incoming LoRa messages
-  lora.receive();
+  // Per-frame RX log lines, printed here rather than on the radio path
+  lora.flushRxLog(Serial);
+
+  unsigned long now = millis();
 
   // Handle button presses
   if (now - lastButtonCheck >= 100) {
@@ -176,9 +291,16 @@ void loop() {
     lastButtonCheck = now;
   }
 
-  // Update display
-  if (now - lastDisplayUpdate >= 1000) {
-    updateDisplay();
+  // Remote config: console commands in, due packets out to the radio task
+  handleConsole();
+  TxCommand configCmd = {};
+  configCmd.type = TX_CONFIG;
+  while ((configCmd.len = remoteConfig.poll(now, configCmd.payload, &configCmd.target)) > 0) {
+    if (!txCommands.push(configCmd)) break;  // this attempt is lost; the job retries
+  }
+
+  // Update display (retried next pass while the SD card has the bus)
+  if (now - lastDisplayUpdate >= 1000 && updateDisplay()) {
     lastDisplayUpdate = now;
   }
 
@@ -190,82 +312,269 @@ void loop() {
 
   // Broadcast time sync every 10 minutes
   if (now - lastTimeSync >= 600000) {
-    uint32_t timestamp = now / 1000; // Simple timestamp (seconds since boot)
-    lora.broadcastTimeSync(timestamp);
+    TxCommand cmd = {};
+    cmd.type = TX_TIME_SYNC;
+    cmd.timestamp = rtc.now(); // UTC, or seconds since boot without an RTC
+    txCommands.push(cmd);
     lastTimeSync = now;
   }
 
-  // Process alarm manager
-  alarmMgr.process();
+  // Hourly DS3231 resync (I2C is only used from this task)
+  rtc.process();
+
+  // Queue health
+  if (now - lastQueueReport >= 60000) {
+    printQueueStats();
+    lastQueueReport = now;
+  }
+
+  // Alarm age for the rules (0 while the alarm is not sounding)
+  if (now - lastRuleTick >= 1000) {
+    alertRules.sample(rules::ALARM_AGE, 0, alarmMgr.getAlarmDuration(), now);
+    lastRuleTick = now;
+  }
+
+  // Fallback timeout, in case no rule resets the alarm
+  if (alarmMgr.process()) {
+    logQueue.logEvent("Alarm auto-timeout");
+  }
 
   // Sound alarm if triggered
   if (alarmMgr.isTriggered()) {
     soundAlarm();
   }
 
-  delay(10);
+  // Sleep until the radio task posts an event, or 10 ms for buttons/alarm
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+
+void taskRadio(void* param) {
+  lora.attachTask(xTaskGetCurrentTaskHandle()); // DIO0 wakes this task
+
+  for (;;) {
+    // Drains a whole burst (up to the LoRaHub budget) per call
+    uint8_t received = lora.receive();
+
+    // Transmit whatever the app queued; RadioHead is only touched here
+    TxCommand cmd;
+    while (txCommands.pop(cmd)) {
+      switch (cmd.type) {
+        case TX_ALARM_COMMAND:
+          lora.sendAlarmCommand(cmd.target, cmd.command, cmd.mode);
+          break;
+        case TX_TIME_SYNC:
+          lora.broadcastTimeSync(cmd.timestamp);
+          break;
+        case TX_CONFIG:
+          lora.sendConfigPacket(cmd.target, cmd.payload, cmd.len);
+          break;
+      }
+    }
+
+    if (received == 0) {
+      lora.waitInterrupt(2);  // or poll the TX queue again after 2 ms
+    }
+  }
+}
+
+void taskStorage(void* param) {
+  for (;;) {
+    {
+      SpiLease lease(spiBus, SPI_CLIENT_SD); // yields to the radio per sector
+      logQueue.drainTo(logger);
+      logger.process(); // group commit, rotation, spare preallocation
+    }
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+}
+
+void printQueueStats() {
+  char buf[192];
+  snprintf(buf, sizeof(buf),
+           "Queues: rx %u/%u (hw %u, drop %lu, urgent %lu) tx %u/%u (hw %u, drop %lu) "
+           "log %u/%u (hw %u, drop %lu) latency avg/max %lu/%luus",
+           rxEvents.depth(), rxEvents.capacity(), rxEvents.getHighWater(),
+           (unsigned long)rxEvents.getDropped(), (unsigned long)rxUrgentDropped.load(),
+           txCommands.depth(), txCommands.capacity(), txCommands.getHighWater(),
+           (unsigned long)txCommands.getDropped(),
+           logQueue.depth(), LOG_QUEUE_DEPTH, logQueue.getHighWater(),
+           (unsigned long)logQueue.getDropped(),
+           (unsigned long)rxLatencyAvgUs, (unsigned long)rxLatencyMaxUs);
+  Serial.println(buf);
+
+  const LoRaHub::RxStats& rx = lora.getRxStats();
+  snprintf(buf, sizeof(buf),
+           "Radio: %lu frames in %lu bursts (max %u, budget exits %lu, log drop %lu)",
+           (unsigned long)rx.frames, (unsigned long)rx.bursts, rx.maxBurst,
+           (unsigned long)rx.budgetExits, (unsigned long)lora.getRxLogDropped());
+  Serial.println(buf);
+
+  static uint32_t lastRecords = 0;
+  static unsigned long lastReport = 0;
+  const DataLogger::Stats& log = logger.getStats();
+  unsigned long now = millis();
+  float rate = lastReport ? (log.records - lastRecords) * 1000.0f / (now - lastReport) : 0;
+  snprintf(buf, sizeof(buf),
+           "Log %s: %.1f rec/s, %lu blocks, %lu commits, %lu flushes, buffered %u, "
+           "append/commit max %lu/%luus, dropped %lu",
+           logger.getFileName(), rate, (unsigned long)log.blocks,
+           (unsigned long)log.commits, (unsigned long)log.flushes,
+           logger.getBuffered(), (unsigned long)log.appendMaxUs,
+           (unsigned long)log.commitMaxUs, (unsigned long)log.dropped);
+  Serial.println(buf);
+
+  static uint32_t lastDisplayBytes = 0;
+  const HubDisplay::Stats& ds = display.getStats();
+  float bytesRate = lastReport ? (ds.bytesPushed - lastDisplayBytes) * 1000.0f / (now - lastReport) : 0;
+  snprintf(buf, sizeof(buf),
+           "Display: %.0f B/s over SPI, %lu repaints in %lu frames, frame max %luus",
+           bytesRate, (unsigned long)ds.repaints, (unsigned long)ds.frames,
+           (unsigned long)ds.frameMaxUs);
+  Serial.println(buf);
+  lastDisplayBytes = ds.bytesPushed;
+
+  const SpiArbiter::Stats& spi = spiBus.getStats();
+  const ArbitratedRF95::IrqStats& irq = lora.getIrqStats();
+  snprintf(buf, sizeof(buf),
+           "SPI: radio IRQ service avg/max %lu/%luus (%lu irqs), bus wait max %luus, "
+           "%lu yields, %lu frames deferred, chunk max radio/display/SD %lu/%lu/%luus",
+           (unsigned long)irq.serviceAvgUs, (unsigned long)irq.serviceMaxUs,
+           (unsigned long)irq.irqs, (unsigned long)spi.radioWaitMaxUs,
+           (unsigned long)spi.yields, (unsigned long)spi.busySkips,
+           (unsigned long)spi.chunkMaxUs[SPI_CLIENT_RADIO],
+           (unsigned long)spi.chunkMaxUs[SPI_CLIENT_DISPLAY],
+           (unsigned long)spi.chunkMaxUs[SPI_CLIENT_SD]);
+  Serial.println(buf);
+
+  const DetectionCorrelator::Stats& cs = alarmMgr.getCorrelationStats();
+  snprintf(buf, sizeof(buf),
+           "Correlation: %lu detections, %lu continued a track, %lu confirmed, %lu instant",
+           (unsigned long)cs.events, (unsigned long)cs.chained,
+           (unsigned long)cs.confirmed, (unsigned long)cs.instant);
+  Serial.println(buf);
+
+  const journal::Journal::Stats& js = alarmMgr.getJournalStats();
+  snprintf(buf, sizeof(buf),
+           "Alarm journal: %lu appends (%lu unchanged), append max %luus, "
+           "restore %luus, %u bad records",
+           (unsigned long)js.appends, (unsigned long)js.unchanged,
+           (unsigned long)js.append_max_us, (unsigned long)js.restore_us, js.bad);
+  Serial.println(buf);
+
+  if (alertRules.untracked() > 0) {
+    snprintf(buf, sizeof(buf), "Alert rules: %lu samples ignored, no rule state left",
+             (unsigned long)alertRules.untracked());
+    Serial.println(buf);
+  }
+
+  lastRecords = log.records;
+  lastReport = now;
 }
 
 // ============================================================================
 // HELPER FUNCTIONS
 // ============================================================================
 
-void setupPins() {
-  pinMode(BUZZER_PIN, OUTPUT);
-  digitalWrite(BUZZER_PIN, LOW);
+// Before the tasks start, so the SD card can be read directly
+void loadAlertRules() {
+  alertRules.on_event(onAlertRule);
+
+  static char text[RULES_FILE_MAX + 1];
+  const char* source = DEFAULT_RULES;
+  File f = logger.isAvailable() ? SD.open(RULES_FILE, FILE_READ) : File();
+  if (f) {
+    size_t len = f.read((uint8_t*)text, RULES_FILE_MAX);
+    text[len] = '\0';
+    f.close();
+    source = text;
+  }
 
-  pinMode(BTN_ARM, INPUT_PULLUP);
-  pinMode(BTN_DISARM, INPUT_PULLUP);
-  pinMode(BTN_SILENCE, INPUT_PULLUP);
+  uint8_t count = alertRules.load(source, &Serial);
+  char buf[64];
+  snprintf(buf, sizeof(buf), "Alert rules: %u from %s", count,
+           source == text ? RULES_FILE : "defaults");
+  Serial.println(buf);
+  alertRules.print(Serial);
 }
 
-void registerNode(uint8_t id, const String& name) {
-  if (nodeCount >= MAX_NODES) {
-    Serial.println("ERROR: Max nodes reached");
+// Rule edges; samples are fed from the loop task, so this runs there too
+void onAlertRule(const rules::Event& ev, void* ctx) {
+  NodeInfo* node = ev.node ? registry.find(ev.node) : nullptr;
+  const char* where = node ? node->name.c_str() : "Hub";
+
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%s %s: %s %s %.1f", ev.raised ? "ALERT" : "Cleared",
+           ev.rule->name, where, rules::Engine::metric_name(ev.rule->metric), ev.value);
+  Serial.println(msg);
+
+  if (!ev.raised) {
+    logQueue.logEvent(msg);
     return;
   }
 
-  nodes[nodeCount].id = id;
-  nodes[nodeCount].name = name;
-  nodes[nodeCount].online = false;
-  nodes[nodeCount].lastContact = 0;
-  nodes[nodeCount].temperature = 0;
-  nodes[nodeCount].humidity = 0;
-  nodes[nodeCount].pressure = 0;
-  nodes[nodeCount].batteryVoltage = 0;
-  nodes[nodeCount].rssi = 0;
-  nodes[nodeCount].state = STATE_INIT;
+  switch (ev.rule->action) {
+    case rules::NOTIFY:
+      logQueue.logEvent(msg);
+      break;
 
-  Serial.print("Registered node: 0x");
-  Serial.print(id, HEX);
-  Serial.print(" - ");
-  Serial.println(name);
+    case rules::ALARM:
+      alarmMgr.triggerAlarm(ev.node);
+      logQueue.logAlarm(ev.node, msg);
+      break;
 
-  nodeCount++;
-}
+    case rules::RESET:
+      if (alarmMgr.isTriggered()) {
+        alarmMgr.disarm();
+        logQueue.logEvent(msg);
+      }
+      break;
 
-NodeInfo* findNode(uint8_t id) {
-  for (int i = 0; i < nodeCount; i++) {
-    if (nodes[i].id == id) {
-      return &nodes[i];
-    }
+    default:
+      break;
   }
-  return nullptr;
+}
+
+void setupPins() {
+  pinMode(BUZZER_PIN, OUTPUT);
+  digitalWrite(BUZZER_PIN, LOW);
+
+  pinMode(BTN_ARM, INPUT_PULLUP);
+  pinMode(BTN_DISARM, INPUT_PULLUP);
+  pinMode(BTN_SILENCE, INPUT_PULLUP);
 }
 
 void checkNodeHealth() {
   unsigned long now = millis();
 
-  for (int i = 0; i < nodeCount; i++) {
+  NodeInfo* nodes = registry.all();
+  for (int i = 0; i < registry.size(); i++) {
     if (nodes[i].online && (now - nodes[i].lastContact > NODE_TIMEOUT)) {
       Serial.print("Node offline: ");
       Serial.println(nodes[i].name);
 
       nodes[i].online = false;
 
-      logger.logEvent(("Node offline: " + nodes[i].name).c_str());
+      logQueue.logEvent(("Node offline: " + nodes[i].name).c_str());
     }
   }
+
+  // Addresses that sent frames but never announced: stop holding a slot
+  registry.expire(now, NODE_TIMEOUT);
+}
+
+void queueAlarmCommand(uint8_t target, uint8_t command, uint8_t mode) {
+  TxCommand cmd = {};
+  cmd.type = TX_ALARM_COMMAND;
+  cmd.target = target;
+  cmd.command = command;
+  cmd.mode = mode;
+  if (!txCommands.push(cmd)) {
+    Serial.println("WARNING: TX queue full, alarm command dropped");
+  }
 }
 
 void handleButtons() {
@@ -294,8 +603,8 @@ void handleButtons() {
     }
 
     alarmMgr.armSystem(newMode);
-    lora.sendAlarmCommand(BROADCAST_ADDRESS, 0x01, (uint8_t)newMode); // Arm all nodes
-    logger.logEvent(("Armed: " + String(alarmModeToString(newMode))).c_str());
+    queueAlarmCommand(BROADCAST_ADDRESS, 0x01, (uint8_t)newMode); // Arm all nodes
+    logQueue.logEvent(("Armed: " + String(alarmModeToString(newMode))).c_str());
 
     tone(BUZZER_PIN, 1000, 100); // Acknowledge
 
@@ -308,8 +617,8 @@ void handleButtons() {
     btnDisarmPressed = true;
 
     alarmMgr.disarm();
-    lora.sendAlarmCommand(BROADCAST_ADDRESS, 0x02, MODE_DISARMED); // Disarm all nodes
-    logger.logEvent("Disarmed");
+    queueAlarmCommand(BROADCAST_ADDRESS, 0x02, MODE_DISARMED); // Disarm all nodes
+    logQueue.logEvent("Disarmed");
 
     tone(BUZZER_PIN, 800, 100);
 
@@ -323,8 +632,8 @@ void handleButtons() {
 
     if (alarmMgr.isTriggered()) {
       alarmMgr.disarm();
-      lora.sendAlarmCommand(BROADCAST_ADDRESS, 0x04, MODE_DISARMED); // Silence all
-      logger.logEvent("Alarm silenced");
+      queueAlarmCommand(BROADCAST_ADDRESS, 0x04, MODE_DISARMED); // Silence all
+      logQueue.logEvent("Alarm silenced");
       noTone(BUZZER_PIN);
     }
 
@@ -349,28 +658,137 @@ void soundAlarm() {
   }
 }
 
-void updateDisplay() {
-  display.drawMainScreen(nodes, nodeCount, alarmMgr.getMode(), alarmMgr.isTriggered());
+// False if the bus was busy and the frame was skipped
+bool updateDisplay() {
+  SpiLease lease(spiBus, SPI_CLIENT_DISPLAY, false); // yields to the radio per primitive
+  if (!lease.held()) return false;
+
+  display.drawMainScreen(registry.all(), registry.size(), alarmMgr.getMode(),
+                         alarmMgr.isTriggered(), &trends, rtc.now());
 
   if (alarmMgr.isTriggered()) {
-    NodeInfo* node = findNode(alarmMgr.getTriggeringNode());
+    NodeInfo* node = registry.find(alarmMgr.getTriggeringNode());
     const char* nodeName = node ? node->name.c_str() : "Unknown";
     display.showAlarm(nodeName);
+  } else {
+    display.hideAlarm();
   }
+  return true;
+}
+
+// ============================================================================
+// LORA CALLBACKS (radio task: decode into events, nothing else)
+// ============================================================================
+
+void postEvent(HubEvent& ev) {
+  ev.rxMicros = micros();
+  // Telemetry is dropped first and leaves the last slots to detections and
+  // alarms; all drops are counted if the app task is that far behind
+  bool urgent = isUrgentEvent(ev.type);
+  if (!rxEvents.push(ev, urgent ? 0 : RX_QUEUE_URGENT) && urgent) rxUrgentDropped++;
+  if (appTask) xTaskNotifyGive(appTask);
+}
+
+void enqueueEnv(uint8_t nodeID, float temp, float humidity, float pressure,
+                uint16_t batteryMv, int8_t rssi) {
+  HubEvent ev;
+  ev.type = EVT_ENV;
+  ev.nodeID = nodeID;
+  ev.env.temperature = temp;
+  ev.env.humidity = humidity;
+  ev.env.pressure = pressure;
+  ev.env.batteryMv = batteryMv;
+  ev.env.rssi = rssi;
+  postEvent(ev);
+}
+
+void enqueueDetection(uint8_t nodeID, uint8_t eventType, uint8_t confidence,
+                      uint16_t distance, uint8_t zone, uint8_t phase) {
+  HubEvent ev;
+  ev.type = EVT_DETECTION;
+  ev.nodeID = nodeID;
+  ev.detection.eventType = eventType;
+  ev.detection.confidence = confidence;
+  ev.detection.distance = distance;
+  ev.detection.zone = zone;
+  ev.detection.phase = phase;
+  postEvent(ev);
+}
+
+void enqueueAlarm(uint8_t nodeID, uint8_t command, uint8_t mode) {
+  HubEvent ev;
+  ev.type = EVT_ALARM;
+  ev.nodeID = nodeID;
+  ev.alarm.command = command;
+  ev.alarm.mode = mode;
+  postEvent(ev);
+}
+
+void enqueueBarograph(uint8_t nodeID, const uint16_t* samples, uint8_t count) {
+  HubEvent ev;
+  ev.type = EVT_BAROGRAPH;
+  ev.nodeID = nodeID;
+  if (count > BAROGRAPH_HOURS) count = BAROGRAPH_HOURS;
+  ev.barograph.count = count;
+  memcpy(ev.barograph.samples, samples, count * sizeof(uint16_t));
+  postEvent(ev);
+}
+
+void enqueueAnnounce(uint8_t nodeID, uint8_t capabilities, uint8_t fwVersion,
+                     const char* name) {
+  HubEvent ev;
+  ev.type = EVT_ANNOUNCE;
+  ev.nodeID = nodeID;
+  ev.announce.capabilities = capabilities;
+  ev.announce.fwVersion = fwVersion;
+  strncpy(ev.announce.name, name, ANNOUNCE_NAME_MAX);
+  ev.announce.name[ANNOUNCE_NAME_MAX] = '\0';
+  postEvent(ev);
+}
+
+void enqueueConfigAck(uint8_t nodeID, uint8_t status, uint16_t revision) {
+  HubEvent ev;
+  ev.type = EVT_CONFIG_ACK;
+  ev.nodeID = nodeID;
+  ev.configAck.status = status;
+  ev.configAck.revision = revision;
+  postEvent(ev);
 }
 
 // ============================================================================
-// LORA CALLBACKS
+// EVENT HANDLERS (loop task)
 // ============================================================================
 
+void dispatchEvent(const HubEvent& ev) {
+  switch (ev.type) {
+    case EVT_ENV:
+      onEnvDataReceived(ev.nodeID, ev.env.temperature, ev.env.humidity,
+                        ev.env.pressure, ev.env.batteryMv, ev.env.rssi);
+      break;
+    case EVT_DETECTION:
+      onDetectionReceived(ev.nodeID, ev.detection.eventType, ev.detection.confidence,
+                          ev.detection.distance, ev.detection.zone, ev.detection.phase);
+      break;
+    case EVT_ALARM:
+      onAlarmReceived(ev.nodeID, ev.alarm.command, ev.alarm.mode);
+      break;
+    case EVT_BAROGRAPH:
+      onBarographReceived(ev.nodeID, ev.barograph.samples, ev.barograph.count);
+      break;
+    case EVT_ANNOUNCE:
+      onAnnounceReceived(ev.nodeID, ev.announce.capabilities, ev.announce.fwVersion,
+                         ev.announce.name);
+      break;
+    case EVT_CONFIG_ACK:
+      remoteConfig.onAck(ev.nodeID, ev.configAck.status, ev.configAck.revision);
+      break;
+  }
+}
+
 void onEnvDataReceived(uint8_t nodeID, float temp, float humidity, float pressure,
                       uint16_t batteryMv, int8_t rssi) {
-  NodeInfo* node = findNode(nodeID);
-  if (!node) {
-    Serial.print("Unknown node: 0x");
-    Serial.println(nodeID, HEX);
-    return;
-  }
+  NodeInfo* node = registry.findOrAdd(nodeID);
+  if (!node) return;
 
   // Update node data
   node->online = true;
@@ -382,23 +800,31 @@ void onEnvDataReceived(uint8_t nodeID, float temp, float humidity, float pressur
   node->rssi = rssi;
 
   // Log to SD card
-  logger.logEnvironmental(nodeID, temp, humidity, pressure, batteryMv, rssi);
+  logQueue.logEnvironmental(nodeID, temp, humidity, pressure, batteryMv, rssi);
+  trends.add(nodeID, rtc.now(), temp, humidity, pressure, batteryMv, rssi);
 
-  // Check for low battery alert
-  if (batteryMv < 3300 && batteryMv > 1000) {
-    Serial.print("LOW BATTERY: ");
-    Serial.print(node->name);
-    Serial.print(" - ");
-    Serial.print(batteryMv);
-    Serial.println("mV");
+  // Alert rules (nodes without a battery report ~0 mV)
+  unsigned long now = millis();
+  if (!alertRules.sample(rules::TEMP, nodeID, temp, now) && alertRules.untracked() == 1) {
+    Serial.print("Alert rules: no state left for node 0x");
+    Serial.println(nodeID, HEX);
   }
+  alertRules.sample(rules::HUMIDITY, nodeID, humidity, now);
+  alertRules.sample(rules::PRESSURE, nodeID, pressure, now);
+  if (batteryMv > 1000) alertRules.sample(rules::BATTERY, nodeID, batteryMv, now);
 }
 
 void onDetectionReceived(uint8_t nodeID, uint8_t eventType, uint8_t confidence,
-                        uint16_t distance, uint8_t zone) {
-  NodeInfo* node = findNode(nodeID);
+                        uint16_t distance, uint8_t zone, uint8_t phase) {
+  NodeInfo* node = registry.findOrAdd(nodeID);
   if (!node) return;
 
+  if (phase == DETECTION_CLEAR) {
+    Serial.print("Detection cleared at ");
+    Serial.println(node->name);
+    return;
+  }
+
   Serial.print("Detection at ");
   Serial.print(node->name);
   Serial.print(": Type=");
@@ -408,18 +834,25 @@ void onDetectionReceived(uint8_t nodeID, uint8_t eventType, uint8_t confidence,
   Serial.println("%");
 
   // Log detection
-  logger.logDetection(nodeID, eventType, confidence, distance, zone);
-
-  // If system is armed and this is a high-confidence detection, trigger alarm
-  AlarmMode mode = alarmMgr.getMode();
-  if ((mode == MODE_PERIMETER || mode == MODE_FULL) && confidence >= 80) {
-    alarmMgr.triggerAlarm(nodeID);
-    logger.logAlarm(nodeID, "Detection triggered alarm");
+  logQueue.logDetection(nodeID, eventType, confidence, distance, zone);
+
+  // Correlate with the other nodes; the mode's policy decides on the alarm
+  bool wasTriggered = alarmMgr.isTriggered();
+  CorrelationResult result = alarmMgr.onDetection(nodeID, confidence, zone, phase);
+  if (!wasTriggered && alarmMgr.isTriggered()) {
+    char track[32];
+    alarmMgr.describeTrack(nodeID, track, sizeof(track));
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%s %s",
+             result == CORR_INSTANT ? "Detection triggered alarm" : "Track confirmed",
+             track);
+    Serial.println(msg);
+    logQueue.logAlarm(nodeID, msg);
   }
 }
 
 void onAlarmReceived(uint8_t nodeID, uint8_t command, uint8_t mode) {
-  NodeInfo* node = findNode(nodeID);
+  NodeInfo* node = registry.find(nodeID);
   const char* nodeName = node ? node->name.c_str() : "Unknown";
 
   switch (command) {
@@ -427,7 +860,7 @@ void onAlarmReceived(uint8_t nodeID, uint8_t command, uint8_t mode) {
       Serial.print("ALARM from ");
       Serial.println(nodeName);
       alarmMgr.triggerAlarm(nodeID);
-      logger.logAlarm(nodeID, "Alarm triggered");
+      logQueue.logAlarm(nodeID, "Alarm triggered");
       break;
 
     default:
@@ -438,3 +871,117 @@ void onAlarmReceived(uint8_t nodeID, uint8_t command, uint8_t mode) {
       break;
   }
 }
+
+void onBarographReceived(uint8_t nodeID, const uint16_t* samples, uint8_t count) {
+  NodeInfo* node = registry.findOrAdd(nodeID);
+  if (!node) return;
+
+  // The node keeps the history; the hub just holds its latest trace
+  if (count > BAROGRAPH_HOURS) count = BAROGRAPH_HOURS;
+  memcpy(node->barograph, samples, count * sizeof(uint16_t));
+  node->barographCount = count;
+}
+
+void onAnnounceReceived(uint8_t nodeID, uint8_t capabilities, uint8_t fwVersion,
+                        const char* name) {
+  bool isNew = registry.find(nodeID) == nullptr;
+  NodeInfo* node = registry.announce(nodeID, name, capabilities, fwVersion);
+  if (!node) return;
+
+  node->online = true;
+  node->lastContact = millis();
+
+  if (isNew) {
+    logQueue.logEvent(("Node joined: " + node->name).c_str());
+  }
+}
+
+// Rebuild the trend history from the SD logs once the clock is set, a few
+// blocks per pass so the loop keeps up with the radio meanwhile
+void rehydrateTrends() {
+  static bool done = false;
+  static uint32_t liveFrom = 0;   // samples from here on are added live
+  static unsigned long start = 0;
+  if (done || !rtc.valid() || !logger.isAvailable()) return;
+  if (liveFrom == 0) liveFrom = rtc.now();
+
+  // Like the display, skip a pass rather than wait behind an SD write
+  SpiLease lease(spiBus, SPI_CLIENT_SD, false);
+  if (!lease.held()) return;
+
+  if (!trends.isRehydrating()) {
+    start = millis();
+    if (!trends.beginRehydrate(liveFrom)) {
+      done = true;
+      return;
+    }
+  }
+  // One 4 KB read at a time, handing the bus to the radio in between
+  for (uint8_t i = 0; i < TREND_REHYDRATE_BLOCKS; i++) {
+    if (!trends.rehydrateStep(1)) break;
+    if (i + 1 == TREND_REHYDRATE_BLOCKS) return;
+    spiBus.yieldToRadio();
+  }
+
+  done = true;
+  char buf[80];
+  snprintf(buf, sizeof(buf), "Trends: %lu samples, %u nodes from SD in %lu ms",
+           (unsigned long)trends.getRehydrated(), trends.getNodeCount(),
+           millis() - start);
+  Serial.println(buf);
+}
+
+// Serial console: "config <node hex> [setting=value ...]" or
+// "time <UTC epoch seconds>" (e.g. from `date +%s`) to set the DS3231
+void handleConsole() {
+  static char line[CONSOLE_LINE_MAX];
+  static uint8_t len = 0;
+
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (len < sizeof(line) - 1) line[len++] = c;
+      continue;
+    }
+    if (len == 0) continue;
+    line[len] = '\0';
+    len = 0;
+
+    if (strncmp(line, "config ", 7) == 0) {
+      remoteConfig.queueCommand(line + 7, Serial);
+    } else if (strncmp(line, "time ", 5) == 0) {
+      setClock(strtoul(line + 5, nullptr, 10));
+    } else {
+      Serial.println("commands: config <node hex> [setting=value ...]");
+      Serial.println("          time <UTC epoch seconds>");
+    }
+  }
+}
+
+// Runs in the Arduino loop, which owns I2C
+void setClock(uint32_t epoch) {
+  if (!rtc.set(epoch)) {
+    Serial.println(rtc.isPresent() ? "Time rejected (2000-2199 only)"
+                                   : "No DS3231 - time not set");
+    return;
+  }
+
+  char buf[48];
+  snprintf(buf, sizeof(buf), "Clock set to %lu", (unsigned long)epoch);
+  Serial.println(buf);
+  logQueue.logEvent(buf);
+
+  // Pass the new time on to the nodes now rather than at the next sync
+  TxCommand cmd = {};
+  cmd.type = TX_TIME_SYNC;
+  cmd.timestamp = epoch;
+  txCommands.push(cmd);
+}
+
+void onConfigResult(uint8_t nodeID, uint8_t status, uint16_t revision) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "Config 0x%02X rev %u: %s", nodeID, revision,
+           RemoteConfig::statusToString(status));
+  Serial.println(buf);
+  logQueue.logEvent(buf);
+}
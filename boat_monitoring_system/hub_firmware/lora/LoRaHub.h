@@ -5,16 +5,180 @@
 #include <RHReliableDatagram.h>
 #include "../../common/MessageProtocol.h"
 #include "../../common/CommonTypes.h"
+#include "../queue/SpscRing.h"
+#include "../spi/SpiArbiter.h"
 
-#define MAX_NODES 10
+// Default per-call receive budget. Each frame costs its ACK airtime
+// (~40 ms at SF8/125 kHz), so the time budget is what normally bounds a burst.
+#define RX_BURST_MAX_FRAMES 8
+#define RX_BURST_BUDGET_MS  250
+#define RX_LOG_DEPTH        16
+
+/**
+ * RH_RF95 that shares the SPI bus through SpiArbiter and services DIO0
+ * from the radio task
+ *
+ * RadioHead reads the FIFO inside its DIO0 ISR, which needs the bus at a
+ * moment the display or SD card may be in the middle of a transfer. Here
+ * the ISR only timestamps the edge and wakes the radio task; service()
+ * then takes the bus (the holder yields at its next chunk boundary) and
+ * runs RadioHead's handler. available() and waitPacketSent() service
+ * pending interrupts themselves, so RHReliableDatagram works unchanged.
+ */
+class ArbitratedRF95 : public RH_RF95 {
+public:
+  struct IrqStats {
+    uint32_t irqs;
+    uint32_t serviceAvgUs;     // DIO0 edge until the handler runs
+    uint32_t serviceMaxUs;
+  };
+
+private:
+  SpiArbiter& spi;
+  uint8_t irqPin;
+  TaskHandle_t serviceTask;
+  volatile bool irqPending;
+  volatile uint32_t irqMicros;
+  IrqStats irqStats;
+
+  static ArbitratedRF95*& owner() {
+    static ArbitratedRF95* radio = nullptr;
+    return radio;
+  }
+
+  static void IRAM_ATTR dio0Isr() {
+    ArbitratedRF95* radio = owner();
+    if (!radio) return;
+    if (!radio->irqPending) {
+      radio->irqMicros = micros();
+      radio->irqPending = true;
+    }
+    if (radio->serviceTask) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(radio->serviceTask, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    }
+  }
+
+public:
+  // Every register access RadioHead makes goes through these
+  uint8_t spiRead(uint8_t reg) override {
+    spi.acquireRadio();
+    uint8_t v = RH_RF95::spiRead(reg);
+    spi.releaseRadio();
+    return v;
+  }
+
+  uint8_t spiWrite(uint8_t reg, uint8_t val) override {
+    spi.acquireRadio();
+    uint8_t status = RH_RF95::spiWrite(reg, val);
+    spi.releaseRadio();
+    return status;
+  }
+
+  uint8_t spiBurstRead(uint8_t reg, uint8_t* dest, uint8_t len) override {
+    spi.acquireRadio();
+    uint8_t status = RH_RF95::spiBurstRead(reg, dest, len);
+    spi.releaseRadio();
+    return status;
+  }
+
+  uint8_t spiBurstWrite(uint8_t reg, const uint8_t* src, uint8_t len) override {
+    spi.acquireRadio();
+    uint8_t status = RH_RF95::spiBurstWrite(reg, src, len);
+    spi.releaseRadio();
+    return status;
+  }
+
+  ArbitratedRF95(uint8_t cs, uint8_t interrupt, SpiArbiter& arbiter)
+    : RH_RF95(cs, interrupt), spi(arbiter), irqPin(interrupt), serviceTask(nullptr),
+      irqPending(false), irqMicros(0) {
+    memset(&irqStats, 0, sizeof(irqStats));
+  }
+
+  // After init(): replace RadioHead's ISR with the deferring one
+  void deferInterrupts() {
+    owner() = this;
+    detachInterrupt(digitalPinToInterrupt(irqPin));
+    attachInterrupt(digitalPinToInterrupt(irqPin), dio0Isr, RISING);
+  }
+
+  // The task woken by DIO0 (the one calling service())
+  void setServiceTask(TaskHandle_t task) { serviceTask = task; }
+
+  // Run RadioHead's interrupt handler if DIO0 has fired
+  void service() {
+    if (!irqPending) return;
+    spi.acquireRadio();
+    uint32_t latency = micros() - irqMicros;
+    irqPending = false;
+    handleInterrupt();
+    spi.releaseRadio();
+
+    irqStats.irqs++;
+    irqStats.serviceAvgUs = irqStats.irqs == 1 ? latency
+        : irqStats.serviceAvgUs - (irqStats.serviceAvgUs >> 3) + (latency >> 3);
+    if (latency > irqStats.serviceMaxUs) irqStats.serviceMaxUs = latency;
+  }
+
+  // Sleep until DIO0 fires or the timeout passes, then service it
+  void waitInterrupt(uint32_t timeoutMs) {
+    if (!irqPending) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+    service();
+  }
+
+  bool available() override {
+    service();
+    return RH_RF95::available();
+  }
+
+  bool waitPacketSent() override {
+    while (mode() == RHModeTx) waitInterrupt(1);
+    return true;
+  }
+
+  bool waitPacketSent(uint16_t timeout) override {
+    unsigned long start = millis();
+    while (mode() == RHModeTx) {
+      if (millis() - start > timeout) return false;
+      waitInterrupt(1);
+    }
+    return true;
+  }
+
+  const IrqStats& getIrqStats() const { return irqStats; }
+};
 
 /**
  * LoRa Hub Communication Manager
  * Receives and processes messages from all nodes
+ *
+ * receive() drains every pending frame up to a frame count and time budget,
+ * so a burst from several nodes is taken in one call instead of waiting in
+ * the radio for the next loop pass. Per-frame log lines are not printed on
+ * the receive path; a compact record goes into a ring that another task
+ * prints with flushRxLog().
  */
 class LoRaHub {
+public:
+  struct RxLogEntry {
+    uint8_t from;
+    uint8_t type;
+    uint8_t len;
+    int16_t rssi;
+    int8_t snr;
+    uint16_t batteryMv;      // heartbeats only, else 0
+  };
+
+  struct RxStats {
+    uint32_t frames;
+    uint32_t bursts;         // receive() calls that took at least one frame
+    uint32_t budgetExits;    // bursts cut short with frames still pending
+    uint8_t maxBurst;
+  };
+
 private:
-  RH_RF95 rf95;
+  ArbitratedRF95 rf95;
   RHReliableDatagram* manager;
   uint8_t hubID;
 
@@ -25,17 +189,31 @@ private:
 
   // Callbacks
   typedef void (*EnvDataCallback)(uint8_t nodeID, float temp, float humidity, float pressure, uint16_t batteryMv, int8_t rssi);
-  typedef void (*DetectionCallback)(uint8_t nodeID, uint8_t eventType, uint8_t confidence, uint16_t distance, uint8_t zone);
+  typedef void (*DetectionCallback)(uint8_t nodeID, uint8_t eventType, uint8_t confidence, uint16_t distance, uint8_t zone, uint8_t phase);
   typedef void (*AlarmCallback)(uint8_t nodeID, uint8_t command, uint8_t mode);
+  typedef void (*BarographCallback)(uint8_t nodeID, const uint16_t* samples, uint8_t count);
+  typedef void (*AnnounceCallback)(uint8_t nodeID, uint8_t capabilities, uint8_t fwVersion, const char* name);
+  typedef void (*ConfigAckCallback)(uint8_t nodeID, uint8_t status, uint16_t revision);
 
   EnvDataCallback onEnvData;
   DetectionCallback onDetection;
   AlarmCallback onAlarm;
+  BarographCallback onBarograph;
+  AnnounceCallback onAnnounce;
+  ConfigAckCallback onConfigAck;
+
+  uint8_t burstMaxFrames;
+  uint32_t burstBudgetMs;
+  RxStats rxStats;
+  SpscRing<RxLogEntry, RX_LOG_DEPTH> rxLog;
 
 public:
-  LoRaHub(uint8_t cs, uint8_t interrupt, uint8_t reset)
-    : rf95(cs, interrupt), csPin(cs), intPin(interrupt), rstPin(reset),
-      hubID(HUB_ADDRESS), onEnvData(nullptr), onDetection(nullptr), onAlarm(nullptr) {
+  LoRaHub(uint8_t cs, uint8_t interrupt, uint8_t reset, SpiArbiter& spi)
+    : rf95(cs, interrupt, spi), csPin(cs), intPin(interrupt), rstPin(reset),
+      hubID(HUB_ADDRESS), onEnvData(nullptr), onDetection(nullptr), onAlarm(nullptr),
+      onBarograph(nullptr), onAnnounce(nullptr), onConfigAck(nullptr),
+      burstMaxFrames(RX_BURST_MAX_FRAMES), burstBudgetMs(RX_BURST_BUDGET_MS) {
+    memset(&rxStats, 0, sizeof(rxStats));
     manager = new RHReliableDatagram(rf95, HUB_ADDRESS);
   }
 
@@ -57,6 +235,7 @@ public:
       Serial.println("LoRa Hub init failed");
       return false;
     }
+    rf95.deferInterrupts();
 
     // Configure LoRa parameters
     if (!rf95.setFrequency(frequency)) {
@@ -80,31 +259,68 @@ public:
     return true;
   }
 
-  // Process incoming messages (call in loop)
-  bool receive() {
-    if (manager->available()) {
+  // Drain pending messages within the burst budget. Returns frames handled.
+  uint8_t receive() {
+    uint8_t frames = 0;
+    uint32_t start = millis();
+
+    while (manager->available()) {
+      if (frames >= burstMaxFrames || millis() - start >= burstBudgetMs) {
+        rxStats.budgetExits++;
+        break;
+      }
+
       uint8_t buf[RH_RF95_MAX_MESSAGE_LEN];
       uint8_t len = sizeof(buf);
       uint8_t from;
 
-      if (manager->recvfromAck(buf, &len, &from)) {
-        int16_t rssi = rf95.lastRssi();
-        int8_t snr = rf95.lastSNR();
+      if (!manager->recvfromAck(buf, &len, &from)) {
+        break; // duplicate or not for us; nothing else to take
+      }
+
+      int16_t rssi = rf95.lastRssi();
+      RxLogEntry entry = { from, len >= 2 ? buf[1] : (uint8_t)0, len,
+                           rssi, rf95.lastSNR(), 0 };
+      handleMessage(buf, len, from, rssi, entry);
+      rxLog.push(entry); // dropped, not blocked, if nobody is printing
+      frames++;
+    }
+
+    if (frames > 0) {
+      rxStats.frames += frames;
+      rxStats.bursts++;
+      if (frames > rxStats.maxBurst) rxStats.maxBurst = frames;
+    }
+    return frames;
+  }
 
-        Serial.print("Received from 0x");
-        Serial.print(from, HEX);
-        Serial.print(", RSSI: ");
-        Serial.print(rssi);
-        Serial.print(", SNR: ");
-        Serial.println(snr);
+  // Call from the radio task before its loop; DIO0 wakes it
+  void attachTask(TaskHandle_t task) { rf95.setServiceTask(task); }
 
-        handleMessage(buf, len, from, rssi);
-        return true;
-      }
+  // Sleep until the radio has something for us, at most timeoutMs
+  void waitInterrupt(uint32_t timeoutMs) { rf95.waitInterrupt(timeoutMs); }
+
+  void setBurstBudget(uint8_t maxFrames, uint32_t budgetMs) {
+    burstMaxFrames = maxFrames ? maxFrames : 1;
+    burstBudgetMs = budgetMs;
+  }
+
+  // Print queued per-frame log lines (call from a non-radio task)
+  void flushRxLog(Print& out) {
+    RxLogEntry e;
+    while (rxLog.pop(e)) {
+      char line[80];
+      int n = snprintf(line, sizeof(line), "RX 0x%02X type 0x%02X len %u RSSI %d SNR %d",
+                       e.from, e.type, e.len, e.rssi, e.snr);
+      if (e.batteryMv) snprintf(line + n, sizeof(line) - n, " battery %umV", e.batteryMv);
+      out.println(line);
     }
-    return false;
   }
 
+  const RxStats& getRxStats() const { return rxStats; }
+  const ArbitratedRF95::IrqStats& getIrqStats() const { return rf95.getIrqStats(); }
+  uint32_t getRxLogDropped() const { return rxLog.getDropped(); }
+
   // Send alarm command to node(s)
   bool sendAlarmCommand(uint8_t targetNode, uint8_t command, uint8_t mode) {
     uint8_t packet[ALARM_PACKET_SIZE];
@@ -122,6 +338,19 @@ public:
     return success;
   }
 
+  // Send a packed config packet (built by RemoteConfig) to one node
+  bool sendConfigPacket(uint8_t targetNode, uint8_t* packet, uint8_t len) {
+    bool success = manager->sendtoWait(packet, len, targetNode);
+
+    if (!success) {
+      Serial.print("Config packet to 0x");
+      Serial.print(targetNode, HEX);
+      Serial.println(" failed");
+    }
+
+    return success;
+  }
+
   // Broadcast time sync
   bool broadcastTimeSync(uint32_t timestamp) {
     uint8_t packet[10];
@@ -144,12 +373,17 @@ public:
   void setEnvDataCallback(EnvDataCallback callback) { onEnvData = callback; }
   void setDetectionCallback(DetectionCallback callback) { onDetection = callback; }
   void setAlarmCallback(AlarmCallback callback) { onAlarm = callback; }
+  void setBarographCallback(BarographCallback callback) { onBarograph = callback; }
+  void setAnnounceCallback(AnnounceCallback callback) { onAnnounce = callback; }
+  void setConfigAckCallback(ConfigAckCallback callback) { onConfigAck = callback; }
 
   int16_t getLastRSSI() { return rf95.lastRssi(); }
   int8_t getLastSNR() { return rf95.lastSNR(); }
 
 private:
-  void handleMessage(uint8_t* buf, uint8_t len, uint8_t from, int16_t rssi) {
+  // `entry` is the frame's log record, still to be queued
+  void handleMessage(uint8_t* buf, uint8_t len, uint8_t from, int16_t rssi,
+                     RxLogEntry& entry) {
     if (len < 2) return;
 
     uint8_t packetType = buf[1];
@@ -168,7 +402,19 @@ private:
         break;
 
       case MSG_TYPE_HEARTBEAT:
-        handleHeartbeatPacket(buf, len);
+        handleHeartbeatPacket(buf, len, entry);
+        break;
+
+      case MSG_TYPE_BAROGRAPH:
+        handleBarographPacket(buf, len);
+        break;
+
+      case MSG_TYPE_ANNOUNCE:
+        handleAnnouncePacket(buf, len, from);
+        break;
+
+      case MSG_TYPE_CONFIG:
+        handleConfigPacket(buf, len, from);
         break;
 
       default:
@@ -190,16 +436,6 @@ private:
     int8_t packetRssi;
 
     if (unpackEnvironmentalPacket(buf, &nodeID, &temp, &humidity, &pressure, &batteryMv, &packetRssi)) {
-      Serial.print("Environmental data from 0x");
-      Serial.print(nodeID, HEX);
-      Serial.print(": ");
-      Serial.print(temp, 1);
-      Serial.print("C, ");
-      Serial.print((int)humidity);
-      Serial.print("%, ");
-      Serial.print((int)pressure);
-      Serial.println("hPa");
-
       if (onEnvData) {
         onEnvData(nodeID, temp, humidity, pressure, batteryMv, rssi);
       }
@@ -214,22 +450,12 @@ private:
       return;
     }
 
-    uint8_t nodeID, eventType, confidence, zone;
+    uint8_t nodeID, eventType, confidence, zone, phase;
     uint16_t distance;
 
-    if (unpackDetectionPacket(buf, &nodeID, &eventType, &confidence, &distance, &zone)) {
-      Serial.print("Detection from 0x");
-      Serial.print(nodeID, HEX);
-      Serial.print(": Type=");
-      Serial.print(eventType);
-      Serial.print(", Conf=");
-      Serial.print(confidence);
-      Serial.print("%, Dist=");
-      Serial.print(distance);
-      Serial.println("cm");
-
+    if (unpackDetectionPacket(buf, &nodeID, &eventType, &confidence, &distance, &zone, &phase)) {
       if (onDetection) {
-        onDetection(nodeID, eventType, confidence, distance, zone);
+        onDetection(nodeID, eventType, confidence, distance, zone, phase);
       }
     }
   }
@@ -239,29 +465,75 @@ private:
 
     uint8_t nodeID, command, mode, target;
     if (unpackAlarmPacket(buf, &nodeID, &command, &mode, &target)) {
-      Serial.print("Alarm from 0x");
-      Serial.print(nodeID, HEX);
-      Serial.print(": Cmd=");
-      Serial.println(command);
-
       if (onAlarm) {
         onAlarm(nodeID, command, mode);
       }
     }
   }
 
-  void handleHeartbeatPacket(uint8_t* buf, uint8_t len) {
+  void handleBarographPacket(uint8_t* buf, uint8_t len) {
+    uint8_t nodeID, count;
+    uint16_t samples[BAROGRAPH_HOURS];
+
+    if (unpackBarographPacket(buf, len, &nodeID, samples, &count)) {
+      if (onBarograph) {
+        onBarograph(nodeID, samples, count);
+      }
+    } else {
+      Serial.println("Barograph packet invalid");
+    }
+  }
+
+  void handleAnnouncePacket(uint8_t* buf, uint8_t len, uint8_t from) {
+    uint8_t nodeID, capabilities, fwVersion;
+    char name[ANNOUNCE_NAME_MAX + 1];
+
+    if (!unpackAnnouncePacket(buf, len, &nodeID, &capabilities, &fwVersion, name)) {
+      Serial.println("Announce packet invalid");
+      return;
+    }
+
+    // The radio source address is authoritative; a node cannot claim
+    // someone else's slot
+    if (nodeID != from) {
+      Serial.println("Announce ID mismatch");
+      return;
+    }
+
+    if (onAnnounce) {
+      onAnnounce(nodeID, capabilities, fwVersion, name);
+    }
+  }
+
+  void handleConfigPacket(uint8_t* buf, uint8_t len, uint8_t from) {
+    uint8_t nodeID, target, op, status, entriesLen;
+    uint16_t revision;
+    const uint8_t* entries;
+
+    if (!unpackConfigPacket(buf, len, &nodeID, &target, &op, &revision, &status,
+                            &entries, &entriesLen)) {
+      Serial.println("Config packet invalid");
+      return;
+    }
+
+    // Only ACKs come this way, and only from the node they are about
+    if (op != CONFIG_OP_ACK || nodeID != from || target != hubID) return;
+
+    if (onConfigAck) {
+      onConfigAck(nodeID, status, revision);
+    }
+  }
+
+  // Nothing to dispatch; the battery reading goes out with the frame's
+  // log record
+  void handleHeartbeatPacket(uint8_t* buf, uint8_t len, RxLogEntry& entry) {
     if (len != HEARTBEAT_PACKET_SIZE) return;
 
     uint8_t nodeID;
     uint16_t batteryMv;
 
     if (unpackHeartbeatPacket(buf, &nodeID, &batteryMv)) {
-      Serial.print("Heartbeat from 0x");
-      Serial.print(nodeID, HEX);
-      Serial.print(": Battery=");
-      Serial.print(batteryMv);
-      Serial.println("mV");
+      entry.batteryMv = batteryMv;
     }
   }
 };
@@ -0,0 +1,241 @@
+#ifndef NODE_REGISTRY_H
+#define NODE_REGISTRY_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "../../common/CommonTypes.h"
+#include "../../common/MessageProtocol.h"
+
+/**
+ * Hub Node Registry
+ *
+ * Nodes live in a dense array (so the display and health check iterate only
+ * what exists) and are found through a 256-entry index over the 8-bit LoRa
+ * address space, making find() one table load regardless of node count.
+ *
+ * Nodes join by sending an announce packet with their name and
+ * capabilities; announced nodes are persisted to NVS (namespace "nodes") and
+ * restored on boot. Frames from an address that has never announced get a
+ * provisional entry so their data is not dropped; it becomes permanent once
+ * the node announces, and is dropped by expire() if the address goes quiet
+ * without ever announcing (a neighbour's boat, a corrupted header), so
+ * strays cannot fill the registry.
+ */
+class NodeRegistry {
+private:
+  static const uint8_t NO_SLOT = 0xFF;
+  static const uint8_t RECORD_VERSION = 1;
+
+  // NVS record per persisted node
+  struct Record {
+    uint8_t id;
+    uint8_t capabilities;
+    uint8_t fwVersion;
+    char name[ANNOUNCE_NAME_MAX + 1];
+  };
+
+  NodeInfo nodes[MAX_NODES];
+  bool persisted[MAX_NODES];
+  bool provisional[MAX_NODES];  // created by findOrAdd(), never announced
+  uint8_t count;
+  uint8_t slotOf[256];
+
+  static bool validAddress(uint8_t id) {
+    return id != HUB_ADDRESS && id != BROADCAST_ADDRESS;
+  }
+
+  void initNode(NodeInfo& node, uint8_t id, const String& name) {
+    node.id = id;
+    node.name = name;
+    node.capabilities = 0;
+    node.fwVersion = 0;
+    node.online = false;
+    node.lastContact = 0;
+    node.temperature = 0;
+    node.humidity = 0;
+    node.pressure = 0;
+    node.batteryVoltage = 0;
+    node.rssi = 0;
+    node.state = STATE_INIT;
+    node.barographCount = 0;
+  }
+
+  NodeInfo* insert(uint8_t id, const String& name) {
+    if (!validAddress(id)) return nullptr;
+    if (count >= MAX_NODES) {
+      Serial.println("ERROR: Node registry full");
+      return nullptr;
+    }
+
+    uint8_t slot = count++;
+    initNode(nodes[slot], id, name);
+    persisted[slot] = false;
+    provisional[slot] = false;
+    slotOf[id] = slot;
+    return &nodes[slot];
+  }
+
+  // Swap the last node into the hole to keep the array dense
+  void erase(uint8_t slot) {
+    uint8_t id = nodes[slot].id;
+    uint8_t last = --count;
+    if (slot != last) {
+      nodes[slot] = nodes[last];
+      persisted[slot] = persisted[last];
+      provisional[slot] = provisional[last];
+      slotOf[nodes[slot].id] = slot;
+    }
+    slotOf[id] = NO_SLOT;
+  }
+
+public:
+  NodeRegistry() : count(0) {
+    memset(slotOf, NO_SLOT, sizeof(slotOf));
+    memset(persisted, 0, sizeof(persisted));
+    memset(provisional, 0, sizeof(provisional));
+  }
+
+  // Restore announced nodes from NVS. Returns the number loaded.
+  uint8_t begin() {
+    Preferences prefs;
+    prefs.begin("nodes", true);
+
+    uint8_t stored = 0;
+    Record records[MAX_NODES];
+    if (prefs.getUChar("version", 0) == RECORD_VERSION) {
+      size_t bytes = prefs.getBytes("list", records, sizeof(records));
+      stored = bytes / sizeof(Record);
+    }
+    prefs.end();
+
+    for (uint8_t i = 0; i < stored; i++) {
+      records[i].name[ANNOUNCE_NAME_MAX] = '\0';
+      NodeInfo* node = find(records[i].id);
+      if (!node) node = insert(records[i].id, String(records[i].name));
+      if (!node) continue;
+
+      node->capabilities = records[i].capabilities;
+      node->fwVersion = records[i].fwVersion;
+      persisted[slotOf[node->id]] = true;
+    }
+
+    return stored;
+  }
+
+  // O(1) lookup by LoRa address
+  NodeInfo* find(uint8_t id) {
+    uint8_t slot = slotOf[id];
+    return slot == NO_SLOT ? nullptr : &nodes[slot];
+  }
+
+  // Lookup, creating a provisional (not persisted) entry for a new address.
+  // Any frame keeps a provisional entry alive, not just environmental data.
+  NodeInfo* findOrAdd(uint8_t id) {
+    NodeInfo* node = find(id);
+    if (node) {
+      if (provisional[slotOf[id]]) node->lastContact = millis();
+      return node;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "Node %02X", id);
+    node = insert(id, String(name));
+    if (node) {
+      provisional[slotOf[id]] = true;
+      node->lastContact = millis();
+      Serial.print("New node seen: 0x");
+      Serial.println(id, HEX);
+    }
+    return node;
+  }
+
+  // Register or update a node from its announce and persist it
+  NodeInfo* announce(uint8_t id, const char* name, uint8_t capabilities,
+                     uint8_t fwVersion) {
+    NodeInfo* node = find(id);
+    if (!node) node = insert(id, String(name));
+    if (!node) return nullptr;
+
+    uint8_t slot = slotOf[id];
+    provisional[slot] = false;
+    bool changed = !persisted[slot] || node->name != name ||
+                   node->capabilities != capabilities ||
+                   node->fwVersion != fwVersion;
+
+    node->name = name;
+    node->capabilities = capabilities;
+    node->fwVersion = fwVersion;
+
+    if (changed) {
+      persisted[slot] = true;
+      save();
+      Serial.print("Registered node: 0x");
+      Serial.print(id, HEX);
+      Serial.print(" - ");
+      Serial.println(name);
+    }
+    return node;
+  }
+
+  // Seed a known node (first boot, before any announce has been stored)
+  NodeInfo* add(uint8_t id, const String& name) {
+    NodeInfo* node = find(id);
+    return node ? node : insert(id, name);
+  }
+
+  bool remove(uint8_t id) {
+    uint8_t slot = slotOf[id];
+    if (slot == NO_SLOT) return false;
+
+    erase(slot);
+    save();
+    return true;
+  }
+
+  // Drop provisional entries not heard from for timeout ms. Nothing of
+  // theirs is in NVS, so no save. Returns the number dropped.
+  uint8_t expire(unsigned long now, unsigned long timeout) {
+    uint8_t dropped = 0;
+    for (uint8_t i = count; i-- > 0;) {
+      if (!provisional[i] || now - nodes[i].lastContact <= timeout) continue;
+      Serial.print("Forgetting unannounced node: 0x");
+      Serial.println(nodes[i].id, HEX);
+      erase(i);
+      dropped++;
+    }
+    return dropped;
+  }
+
+  // Write every announced node as one NVS blob
+  bool save() {
+    Record records[MAX_NODES];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (!persisted[i]) continue;
+      memset(&records[n], 0, sizeof(Record));
+      records[n].id = nodes[i].id;
+      records[n].capabilities = nodes[i].capabilities;
+      records[n].fwVersion = nodes[i].fwVersion;
+      strncpy(records[n].name, nodes[i].name.c_str(), ANNOUNCE_NAME_MAX);
+      n++;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin("nodes", false)) return false;
+    prefs.putUChar("version", RECORD_VERSION);
+    size_t written = n ? prefs.putBytes("list", records, n * sizeof(Record))
+                       : (prefs.remove("list"), 0);
+    prefs.end();
+    return written == n * sizeof(Record);
+  }
+
+  NodeInfo* all() { return nodes; }
+  int size() const { return count; }
+  int persistedCount() const {
+    int n = 0;
+    for (uint8_t i = 0; i < count; i++) n += persisted[i];
+    return n;
+  }
+};
+
+#endif // NODE_REGISTRY_H
@@ -0,0 +1,251 @@
+#ifndef REMOTE_CONFIG_H
+#define REMOTE_CONFIG_H
+
+#include <Arduino.h>
+#include "../../common/CommonTypes.h"
+#include "../../common/MessageProtocol.h"
+
+#define REMOTE_CONFIG_JOBS      4      // nodes being configured at once
+#define REMOTE_CONFIG_RETRY_MS  5000   // between attempts of one step
+#define REMOTE_CONFIG_ATTEMPTS  4      // per step before giving up
+#define REMOTE_CONFIG_NO_ANSWER 0x80   // result status: the node never answered
+
+/**
+ * Remote node configuration (loop task only)
+ *
+ * A change for one node runs as a job: QUERY the node's revision, SET the
+ * entries against it, and, if the change touched the node's radio link,
+ * CONFIRM it over the new link so the node keeps it (otherwise the node
+ * rolls back by itself). Each step is retried until the node's ACK
+ * arrives; a STALE answer carries the node's current revision and the SET
+ * is simply sent again against it, since entries are absolute values.
+ *
+ * Jobs only produce packets; poll() hands them to the caller for the TX
+ * queue, and ACKs come back through onAck(). Values are type-checked here
+ * and range-checked by the node, which rejects a change set as a whole.
+ */
+class RemoteConfig {
+public:
+  // status is a CONFIG_* code or REMOTE_CONFIG_NO_ANSWER
+  typedef void (*ResultCallback)(uint8_t nodeID, uint8_t status, uint16_t revision);
+
+private:
+  enum Step : uint8_t { STEP_FREE, STEP_QUERY, STEP_SET, STEP_CONFIRM };
+
+  struct Job {
+    uint8_t step;
+    uint8_t node;              // address the change is sent to
+    uint8_t confirmAt;         // address after the change (it may set nodeID)
+    uint8_t attempts;          // of the current step; 0 = send now
+    uint16_t revision;         // the node's, as last reported
+    unsigned long sentAt;
+    uint8_t entriesLen;
+    uint8_t entries[CONFIG_ENTRIES_MAX];
+  };
+
+  Job jobs[REMOTE_CONFIG_JOBS];
+  ResultCallback onResult;
+
+  Job* findJob(uint8_t nodeID) {
+    for (uint8_t i = 0; i < REMOTE_CONFIG_JOBS; i++) {
+      Job& job = jobs[i];
+      if (job.step != STEP_FREE && (job.node == nodeID || job.confirmAt == nodeID)) {
+        return &job;
+      }
+    }
+    return nullptr;
+  }
+
+  static void next(Job& job, uint8_t step) {
+    job.step = step;
+    job.attempts = 0;
+  }
+
+  void finish(Job& job, uint8_t status) {
+    uint8_t nodeID = job.step == STEP_CONFIRM ? job.confirmAt : job.node;
+    job.step = STEP_FREE;
+    if (onResult) onResult(nodeID, status, job.revision);
+  }
+
+public:
+  RemoteConfig() : onResult(nullptr) {
+    memset(jobs, 0, sizeof(jobs));
+  }
+
+  void setResultCallback(ResultCallback callback) { onResult = callback; }
+
+  // Start a change (no entries: just report the node's revision). False if
+  // the node already has one in flight or every job is busy.
+  bool queue(uint8_t nodeID, const uint8_t* entries, uint8_t len) {
+    if (nodeID == HUB_ADDRESS || nodeID == BROADCAST_ADDRESS) return false;
+    if (len > CONFIG_ENTRIES_MAX || findJob(nodeID)) return false;
+
+    for (uint8_t i = 0; i < REMOTE_CONFIG_JOBS; i++) {
+      Job& job = jobs[i];
+      if (job.step != STEP_FREE) continue;
+
+      job.node = nodeID;
+      job.confirmAt = nodeID;
+      job.revision = 0;
+      job.entriesLen = len;
+      memcpy(job.entries, entries, len);
+
+      uint8_t pos = 0, field, size;
+      const uint8_t* value;
+      while (nextConfigEntry(entries, len, &pos, &field, &size, &value)) {
+        if (field == CFG_NODE_ID && size == 1) job.confirmAt = value[0];
+      }
+
+      next(job, STEP_QUERY);
+      return true;
+    }
+    return false;
+  }
+
+  // Parse "<node hex> [setting=value ...]" from the console and queue it
+  bool queueCommand(char* args, Print& out) {
+    char* save;
+    char* end;
+    char* tok = strtok_r(args, " \t", &save);
+    unsigned long nodeID = tok ? strtoul(tok, &end, 16) : 0;
+    if (!tok || *end || nodeID == HUB_ADDRESS || nodeID >= BROADCAST_ADDRESS) {
+      out.println("usage: config <node hex> [setting=value ...]");
+      return false;
+    }
+
+    uint8_t entries[CONFIG_ENTRIES_MAX];
+    int len = 0;
+    while ((tok = strtok_r(nullptr, " \t", &save)) != nullptr) {
+      char* eq = strchr(tok, '=');
+      if (eq) *eq = '\0';
+      uint8_t field = eq ? configFieldByName(tok) : (uint8_t)CFG_FIELD_COUNT;
+      if (field == CFG_FIELD_COUNT || field == CFG_ALARM_MODE) {
+        out.print("config: unknown setting '");
+        out.print(tok);
+        out.print("'; one of:");
+        for (uint8_t f = 0; f < CFG_FIELD_COUNT; f++) {
+          if (f == CFG_ALARM_MODE) continue;
+          out.print(' ');
+          out.print(configFieldSpec(f).name);
+        }
+        out.println();
+        return false;
+      }
+
+      const char* value = eq + 1;
+      uint8_t type = configFieldSpec(field).type;
+      if (type == CFG_TYPE_TEXT) {
+        len = addConfigText(entries, len, field, value);
+      } else if (type == CFG_TYPE_FLOAT) {
+        float f = strtof(value, &end);
+        len = end != value && !*end ? addConfigFloat(entries, len, field, f) : -1;
+      } else {
+        bool hex = value[0] == '0' && (value[1] == 'x' || value[1] == 'X');
+        unsigned long v = strtoul(value, &end, hex ? 16 : 10);
+        uint8_t size = configValueSize(type);
+        bool fits = size == 4 || (v >> (size * 8)) == 0;
+        len = end != value && !*end && fits ? addConfigEntry(entries, len, field, v) : -1;
+      }
+      if (len < 0) {
+        out.print("config: bad value or too many settings at '");
+        out.print(tok);
+        out.println("'");
+        return false;
+      }
+    }
+
+    if (!queue(nodeID, entries, len)) {
+      out.println("config: a change for that node is already in flight");
+      return false;
+    }
+    return true;
+  }
+
+  // Next packet due, if any: returns its length and sets *target
+  uint8_t poll(unsigned long now, uint8_t* packet, uint8_t* target) {
+    for (uint8_t i = 0; i < REMOTE_CONFIG_JOBS; i++) {
+      Job& job = jobs[i];
+      if (job.step == STEP_FREE) continue;
+      if (job.attempts > 0 && now - job.sentAt < REMOTE_CONFIG_RETRY_MS) continue;
+      if (job.attempts == REMOTE_CONFIG_ATTEMPTS) {
+        finish(job, REMOTE_CONFIG_NO_ANSWER);
+        continue;
+      }
+
+      job.attempts++;
+      job.sentAt = now;
+      switch (job.step) {
+        case STEP_QUERY:
+          *target = job.node;
+          return packConfigPacket(packet, HUB_ADDRESS, job.node, CONFIG_OP_QUERY,
+                                  0, CONFIG_OK, nullptr, 0);
+        case STEP_SET:
+          *target = job.node;
+          return packConfigPacket(packet, HUB_ADDRESS, job.node, CONFIG_OP_SET,
+                                  job.revision, CONFIG_OK, job.entries, job.entriesLen);
+        case STEP_CONFIRM:
+          *target = job.confirmAt;
+          return packConfigPacket(packet, HUB_ADDRESS, job.confirmAt, CONFIG_OP_CONFIRM,
+                                  job.revision, CONFIG_OK, nullptr, 0);
+      }
+    }
+    return 0;
+  }
+
+  // A node's ACK
+  void onAck(uint8_t nodeID, uint8_t status, uint16_t revision) {
+    Job* job = findJob(nodeID);
+    if (!job) {
+      // A rollback long after the job gave up on its CONFIRM
+      if (status == CONFIG_ROLLED_BACK && onResult) onResult(nodeID, status, revision);
+      return;
+    }
+    uint16_t base = job->revision;      // what the SET was sent against
+    job->revision = revision;
+
+    switch (job->step) {
+      case STEP_QUERY:
+        if (job->entriesLen == 0) {
+          finish(*job, status);
+        } else if (status != CONFIG_PENDING) {
+          next(*job, STEP_SET);
+        }
+        // PENDING: another change awaits CONFIRM; ask again on retry
+        break;
+
+      case STEP_SET:
+        if (status == CONFIG_STALE) {
+          next(*job, STEP_SET);         // again, against the revision just reported
+        } else if (status == CONFIG_PENDING ||
+                   (status == CONFIG_BUSY && revision == (uint16_t)(base + 1))) {
+          // BUSY one revision on is our own change on probation: a repeated
+          // SET after its PENDING ACK was lost
+          next(*job, STEP_CONFIRM);
+        } else if (status != CONFIG_BUSY) {
+          finish(*job, status);         // OK, or rejected as a whole
+        }
+        break;
+
+      case STEP_CONFIRM:
+        // A late PENDING is a repeated SET's ACK over the old link
+        if (status != CONFIG_PENDING) finish(*job, status);
+        break;
+    }
+  }
+
+  static const char* statusToString(uint8_t status) {
+    switch (status) {
+      case CONFIG_OK: return "OK";
+      case CONFIG_PENDING: return "awaiting confirm";
+      case CONFIG_STALE: return "stale revision";
+      case CONFIG_BUSY: return "busy";
+      case CONFIG_BAD_FIELD: return "bad setting";
+      case CONFIG_BAD_VALUE: return "bad value";
+      case CONFIG_ROLLED_BACK: return "rolled back";
+      case REMOTE_CONFIG_NO_ANSWER: return "no answer";
+      default: return "unknown";
+    }
+  }
+};
+
+#endif // REMOTE_CONFIG_H
@@ -0,0 +1,95 @@
+#ifndef HUB_EVENT_H
+#define HUB_EVENT_H
+
+#include <Arduino.h>
+#include "../../common/CommonTypes.h"
+#include "../../common/MessageProtocol.h"
+
+/**
+ * Decoded radio events (radio task -> app task) and radio commands
+ * (app task -> radio task). Plain data, copied through SpscRing.
+ */
+
+enum HubEventType : uint8_t {
+  EVT_ENV = 1,
+  EVT_DETECTION,
+  EVT_ALARM,
+  EVT_BAROGRAPH,
+  EVT_ANNOUNCE,
+  EVT_CONFIG_ACK
+};
+
+// Detections and alarms must reach the alarm logic even when a burst of
+// telemetry has backed the queue up; everything else can be resent
+inline bool isUrgentEvent(uint8_t type) {
+  return type == EVT_DETECTION || type == EVT_ALARM;
+}
+
+struct EnvEvent {
+  float temperature;
+  float humidity;
+  float pressure;
+  uint16_t batteryMv;
+  int8_t rssi;
+};
+
+struct DetectionEventMsg {
+  uint8_t eventType;
+  uint8_t confidence;
+  uint16_t distance;
+  uint8_t zone;
+  uint8_t phase;
+};
+
+struct AlarmEventMsg {
+  uint8_t command;
+  uint8_t mode;
+};
+
+struct BarographEvent {
+  uint8_t count;
+  uint16_t samples[BAROGRAPH_HOURS];
+};
+
+struct AnnounceEvent {
+  uint8_t capabilities;
+  uint8_t fwVersion;
+  char name[ANNOUNCE_NAME_MAX + 1];
+};
+
+struct ConfigAckEvent {
+  uint8_t status;
+  uint16_t revision;
+};
+
+struct HubEvent {
+  uint8_t type;              // HubEventType
+  uint8_t nodeID;
+  uint32_t rxMicros;         // when the radio task decoded it
+  union {
+    EnvEvent env;
+    DetectionEventMsg detection;
+    AlarmEventMsg alarm;
+    BarographEvent barograph;
+    AnnounceEvent announce;
+    ConfigAckEvent configAck;
+  };
+};
+
+enum TxCommandType : uint8_t {
+  TX_ALARM_COMMAND = 1,
+  TX_TIME_SYNC,
+  TX_CONFIG
+};
+
+struct TxCommand {
+  uint8_t type;              // TxCommandType
+  uint8_t target;
+  uint8_t command;
+  uint8_t mode;
+  uint32_t timestamp;
+  uint8_t len;               // TX_CONFIG: packed config packet
+  uint8_t payload[CONFIG_MAX_PACKET_SIZE];
+};
+
+#endif // HUB_EVENT_H
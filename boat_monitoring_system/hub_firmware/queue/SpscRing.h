@@ -0,0 +1,77 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Bounded single-producer / single-consumer ring buffer
+ *
+ * Lock-free hand-off between exactly one producer task and one consumer
+ * task (they may run on different cores). push() never blocks: when the
+ * ring is full the item is dropped and counted, so a stalled consumer can
+ * never back-pressure the producer. N must be a power of two. A push can
+ * hold back the last few slots for items the producer ranks higher, since
+ * only the consumer may discard what is already queued.
+ *
+ * head and tail are free-running 16-bit counters; only the producer writes
+ * head and only the consumer writes tail. Metrics are written by the
+ * producer and may be read from anywhere.
+ */
+template <typename T, uint16_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+private:
+  T slots[N];
+  std::atomic<uint16_t> head;   // next slot to write
+  std::atomic<uint16_t> tail;   // next slot to read
+
+  uint32_t pushed;
+  uint32_t dropped;
+  uint16_t highWater;
+
+public:
+  SpscRing() : head(0), tail(0), pushed(0), dropped(0), highWater(0) {}
+
+  // Producer side; refused while fewer than reserve + 1 slots are free
+  bool push(const T& item, uint16_t reserve = 0) {
+    uint16_t h = head.load(std::memory_order_relaxed);
+    uint16_t t = tail.load(std::memory_order_acquire);
+    uint16_t used = h - t;
+
+    if (used + reserve >= N) {
+      dropped++;
+      return false;
+    }
+
+    slots[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+
+    pushed++;
+    if (used + 1 > highWater) highWater = used + 1;
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T& out) {
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    uint16_t h = head.load(std::memory_order_acquire);
+
+    if (h == t) return false;
+
+    out = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint16_t depth() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint16_t capacity() const { return N; }
+  uint16_t getHighWater() const { return highWater; }
+  uint32_t getPushed() const { return pushed; }
+  uint32_t getDropped() const { return dropped; }
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,191 @@
+#ifndef SPI_ARBITER_H
+#define SPI_ARBITER_H
+
+#include <Arduino.h>
+
+// Longest piece a bulk client sends before checking for the radio.
+// 2048 px is ~6 KB of 18-bit pixels, ~1.5 ms at the ILI9488's 40 MHz;
+// one SD sector is ~0.2 ms plus the card's own write time.
+#define SPI_TFT_CHUNK_PIXELS  2048
+#define SPI_SD_CHUNK_BYTES    512
+
+// How often a client stepping aside rechecks whether the radio is done,
+// in case another client took the hand-back signal
+#define SPI_RADIO_POLL_MS     1
+
+enum SpiClient : uint8_t {
+  SPI_CLIENT_RADIO,
+  SPI_CLIENT_DISPLAY,
+  SPI_CLIENT_SD,
+  SPI_CLIENT_COUNT
+};
+
+/**
+ * Arbitration for the SPI bus the RFM95W, ILI9488 and SD card share
+ *
+ * Display and SD work hold the bus for a whole pass (acquire()/release())
+ * but send in bounded chunks and call yieldToRadio() between them. When the
+ * radio task is waiting for the bus, the holder lets go at its next chunk
+ * boundary and waits for the radio to finish, so a radio access waits at
+ * most one chunk rather than a full-screen blit or a multi-sector write.
+ *
+ * The display runs on the loop task, which also handles the alarm and the
+ * buttons, so it uses tryAcquire() and skips a frame rather than wait behind
+ * an SD pass (retention deletes and preallocation can take seconds).
+ *
+ * The radio takes the bus around each register access and around its DIO0
+ * service; those may nest (the mutex is recursive). Bulk clients must not
+ * nest acquire(), or a yield would not free the bus.
+ *
+ * Before begin() every call is a no-op, so setup() can use the devices
+ * directly.
+ */
+class SpiArbiter {
+public:
+  struct Stats {
+    uint32_t radioAccesses;
+    uint32_t radioWaitMaxUs;              // radio asked for the bus until it had it
+    uint32_t yields;                      // bulk passes paused for the radio
+    uint32_t busySkips;                   // tryAcquire() found the bus taken
+    uint32_t chunkMaxUs[SPI_CLIENT_COUNT]; // longest hold between yield points
+  };
+
+private:
+  SemaphoreHandle_t bus;
+  SemaphoreHandle_t radioDone;     // given each time the radio lets go
+  volatile bool radioActive;       // radio wants or holds the bus
+  uint8_t radioDepth;              // radio task only
+  uint32_t radioStart;
+  SpiClient holder;                // bulk client holding the bus
+  uint32_t chunkStart;
+  Stats stats;
+
+  // Bulk clients: take the bus, but never ahead of a waiting radio
+  void takeAfterRadio() {
+    for (;;) {
+      while (radioActive) xSemaphoreTake(radioDone, pdMS_TO_TICKS(SPI_RADIO_POLL_MS));
+      xSemaphoreTakeRecursive(bus, portMAX_DELAY);
+      if (!radioActive) return;
+      xSemaphoreGiveRecursive(bus);  // the radio asked while we waited
+    }
+  }
+
+  void noteChunk(SpiClient client, uint32_t now) {
+    uint32_t held = now - chunkStart;
+    if (held > stats.chunkMaxUs[client]) stats.chunkMaxUs[client] = held;
+    chunkStart = now;
+  }
+
+public:
+  SpiArbiter()
+    : bus(nullptr), radioDone(nullptr), radioActive(false), radioDepth(0),
+      radioStart(0), holder(SPI_CLIENT_DISPLAY), chunkStart(0) {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  void begin() {
+    bus = xSemaphoreCreateRecursiveMutex();
+    radioDone = xSemaphoreCreateBinary();
+  }
+
+  // Radio task: around every register access and DIO0 service
+  void acquireRadio() {
+    if (!bus) return;
+    if (radioDepth++ > 0) {
+      xSemaphoreTakeRecursive(bus, portMAX_DELAY);
+      return;
+    }
+
+    uint32_t start = micros();
+    radioActive = true;
+    xSemaphoreTakeRecursive(bus, portMAX_DELAY);
+    radioStart = micros();
+
+    uint32_t waited = radioStart - start;
+    if (waited > stats.radioWaitMaxUs) stats.radioWaitMaxUs = waited;
+    stats.radioAccesses++;
+  }
+
+  void releaseRadio() {
+    if (!bus) return;
+    if (--radioDepth > 0) {
+      xSemaphoreGiveRecursive(bus);
+      return;
+    }
+
+    uint32_t held = micros() - radioStart;
+    if (held > stats.chunkMaxUs[SPI_CLIENT_RADIO]) stats.chunkMaxUs[SPI_CLIENT_RADIO] = held;
+    radioActive = false;
+    xSemaphoreGiveRecursive(bus);
+    xSemaphoreGive(radioDone);
+  }
+
+  // Display / SD: hold the bus for a pass
+  void acquire(SpiClient client) {
+    if (!bus) return;
+    takeAfterRadio();
+    holder = client;
+    chunkStart = micros();
+  }
+
+  // Display: take the bus only if it is free right now
+  bool tryAcquire(SpiClient client) {
+    if (!bus) return true;
+    if (!radioActive && xSemaphoreTakeRecursive(bus, 0) == pdTRUE) {
+      if (!radioActive) {
+        holder = client;
+        chunkStart = micros();
+        return true;
+      }
+      xSemaphoreGiveRecursive(bus);  // the radio asked in between
+    }
+    stats.busySkips++;
+    return false;
+  }
+
+  void release() {
+    if (!bus) return;
+    noteChunk(holder, micros());
+    xSemaphoreGiveRecursive(bus);
+  }
+
+  // Call between chunks. Hands the bus to a waiting radio and takes it
+  // back once the radio is done; otherwise only records the chunk time.
+  void yieldToRadio() {
+    if (!bus || xSemaphoreGetMutexHolder(bus) != xTaskGetCurrentTaskHandle()) return;
+    noteChunk(holder, micros());
+    if (!radioActive) return;
+
+    SpiClient client = holder;
+    xSemaphoreGiveRecursive(bus);
+    takeAfterRadio();
+    holder = client;
+    chunkStart = micros();
+    stats.yields++;
+  }
+
+  const Stats& getStats() const { return stats; }
+};
+
+/**
+ * Holds the bus for a display or SD pass for the lifetime of the object.
+ * With wait = false it only tries; check held() before using the bus.
+ */
+class SpiLease {
+  SpiArbiter& spi;
+  bool ok;
+
+public:
+  SpiLease(SpiArbiter& arbiter, SpiClient client, bool wait = true)
+    : spi(arbiter), ok(true) {
+    if (wait) spi.acquire(client);
+    else ok = spi.tryAcquire(client);
+  }
+  ~SpiLease() {
+    if (ok) spi.release();
+  }
+
+  bool held() const { return ok; }
+};
+
+#endif // SPI_ARBITER_H
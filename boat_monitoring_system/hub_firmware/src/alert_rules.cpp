@@ -0,0 +1,2 @@
+// Builds lib/common/alert_rules.cpp into the hub sketch (see src/README.md)
+#include "../../../lib/common/alert_rules.cpp"
@@ -0,0 +1,2 @@
+// Builds lib/common/crc8.cpp into the hub sketch (see src/README.md)
+#include "../../../lib/common/crc8.cpp"
@@ -4,18 +4,556 @@
 #include <SD.h>
 #include <SPI.h>
 #include "../../common/CommonTypes.h"
+#include "../../common/MessageProtocol.h"
+#include "../../common/LogFormat.h"
+#include "../clock/RtcClock.h"
+#include "../spi/SpiArbiter.h"
+
+#define LOG_SECTOR_SIZE         512
+#define LOG_COMMIT_INTERVAL_MS  5000   // max age of buffered records
+#define LOG_DIR                 "/logs"
+#define LOG_SPARE_FILE          "/logs/spare.tmp"
+#define LOG_FILE_BLOCKS         256    // block slots per file (1 MB)
+#define LOG_MAX_FILE_SEQ        999    // YYYYMMDD-NNN.bin
+#define LOG_MIN_FREE_BYTES      (64ULL * 1024 * 1024)
 
 /**
  * Data Logger - Logs sensor data and events to SD card
+ *
+ * Writes the binary format in common/LogFormat.h: fixed-width 12-byte
+ * records in 4 KB blocks, each block headed by its time range and node
+ * bitmap. tools/logtool exports the file to CSV and runs time/node queries.
+ *
+ * The current block is assembled in RAM and written to one persistently
+ * open file. As soon as a full sector is pending it is written, so the card
+ * sees whole 512-byte writes. Anything still buffered after
+ * LOG_COMMIT_INTERVAL_MS is written and the file flushed (FAT/size update).
+ * Alarm records flush immediately. When a block fills its header is
+ * finalised and rewritten; closing a file appends the block index.
+ *
+ * Files live in /logs as YYYYMMDD-NNN.bin (UTC date from the DS3231, or
+ * 00000000 while the clock is unset) and rotate at midnight or after
+ * LOG_FILE_BLOCKS blocks. Each file is preallocated at full size, so
+ * appends never extend the FAT chain and seeks stay within a bounded
+ * chain regardless of how long the hub has been logging. The next file is
+ * prepared as a spare in the background, making rotation a rename. When
+ * free space drops below LOG_MIN_FREE_BYTES the oldest files are deleted.
+ *
+ * On power loss at most LOG_COMMIT_INTERVAL_MS of non-alarm records is lost.
+ * Not thread-safe: call everything from the storage task, holding the SPI
+ * bus (SpiLease). Writes go out a sector at a time with a yieldToRadio()
+ * between sectors, so a block commit or preallocation never holds the bus
+ * against the radio for more than one sector.
  */
 class DataLogger {
+public:
+  struct Stats {
+    uint32_t records;
+    uint32_t bytesWritten;
+    uint32_t commits;          // file.write() batches
+    uint32_t flushes;          // file.flush() (directory/FAT update)
+    uint32_t blocks;           // blocks sealed
+    uint32_t rotations;
+    uint32_t filesDeleted;     // removed by the retention policy
+    uint32_t dropped;          // records lost to a write error
+    uint32_t appendMaxUs;      // worst log*() call
+    uint32_t commitMaxUs;      // worst commit, including flush
+  };
+
 private:
   int csPin;
   bool sdAvailable;
+  RtcClock& clock;
+  SpiArbiter& spi;
   String currentLogFile;
+  char currentName[20];        // YYYYMMDD-NNN.bin
+  uint32_t currentDay;         // UTC day the file belongs to, 0 = no clock
+  File file;
+  File spare;
+  bool spareReady;
+  uint16_t boot;
+
+  // Current block; uint32_t storage keeps the header and records aligned
+  uint32_t blockBuf[LOG_BLOCK_SIZE / 4];
+  uint32_t blockSeq;
+  LogIndexEntry index[LOG_FILE_BLOCKS]; // one per block of the open file
+  uint16_t used;               // bytes filled, header included
+  uint16_t committed;          // bytes already handed to the file
+
+  unsigned long oldestPending; // millis() of the oldest uncommitted record
+  Stats stats;
+
+  LogBlockHeader& header() { return *reinterpret_cast<LogBlockHeader*>(blockBuf); }
+  uint8_t* blockBytes() { return reinterpret_cast<uint8_t*>(blockBuf); }
+
+  uint32_t now() { return clock.now(); }
+
+  bool writeAt(uint32_t offset, const uint8_t* data, size_t len) {
+    if (!file.seek(offset)) return false;
+    while (len > 0) {
+      size_t n = min(len, (size_t)SPI_SD_CHUNK_BYTES);
+      size_t written = file.write(data, n);
+      stats.bytesWritten += written;
+      if (written != n) {
+        Serial.println("Log write failed");
+        return false;
+      }
+      spi.yieldToRadio();
+      data += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  // Write block bytes [from, to), starting on a sector boundary so a
+  // partially written tail sector is rewritten whole
+  bool writeBlock(uint16_t from, uint16_t to) {
+    from -= from % LOG_SECTOR_SIZE;
+    if (to <= from) return true;
+    stats.commits++;
+    return writeAt(logBlockOffset(blockSeq) + from, blockBytes() + from, to - from);
+  }
+
+  bool commit(bool all) {
+    if (!file) return false;
+
+    uint32_t start = micros();
+    uint16_t end = all ? used : used - used % LOG_SECTOR_SIZE;
+    bool ok = true;
+    if (end > committed && header().count > 0) {
+      ok = writeBlock(committed, end);
+      if (ok) committed = end;   // a failed range is retried by the next commit
+    }
+
+    if (all) {
+      file.flush();
+      stats.flushes++;
+      oldestPending = ok ? 0 : max(millis(), 1UL);
+    } else if (committed == used) {
+      oldestPending = 0;
+    }
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > stats.commitMaxUs) stats.commitMaxUs = elapsed;
+    return ok;
+  }
+
+  // Record slots of the current block not yet on the card; one cut by the
+  // committed boundary counts as not written
+  uint16_t uncommittedRecords() {
+    uint16_t written = committed > sizeof(LogBlockHeader)
+                         ? (committed - sizeof(LogBlockHeader)) / sizeof(LogRecord)
+                         : 0;
+    return header().count - written;
+  }
+
+  void startBlock() {
+    memset(blockBuf, 0, sizeof(blockBuf));
+    LogBlockHeader& h = header();
+    h.magic = LOG_BLOCK_MAGIC;
+    h.seq = blockSeq;
+    h.boot = boot;
+    used = sizeof(LogBlockHeader);
+    committed = 0;
+  }
+
+  void indexEntry(uint32_t seq, const LogBlockHeader& h) {
+    if (seq >= LOG_FILE_BLOCKS) return;
+    LogIndexEntry& e = index[seq];
+    memset(&e, 0, sizeof(e));
+    e.firstTime = h.firstTime;
+    e.lastTime = h.lastTime;
+    e.count = h.count;
+    e.boot = h.boot;
+    e.typeMask = h.typeMask;
+    e.flags = h.flags;
+  }
+
+  // Finalise the header and write the whole slot (zero padded), so every
+  // sealed block is exactly LOG_BLOCK_SIZE on the card. Records that do not
+  // make it are counted as dropped; if only the header rewrite fails, the
+  // block stays readable as an unsealed one.
+  bool sealBlock() {
+    if (header().count == 0) return true;
+
+    uint32_t start = micros();
+    header().flags |= LOG_BLOCK_SEALED;
+    bool ok = writeBlock(committed, LOG_BLOCK_SIZE);
+    if (!ok) stats.dropped += uncommittedRecords();
+    if (committed >= LOG_SECTOR_SIZE) {
+      ok = writeBlock(0, LOG_SECTOR_SIZE) && ok;
+    }
+    stats.blocks++;
+    indexEntry(blockSeq, header());
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > stats.commitMaxUs) stats.commitMaxUs = elapsed;
+
+    blockSeq++;
+    startBlock();
+    return ok;
+  }
+
+  // Claim n consecutive record slots stamped `time`, sealing the current
+  // block first if they do not fit or would overflow its 16-bit dt
+  LogRecord* reserve(uint16_t n, uint8_t type, uint8_t nodeID, uint32_t time) {
+    if (!sdAvailable) return nullptr;
+
+    LogBlockHeader& h = header();
+    if (h.count > 0 &&
+        (used + n * sizeof(LogRecord) > LOG_BLOCK_SIZE ||
+         time < h.firstTime || time - h.firstTime > 0xFFFF)) {
+      sealBlock();
+    }
+    if (blockSeq >= LOG_FILE_BLOCKS) {
+      rotate();
+      if (!sdAvailable) return nullptr;
+    }
+
+    if (h.count == 0) h.firstTime = time;
+    h.lastTime = time;
+    h.count += n;
+    h.typeMask |= 1 << type;
+    h.nodes[nodeID >> 5] |= 1UL << (nodeID & 31);
+
+    LogRecord* r = reinterpret_cast<LogRecord*>(blockBytes() + used);
+    for (uint16_t i = 0; i < n; i++) {
+      r[i].dt = time - h.firstTime;
+      r[i].type = i == 0 ? type : (uint8_t)LOG_REC_TEXT_MORE;
+      r[i].node = nodeID;
+    }
+    used += n * sizeof(LogRecord);
+    return r;
+  }
+
+  // Called after each record is filled in
+  void appended(uint32_t startUs) {
+    stats.records++;
+    if (oldestPending == 0) oldestPending = max(millis(), 1UL);
+
+    if (used - committed >= LOG_SECTOR_SIZE) {
+      commit(false);
+    }
+    if (used + sizeof(LogRecord) > LOG_BLOCK_SIZE) {
+      sealBlock();
+    }
+
+    uint32_t elapsed = micros() - startUs;
+    if (elapsed > stats.appendMaxUs) stats.appendMaxUs = elapsed;
+  }
+
+  void logText(uint8_t type, uint8_t nodeID, const char* text) {
+    uint32_t start = micros();
+    size_t length = strlen(text);
+    if (length > 255) length = 255;
+
+    LogRecord* r = reserve(logTextRecords(length), type, nodeID, now());
+    if (!r) return;
+
+    r[0].text.length = length;
+    size_t first = min(length, (size_t)LOG_TEXT_FIRST_BYTES);
+    memcpy(r[0].text.text, text, first);
+    for (size_t pos = first, i = 1; pos < length; pos += LOG_TEXT_MORE_BYTES, i++) {
+      memcpy(r[i].more, text + pos, min(length - pos, (size_t)LOG_TEXT_MORE_BYTES));
+    }
+    appended(start);
+  }
+
+  bool readAt(uint32_t offset, void* data, size_t len) {
+    return file.seek(offset) && file.read((uint8_t*)data, len) == len;
+  }
+
+  // Overwrite [from, to) with zeros
+  void zeroRange(uint32_t from, uint32_t to) {
+    memset(blockBuf, 0, sizeof(blockBuf));
+    while (from < to) {
+      uint32_t n = min(to - from, (uint32_t)LOG_BLOCK_SIZE);
+      writeAt(from, blockBytes(), n);
+      from += n;
+    }
+  }
+
+  // Preallocated size: LOG_FILE_BLOCKS slots plus room for the index
+  static uint32_t fileBytes() {
+    uint32_t index = LOG_FILE_BLOCKS * sizeof(LogIndexEntry) + sizeof(LogIndexFooter);
+    return logBlockOffset(LOG_FILE_BLOCKS) +
+           (index + LOG_SECTOR_SIZE - 1) / LOG_SECTOR_SIZE * LOG_SECTOR_SIZE;
+  }
+
+  // Append zeros to f until it reaches `size` or maxBytes have been written
+  bool extend(File& f, uint32_t size, uint32_t maxBytes) {
+    static const uint8_t zeros[LOG_SECTOR_SIZE] = {0};
+    uint32_t pos = f.size();
+    while (pos < size && maxBytes >= LOG_SECTOR_SIZE) {
+      uint32_t n = min(size - pos, (uint32_t)LOG_SECTOR_SIZE);
+      if (f.write(zeros, n) != n) return false;
+      spi.yieldToRadio();
+      pos += n;
+      maxBytes -= n;
+    }
+    return true;
+  }
+
+  uint32_t today() {
+    return clock.valid() ? clock.now() / 86400 : 0;
+  }
+
+  // Oldest log other than the open one, and the newest with the given
+  // date prefix. Either is left empty if there is none.
+  void scanLogs(const char* prefix, char* oldest, char* newest) {
+    oldest[0] = newest[0] = '\0';
+    File dir = SD.open(LOG_DIR);
+    if (!dir) return;
+
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+      const char* name = f.name();
+      const char* slash = strrchr(name, '/');
+      if (slash) name = slash + 1;
+      if (f.isDirectory() || !isLogName(name)) continue;
+
+      if (strcmp(name, currentName) != 0 &&
+          (!oldest[0] || strcmp(name, oldest) < 0)) {
+        strcpy(oldest, name);
+      }
+      if (strncmp(name, prefix, 8) == 0 && strcmp(name, newest) > 0) {
+        strcpy(newest, name);
+      }
+    }
+    dir.close();
+  }
+
+  // Delete the oldest logs until LOG_MIN_FREE_BYTES is free
+  void enforceRetention() {
+    char oldest[20], newest[20];
+    while (SD.totalBytes() - SD.usedBytes() < LOG_MIN_FREE_BYTES) {
+      scanLogs("", oldest, newest);
+      if (!oldest[0]) break;
+
+      String path = String(LOG_DIR "/") + oldest;
+      if (!SD.remove(path)) break;
+      stats.filesDeleted++;
+      Serial.print("Log retention: deleted ");
+      Serial.println(path);
+    }
+  }
+
+  // Grow the spare file a little at a time from process(), so rotation
+  // only has to rename it instead of preallocating a whole file
+  void prepareSpare() {
+    if (spareReady) return;
+    if (!spare) {
+      spare = SD.open(LOG_SPARE_FILE, FILE_APPEND);
+      if (!spare) return;
+    }
+    if (!extend(spare, fileBytes(), LOG_BLOCK_SIZE)) {
+      spare.close();
+      return;
+    }
+    if (spare.size() >= fileBytes()) {
+      spare.close();
+      spareReady = true;
+    }
+  }
+
+  // Create a preallocated, zeroed log file with a fresh header
+  bool createFile(const String& path) {
+    if (spare) spare.close();
+    if (spareReady && SD.rename(LOG_SPARE_FILE, path)) {
+      spareReady = false;
+    } else {
+      // No spare yet: preallocate in place (blocks this task for a while)
+      File f = SD.open(path, FILE_WRITE);
+      if (!f) return false;
+      bool ok = extend(f, fileBytes(), UINT32_MAX);
+      f.close();
+      if (!ok) return false;
+    }
+
+    File f = SD.open(path, "r+");
+    if (!f) return false;
+
+    uint8_t sector[LOG_FILE_HEADER_SIZE];
+    memset(sector, 0, sizeof(sector));
+    LogFileHeader* fh = reinterpret_cast<LogFileHeader*>(sector);
+    strncpy(fh->magic, LOG_FILE_MAGIC, sizeof(fh->magic));
+    fh->version = LOG_FORMAT_VERSION;
+    fh->headerSize = LOG_FILE_HEADER_SIZE;
+    fh->blockSize = LOG_BLOCK_SIZE;
+    fh->recordSize = sizeof(LogRecord);
+    fh->boot = 0;
+    bool ok = f.write(sector, sizeof(sector)) == sizeof(sector);
+    f.close();
+    return ok;
+  }
+
+  // Index entries for blocks written before a reboot, from their headers
+  void rebuildIndex() {
+    LogBlockHeader h;
+    for (uint32_t seq = 0; seq < blockSeq; seq++) {
+      if (readAt(logBlockOffset(seq), &h, sizeof(h)) && h.magic == LOG_BLOCK_MAGIC) {
+        indexEntry(seq, h);
+      } else {
+        memset(&index[seq], 0, sizeof(LogIndexEntry));
+      }
+    }
+  }
+
+  bool validSlot(uint32_t seq) {
+    uint32_t magic;
+    return readAt(logBlockOffset(seq), &magic, sizeof(magic)) &&
+           magic == LOG_BLOCK_MAGIC;
+  }
+
+  // Reopen for positional writes and find where the next block goes:
+  // after the last used slot, clearing a trailing index if present. A full
+  // file is closed again untouched and false returned.
+  bool openFile(const String& path) {
+    file = SD.open(path, "r+");
+    if (!file) return false;
+
+    LogFileHeader fh;
+    if (!readAt(0, &fh, sizeof(fh)) ||
+        strncmp(fh.magic, LOG_FILE_MAGIC, sizeof(fh.magic)) != 0 ||
+        fh.version != LOG_FORMAT_VERSION || fh.blockSize != LOG_BLOCK_SIZE ||
+        fh.recordSize != sizeof(LogRecord)) {
+      Serial.println("Log file has an unknown format");
+      file.close();
+      return false;
+    }
+
+    uint32_t size = file.size();
+    LogIndexFooter footer;
+    bool closed = size >= LOG_FILE_HEADER_SIZE + sizeof(footer) &&
+                  readAt(size - sizeof(footer), &footer, sizeof(footer)) &&
+                  footer.magic == LOG_INDEX_MAGIC &&
+                  footer.indexOffset == logBlockOffset(footer.blockCount);
+    if (closed) {
+      blockSeq = min(footer.blockCount, (uint32_t)LOG_FILE_BLOCKS);
+    } else {
+      // Used slots form a prefix, so binary search for the first free one.
+      // An unsealed block left by power loss stays as it is; readers find
+      // its end by the first empty record.
+      uint32_t lo = 0;
+      uint32_t hi = size > LOG_FILE_HEADER_SIZE
+                      ? (size - LOG_FILE_HEADER_SIZE + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE
+                      : 0;
+      if (hi > LOG_FILE_BLOCKS) hi = LOG_FILE_BLOCKS;
+      while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (validSlot(mid)) lo = mid + 1;
+        else hi = mid;
+      }
+      blockSeq = lo;
+    }
+    if (blockSeq >= LOG_FILE_BLOCKS) {
+      file.close();
+      return false;
+    }
+
+    boot = fh.boot + 1;
+    fh.boot = boot;
+    writeAt(0, (const uint8_t*)&fh, sizeof(fh));
+
+    if (closed) {
+      // Reload the index, then clear it and the footer
+      if (!readAt(footer.indexOffset, index, blockSeq * sizeof(LogIndexEntry))) {
+        rebuildIndex();
+      }
+      zeroRange(footer.indexOffset,
+                footer.indexOffset + footer.blockCount * sizeof(LogIndexEntry));
+      zeroRange(size - sizeof(footer), size);
+    } else {
+      rebuildIndex();
+
+      // A file that was not preallocated may end inside the last slot
+      uint32_t blockStart = logBlockOffset(blockSeq);
+      if (size < blockStart) zeroRange(size, blockStart);
+    }
+
+    file.flush();
+    currentLogFile = path;
+    return true;
+  }
+
+  // Open today's newest log, or start the next one if there is none, it
+  // is full, or forceNew is set
+  bool openLog(bool forceNew) {
+    uint32_t day = today();
+    char prefix[12], oldest[20], newest[20];
+    datePrefix(day, prefix, sizeof(prefix));
+    scanLogs(prefix, oldest, newest);
+
+    // Without a clock, times restart at every boot; always use a new file
+    if (newest[0] && !forceNew && day != 0 &&
+        openFile(String(LOG_DIR "/") + newest)) {
+      strcpy(currentName, newest);
+      currentDay = day;
+      return true;
+    }
+
+    // Three digits: past -999 the next name would overwrite -000
+    unsigned seq = newest[0] ? atoi(newest + 9) + 1 : 0;
+    if (seq > LOG_MAX_FILE_SEQ) {
+      Serial.print("No log file names left for ");
+      Serial.println(prefix);
+      currentName[0] = '\0';
+      return false;
+    }
+    snprintf(currentName, sizeof(currentName), "%s-%03u.bin", prefix, seq);
+    String path = String(LOG_DIR "/") + currentName;
+
+    if (!createFile(path) || !openFile(path)) {
+      currentName[0] = '\0';
+      return false;
+    }
+    currentDay = day;
+    Serial.print("Logging to ");
+    Serial.println(path);
+    return true;
+  }
+
+  // Close the current file with its index and continue in a new one
+  void rotate() {
+    writeIndex();
+    file.close();
+    stats.rotations++;
+
+    enforceRetention();
+    if (!openLog(true)) {
+      Serial.println("Log rotation failed - logging disabled");
+      sdAvailable = false;
+      return;
+    }
+    startBlock();
+  }
 
 public:
-  DataLogger(int cs) : csPin(cs), sdAvailable(false) {}
+  // "YYYYMMDD" for a day number; 00000000 while the clock is unset
+  static void datePrefix(uint32_t day, char* out, size_t size) {
+    uint16_t y = 0;
+    uint8_t m = 0, d = 0;
+    if (day) RtcClock::civil(day * 86400, y, m, d);
+    snprintf(out, size, "%04u%02u%02u", y, m, d);
+  }
+
+  // Log files are named YYYYMMDD-NNN.bin, so name order is age order
+  static bool isLogName(const char* name) {
+    if (strlen(name) != 16 || name[8] != '-' || strcmp(name + 12, ".bin") != 0) {
+      return false;
+    }
+    for (uint8_t i = 0; i < 12; i++) {
+      if (i != 8 && !isdigit((unsigned char)name[i])) return false;
+    }
+    return true;
+  }
+
+  DataLogger(int cs, RtcClock& rtc, SpiArbiter& arbiter)
+    : csPin(cs), sdAvailable(false), clock(rtc), spi(arbiter), currentDay(0),
+      spareReady(false), boot(0), blockSeq(0), used(0), committed(0),
+      oldestPending(0) {
+    currentName[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+  }
 
   bool begin() {
     if (!SD.begin(csPin)) {
@@ -25,95 +563,126 @@ public:
     }
 
     Serial.println("SD card initialized");
-    sdAvailable = true;
+    if (!SD.exists(LOG_DIR)) SD.mkdir(LOG_DIR);
 
-    // Create log file with current date (if RTC available)
-    currentLogFile = "/boat_log.csv";
+    File f = SD.open(LOG_SPARE_FILE);
+    spareReady = f && f.size() >= fileBytes();
+    if (f) f.close();
 
-    // Create header if new file
-    if (!SD.exists(currentLogFile)) {
-      File file = SD.open(currentLogFile, FILE_WRITE);
-      if (file) {
-        file.println("Timestamp,NodeID,Type,Temperature,Humidity,Pressure,BatteryMv,RSSI");
-        file.close();
-        Serial.println("Created new log file");
-      }
+    enforceRetention();
+
+    // Opened once and kept open; every commit writes through this handle
+    if (!openLog(false)) {
+      Serial.println("Log file open failed");
+      sdAvailable = false;
+      return false;
     }
 
+    startBlock();
+    sdAvailable = true;
     return true;
   }
 
   void logEnvironmental(uint8_t nodeID, float temp, float humidity, float pressure,
                        uint16_t batteryMv, int16_t rssi) {
-    if (!sdAvailable) return;
+    uint32_t start = micros();
+    LogRecord* r = reserve(1, LOG_REC_ENV, nodeID, now());
+    if (!r) return;
 
-    File file = SD.open(currentLogFile, FILE_APPEND);
-    if (file) {
-      file.print(millis() / 1000); // Timestamp in seconds
-      file.print(",");
-      file.print(nodeID, HEX);
-      file.print(",ENV,");
-      file.print(temp, 2);
-      file.print(",");
-      file.print(humidity, 1);
-      file.print(",");
-      file.print(pressure, 1);
-      file.print(",");
-      file.print(batteryMv);
-      file.print(",");
-      file.println(rssi);
-      file.close();
-    }
+    r->env.tempC100 = (int16_t)lroundf(constrain(temp, -300.0f, 300.0f) * 100);
+    r->env.pressure10 = (uint16_t)lroundf(constrain(pressure, 0.0f, 6500.0f) * 10);
+    r->env.batteryMv = batteryMv;
+    r->env.humidity2 = (uint8_t)lroundf(constrain(humidity, 0.0f, 100.0f) * 2);
+    r->env.rssi = (int8_t)constrain(rssi, -128, 127);
+    appended(start);
   }
 
   void logDetection(uint8_t nodeID, uint8_t eventType, uint8_t confidence,
                    uint16_t distance, uint8_t zone) {
-    if (!sdAvailable) return;
+    uint32_t start = micros();
+    LogRecord* r = reserve(1, LOG_REC_DETECT, nodeID, now());
+    if (!r) return;
 
-    File file = SD.open(currentLogFile, FILE_APPEND);
-    if (file) {
-      file.print(millis() / 1000);
-      file.print(",");
-      file.print(nodeID, HEX);
-      file.print(",DETECT,");
-      file.print(eventType);
-      file.print(",");
-      file.print(confidence);
-      file.print(",");
-      file.print(distance);
-      file.print(",");
-      file.println(zone);
-      file.close();
-    }
+    r->detect.eventType = eventType;
+    r->detect.confidence = confidence;
+    r->detect.distance = distance;
+    r->detect.zone = zone;
+    appended(start);
   }
 
+  // Alarms are flushed straight through for durability
   void logAlarm(uint8_t nodeID, const char* event) {
+    logText(LOG_REC_ALARM, nodeID, event);
+    flush();
+  }
+
+  void logEvent(const char* event) {
+    logText(LOG_REC_EVENT, HUB_ADDRESS, event);
+  }
+
+  // Call periodically: commits records older than LOG_COMMIT_INTERVAL_MS,
+  // rotates at midnight and grows the spare file
+  void process() {
     if (!sdAvailable) return;
 
-    File file = SD.open(currentLogFile, FILE_APPEND);
-    if (file) {
-      file.print(millis() / 1000);
-      file.print(",");
-      file.print(nodeID, HEX);
-      file.print(",ALARM,");
-      file.println(event);
-      file.close();
+    if (today() != currentDay) {
+      rotate();
+      return;
+    }
+    if (oldestPending != 0 && millis() - oldestPending >= LOG_COMMIT_INTERVAL_MS) {
+      commit(true);
+      return;
     }
+    prepareSpare();
   }
 
-  void logEvent(const char* event) {
-    if (!sdAvailable) return;
+  // Write everything buffered and update the directory entry
+  bool flush() {
+    if (!sdAvailable) return false;
+    return commit(true);
+  }
 
-    File file = SD.open(currentLogFile, FILE_APPEND);
-    if (file) {
-      file.print(millis() / 1000);
-      file.print(",HUB,EVENT,");
-      file.println(event);
-      file.close();
+  // Seal the last block and write the index (kept in RAM as blocks seal)
+  // after it, with the footer in the file's last 16 bytes, so readers can
+  // seek by time without walking every block
+  bool writeIndex() {
+    if (!sdAvailable) return false;
+    bool ok = sealBlock();
+
+    LogIndexFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.magic = LOG_INDEX_MAGIC;
+    footer.blockCount = blockSeq;
+    footer.indexOffset = logBlockOffset(blockSeq);
+
+    uint32_t offset = footer.indexOffset;
+    if (blockSeq > 0) {
+      ok = writeAt(offset, (const uint8_t*)index,
+                   blockSeq * sizeof(LogIndexEntry)) && ok;
+      offset += blockSeq * sizeof(LogIndexEntry);
     }
+
+    uint32_t size = file.size();
+    if (size >= offset + sizeof(footer)) offset = size - sizeof(footer);
+    ok = writeAt(offset, (const uint8_t*)&footer, sizeof(footer)) && ok;
+    file.flush();
+    stats.flushes++;
+    startBlock();
+    return ok;
+  }
+
+  void end() {
+    if (!sdAvailable) return;
+    writeIndex();
+    file.close();
+    if (spare) spare.close();
+    sdAvailable = false;
   }
 
   bool isAvailable() const { return sdAvailable; }
+  const char* getFileName() const { return currentName; }
+  uint16_t getBuffered() const { return used > committed ? used - committed : 0; }
+  const Stats& getStats() const { return stats; }
 };
 
 #endif // DATA_LOGGER_H
@@ -0,0 +1,115 @@
+#ifndef LOG_QUEUE_H
+#define LOG_QUEUE_H
+
+#include <Arduino.h>
+#include "DataLogger.h"
+#include "../queue/SpscRing.h"
+
+#define LOG_QUEUE_DEPTH 32
+#define LOG_TEXT_MAX    48
+
+/**
+ * Log Queue - hands log records from the app task to the storage task
+ *
+ * Same calls as DataLogger, but each one only copies a record into an
+ * SPSC ring; the storage task calls drainTo() and does the SD writes, so a
+ * slow card never stalls event handling. Records are dropped (and counted)
+ * if the card falls LOG_QUEUE_DEPTH records behind.
+ */
+class LogQueue {
+private:
+  enum Kind : uint8_t { LOG_ENV, LOG_DETECTION, LOG_ALARM, LOG_EVENT };
+
+  struct Record {
+    uint8_t kind;
+    uint8_t nodeID;
+    union {
+      struct {
+        float temperature;
+        float humidity;
+        float pressure;
+        uint16_t batteryMv;
+        int16_t rssi;
+      } env;
+      struct {
+        uint8_t eventType;
+        uint8_t confidence;
+        uint16_t distance;
+        uint8_t zone;
+      } detection;
+    };
+    char text[LOG_TEXT_MAX];
+  };
+
+  SpscRing<Record, LOG_QUEUE_DEPTH> ring;
+
+  void pushText(uint8_t kind, uint8_t nodeID, const char* text) {
+    Record r;
+    r.kind = kind;
+    r.nodeID = nodeID;
+    strncpy(r.text, text, LOG_TEXT_MAX - 1);
+    r.text[LOG_TEXT_MAX - 1] = '\0';
+    ring.push(r);
+  }
+
+public:
+  void logEnvironmental(uint8_t nodeID, float temp, float humidity, float pressure,
+                        uint16_t batteryMv, int16_t rssi) {
+    Record r;
+    r.kind = LOG_ENV;
+    r.nodeID = nodeID;
+    r.env.temperature = temp;
+    r.env.humidity = humidity;
+    r.env.pressure = pressure;
+    r.env.batteryMv = batteryMv;
+    r.env.rssi = rssi;
+    ring.push(r);
+  }
+
+  void logDetection(uint8_t nodeID, uint8_t eventType, uint8_t confidence,
+                    uint16_t distance, uint8_t zone) {
+    Record r;
+    r.kind = LOG_DETECTION;
+    r.nodeID = nodeID;
+    r.detection.eventType = eventType;
+    r.detection.confidence = confidence;
+    r.detection.distance = distance;
+    r.detection.zone = zone;
+    ring.push(r);
+  }
+
+  void logAlarm(uint8_t nodeID, const char* event) { pushText(LOG_ALARM, nodeID, event); }
+  void logEvent(const char* event) { pushText(LOG_EVENT, 0, event); }
+
+  // Storage task: write everything queued. Returns the number written.
+  uint16_t drainTo(DataLogger& logger) {
+    uint16_t n = 0;
+    Record r;
+    while (ring.pop(r)) {
+      switch (r.kind) {
+        case LOG_ENV:
+          logger.logEnvironmental(r.nodeID, r.env.temperature, r.env.humidity,
+                                  r.env.pressure, r.env.batteryMv, r.env.rssi);
+          break;
+        case LOG_DETECTION:
+          logger.logDetection(r.nodeID, r.detection.eventType, r.detection.confidence,
+                              r.detection.distance, r.detection.zone);
+          break;
+        case LOG_ALARM:
+          logger.logAlarm(r.nodeID, r.text);
+          break;
+        case LOG_EVENT:
+          logger.logEvent(r.text);
+          break;
+      }
+      n++;
+    }
+    return n;
+  }
+
+  uint16_t depth() const { return ring.depth(); }
+  uint16_t getHighWater() const { return ring.getHighWater(); }
+  uint32_t getDropped() const { return ring.getDropped(); }
+};
+
+#endif // LOG_QUEUE_H
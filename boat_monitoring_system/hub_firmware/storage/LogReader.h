@@ -0,0 +1,98 @@
+#ifndef LOG_READER_H
+#define LOG_READER_H
+
+#include <SD.h>
+#include "../../common/LogFormat.h"
+
+/**
+ * Log Reader - block-at-a-time reader for the files DataLogger writes
+ *
+ * open() validates the file header and finds the block count from the
+ * trailing index, or by walking block headers if the file was not closed.
+ * readBlock() loads one 4 KB block with a single read and returns its
+ * header and usable record count (unsealed blocks end at the first empty
+ * record). The buffer is a member, so allocate readers on the heap.
+ */
+class LogReader {
+private:
+  File file;
+  uint32_t blockCount;
+  uint32_t buf[LOG_BLOCK_SIZE / 4];
+
+  bool readAt(uint32_t offset, void* data, size_t len) {
+    return file.seek(offset) && file.read((uint8_t*)data, len) == len;
+  }
+
+public:
+  LogReader() : blockCount(0) {}
+  ~LogReader() { close(); }
+
+  bool open(const char* path) {
+    close();
+    file = SD.open(path, FILE_READ);
+    if (!file) return false;
+
+    LogFileHeader fh;
+    if (!readAt(0, &fh, sizeof(fh)) ||
+        strncmp(fh.magic, LOG_FILE_MAGIC, sizeof(fh.magic)) != 0 ||
+        fh.version != LOG_FORMAT_VERSION || fh.blockSize != LOG_BLOCK_SIZE ||
+        fh.recordSize != sizeof(LogRecord)) {
+      close();
+      return false;
+    }
+
+    uint32_t size = file.size();
+    LogIndexFooter footer;
+    if (size >= LOG_FILE_HEADER_SIZE + sizeof(footer) &&
+        readAt(size - sizeof(footer), &footer, sizeof(footer)) &&
+        footer.magic == LOG_INDEX_MAGIC &&
+        footer.indexOffset == logBlockOffset(footer.blockCount)) {
+      blockCount = footer.blockCount;
+    } else {
+      uint32_t magic;
+      blockCount = 0;
+      while (logBlockOffset(blockCount) + sizeof(LogBlockHeader) <= size &&
+             readAt(logBlockOffset(blockCount), &magic, sizeof(magic)) &&
+             magic == LOG_BLOCK_MAGIC) {
+        blockCount++;
+      }
+    }
+    return true;
+  }
+
+  void close() {
+    if (file) file.close();
+    blockCount = 0;
+  }
+
+  uint32_t getBlockCount() const { return blockCount; }
+
+  // Load block `seq`. Returns false for a slot that is unreadable or empty.
+  bool readBlock(uint32_t seq, const LogBlockHeader*& header,
+                 const LogRecord*& records, uint16_t& count) {
+    if (seq >= blockCount) return false;
+
+    uint32_t size = file.size();
+    uint32_t offset = logBlockOffset(seq);
+    uint32_t len = size - offset < LOG_BLOCK_SIZE ? size - offset : LOG_BLOCK_SIZE;
+    if (!readAt(offset, buf, len)) return false;
+    if (len < LOG_BLOCK_SIZE) memset((uint8_t*)buf + len, 0, LOG_BLOCK_SIZE - len);
+
+    header = reinterpret_cast<const LogBlockHeader*>(buf);
+    if (header->magic != LOG_BLOCK_MAGIC) return false;
+    records = reinterpret_cast<const LogRecord*>((const uint8_t*)buf + sizeof(LogBlockHeader));
+
+    if (header->flags & LOG_BLOCK_SEALED) {
+      count = header->count;
+    } else {
+      count = 0;
+      while (count < LOG_RECORDS_PER_BLOCK && records[count].type != LOG_REC_EMPTY) {
+        count++;
+      }
+    }
+    if (count > LOG_RECORDS_PER_BLOCK) count = LOG_RECORDS_PER_BLOCK;
+    return true;
+  }
+};
+
+#endif // LOG_READER_H
@@ -2,51 +2,135 @@
 #define NODE_CONFIG_H
 
 #include <Preferences.h>
+#include <stddef.h>
 #include "../../common/CommonTypes.h"
+#include "../../common/MessageProtocol.h"
+#include "../../../lib/common/alarm_journal.h"
+#include "../../../lib/common/crc8.h"
 
-/**
- * Node Configuration Manager
- * Stores and manages node settings in non-volatile storage (NVS)
- */
-class NodeConfig {
-private:
-  Preferences prefs;
-  const char* NAMESPACE = "boat-node";
+#define CONFIG_BLOB_VERSION     2
+#define CONFIG_NAME_MAX         23
+#define CONFIG_COMMIT_DELAY_MS  5000   // coalesce changes this long before writing
+#define CONFIG_PROBATION_MS     120000 // a remote radio change must be confirmed within this
 
-public:
-  // Node identity
+// Fields that can cut the node off from the hub if set wrong
+#define CONFIG_LINK_FIELDS \
+  ((1UL << CFG_NODE_ID) | (1UL << CFG_HUB_ID) | (1UL << CFG_LORA_FREQ) | \
+   (1UL << CFG_LORA_POWER) | (1UL << CFG_LORA_SF))
+
+// The settings as stored: one NVS blob, read with a single getBytes().
+// Version 1 was the same without the revision.
+struct __attribute__((packed)) ConfigBlob {
+  uint8_t version;
   uint8_t nodeID;
   uint8_t hubID;
-  String nodeName;
-
-  // Alarm settings
-  AlarmMode alarmMode;
-  uint8_t detectionSensitivity;    // 0-100 (affects min confidence)
-  bool quietHoursEnabled;
-  uint8_t quietHourStart;          // 0-23 hour
-  uint8_t quietHourEnd;            // 0-23 hour
-
-  // Detection zones (in cm)
+  char nodeName[CONFIG_NAME_MAX + 1];
+  uint8_t alarmMode;
+  uint8_t detectionSensitivity;
+  uint8_t quietHoursEnabled;
+  uint8_t quietHourStart;
+  uint8_t quietHourEnd;
   uint16_t nearZoneMax;
   uint16_t middleZoneMax;
   uint16_t farZoneMax;
+  uint8_t displayBrightness;
+  uint16_t displayTimeout;
+  uint8_t temperatureFahrenheit;
+  float loraFrequency;
+  uint8_t loraTxPower;
+  uint8_t loraSpreadingFactor;
+  uint32_t envDataInterval;
+  uint32_t heartbeatInterval;
+  uint16_t revision;               // remote config revision
+  uint8_t crc;                     // over everything above
+};
 
-  // Display settings
-  uint8_t displayBrightness;       // 0-255
-  uint16_t displayTimeout;         // seconds
-  bool temperatureFahrenheit;      // true=F, false=C
+struct ConfigFieldInfo {
+  uint8_t offset;                  // in ConfigBlob
+  uint8_t size;
+};
 
-  // LoRa settings
-  float loraFrequency;             // MHz
-  uint8_t loraTxPower;             // dBm
-  uint8_t loraSpreadingFactor;     // 7-12
+#define CONFIG_FIELD(member) \
+  { offsetof(ConfigBlob, member), sizeof(((ConfigBlob*)0)->member) }
 
-  // Timing
-  uint32_t envDataInterval;        // milliseconds between env data transmissions
-  uint32_t heartbeatInterval;      // milliseconds between heartbeats
+inline const ConfigFieldInfo& configField(ConfigField field) {
+  static const ConfigFieldInfo fields[CFG_FIELD_COUNT] = {
+    CONFIG_FIELD(nodeID),
+    CONFIG_FIELD(hubID),
+    CONFIG_FIELD(nodeName),
+    CONFIG_FIELD(alarmMode),
+    CONFIG_FIELD(detectionSensitivity),
+    CONFIG_FIELD(quietHoursEnabled),
+    CONFIG_FIELD(quietHourStart),
+    CONFIG_FIELD(quietHourEnd),
+    CONFIG_FIELD(nearZoneMax),
+    CONFIG_FIELD(middleZoneMax),
+    CONFIG_FIELD(farZoneMax),
+    CONFIG_FIELD(displayBrightness),
+    CONFIG_FIELD(displayTimeout),
+    CONFIG_FIELD(temperatureFahrenheit),
+    CONFIG_FIELD(loraFrequency),
+    CONFIG_FIELD(loraTxPower),
+    CONFIG_FIELD(loraSpreadingFactor),
+    CONFIG_FIELD(envDataInterval),
+    CONFIG_FIELD(heartbeatInterval),
+  };
+  return fields[field < CFG_FIELD_COUNT ? field : 0];
+}
 
-  NodeConfig() {
-    // Set defaults
+/**
+ * Node Configuration Manager
+ * Stores and manages node settings in non-volatile storage (NVS)
+ *
+ * The settings live in one versioned, CRC'd blob. load() reads it with a
+ * single getBytes(). save() does not write: it compares the fields with
+ * what flash holds, sets a dirty bit per changed field, and starts the
+ * commit delay. process(), called from the loop when it has nothing
+ * urgent, writes the blob once the delay has passed, so a burst of
+ * changes costs one write. Settings from before the blob (one key per
+ * field) are read once and migrated.
+ *
+ * The alarm mode changes far more often than anything else, so it goes to
+ * a journal of its own (setAlarmMode()) rather than through save(). load()
+ * takes the journal's mode over the one in the settings.
+ *
+ * The hub changes settings remotely with applyRemote(). A change set names
+ * the revision it was made against, is checked in full on a copy, and
+ * either all of it takes effect (revision + 1, committed at once) or none
+ * of it does. A change to a link field (address, frequency, power, SF) is
+ * kept in RAM on probation instead: the hub has to CONFIRM it over the new
+ * link within CONFIG_PROBATION_MS, or rollbackRemote() puts the old
+ * settings back. Flash only ever holds settings the hub has reached the
+ * node with, so a reboot during probation rolls back too.
+ */
+class NodeConfig {
+public:
+  struct Stats {
+    uint32_t saves;
+    uint32_t commits;
+    uint32_t loadUs;
+    uint32_t commitMaxUs;
+    uint32_t remoteApplied;
+    uint32_t remoteRolledBack;
+  };
+
+private:
+  Preferences prefs;
+  const char* NAMESPACE = "boat-node";
+  journal::Journal modeJournal{"node-alarm"};
+  ConfigBlob committed;            // what flash holds
+  uint32_t dirty;                  // ConfigField bits not yet committed
+  unsigned long dirtySince;
+  Stats stats;
+  ConfigBlob rollback;             // settings before a change on probation
+  bool probation;
+  unsigned long probationSince;
+
+  static uint8_t blobCrc(const ConfigBlob& b) {
+    return crc8_dallas((const uint8_t*)&b, sizeof(ConfigBlob) - 1);
+  }
+
+  void setDefaults() {
     nodeID = 0x01;
     hubID = 0x00;
     nodeName = "Node 1";
@@ -66,11 +150,79 @@ public:
     loraSpreadingFactor = 8;
     envDataInterval = 300000;      // 5 minutes
     heartbeatInterval = 60000;     // 1 minute
+    revision = 0;
   }
 
-  bool load() {
-    prefs.begin(NAMESPACE, false);
+  void toBlob(ConfigBlob& b) const {
+    memset(&b, 0, sizeof(b));
+    b.version = CONFIG_BLOB_VERSION;
+    b.nodeID = nodeID;
+    b.hubID = hubID;
+    strncpy(b.nodeName, nodeName.c_str(), CONFIG_NAME_MAX);
+    b.alarmMode = alarmMode;
+    b.detectionSensitivity = detectionSensitivity;
+    b.quietHoursEnabled = quietHoursEnabled;
+    b.quietHourStart = quietHourStart;
+    b.quietHourEnd = quietHourEnd;
+    b.nearZoneMax = nearZoneMax;
+    b.middleZoneMax = middleZoneMax;
+    b.farZoneMax = farZoneMax;
+    b.displayBrightness = displayBrightness;
+    b.displayTimeout = displayTimeout;
+    b.temperatureFahrenheit = temperatureFahrenheit;
+    b.loraFrequency = loraFrequency;
+    b.loraTxPower = loraTxPower;
+    b.loraSpreadingFactor = loraSpreadingFactor;
+    b.envDataInterval = envDataInterval;
+    b.heartbeatInterval = heartbeatInterval;
+    b.revision = revision;
+    b.crc = blobCrc(b);
+  }
+
+  void fromBlob(const ConfigBlob& b) {
+    char name[CONFIG_NAME_MAX + 1];
+    memcpy(name, b.nodeName, CONFIG_NAME_MAX);
+    name[CONFIG_NAME_MAX] = '\0';
 
+    nodeID = b.nodeID;
+    hubID = b.hubID;
+    nodeName = name;
+    alarmMode = (AlarmMode)b.alarmMode;
+    detectionSensitivity = b.detectionSensitivity;
+    quietHoursEnabled = b.quietHoursEnabled;
+    quietHourStart = b.quietHourStart;
+    quietHourEnd = b.quietHourEnd;
+    nearZoneMax = b.nearZoneMax;
+    middleZoneMax = b.middleZoneMax;
+    farZoneMax = b.farZoneMax;
+    displayBrightness = b.displayBrightness;
+    displayTimeout = b.displayTimeout;
+    temperatureFahrenheit = b.temperatureFahrenheit;
+    loraFrequency = b.loraFrequency;
+    loraTxPower = b.loraTxPower;
+    loraSpreadingFactor = b.loraSpreadingFactor;
+    envDataInterval = b.envDataInterval;
+    heartbeatInterval = b.heartbeatInterval;
+    revision = b.revision;
+  }
+
+  static bool validBlob(const ConfigBlob& b) {
+    return b.nodeID != HUB_ADDRESS && b.nodeID != BROADCAST_ADDRESS &&
+           b.hubID != BROADCAST_ADDRESS && b.hubID != b.nodeID &&
+           b.nodeName[0] != '\0' &&
+           b.detectionSensitivity <= 100 &&
+           b.quietHoursEnabled <= 1 && b.temperatureFahrenheit <= 1 &&
+           b.quietHourStart < 24 && b.quietHourEnd < 24 &&
+           b.nearZoneMax > 0 && b.nearZoneMax < b.middleZoneMax &&
+           b.middleZoneMax < b.farZoneMax &&
+           b.loraFrequency >= 137.0 && b.loraFrequency <= 1020.0 &&
+           b.loraTxPower >= 2 && b.loraTxPower <= 20 &&
+           b.loraSpreadingFactor >= 7 && b.loraSpreadingFactor <= 12 &&
+           b.envDataInterval >= 10000 && b.heartbeatInterval >= 10000;
+  }
+
+  // One key per field, as written before the blob
+  void loadLegacy() {
     nodeID = prefs.getUChar("nodeID", 0x01);
     hubID = prefs.getUChar("hubID", 0x00);
     nodeName = prefs.getString("nodeName", "Node 1");
@@ -90,58 +242,287 @@ public:
     loraSpreadingFactor = prefs.getUChar("loraSF", 8);
     envDataInterval = prefs.getULong("envInterval", 300000);
     heartbeatInterval = prefs.getULong("hbInterval", 60000);
+  }
+
+  // Fields that differ from what flash holds
+  uint32_t changedFields() const {
+    ConfigBlob now;
+    toBlob(now);
+    uint32_t changed = 0;
+    for (uint8_t f = 0; f < CFG_FIELD_COUNT; f++) {
+      const ConfigFieldInfo& info = configField((ConfigField)f);
+      if (memcmp((const uint8_t*)&now + info.offset,
+                 (const uint8_t*)&committed + info.offset, info.size) != 0) {
+        changed |= 1UL << f;
+      }
+    }
+    return changed;
+  }
+
+public:
+  // Node identity
+  uint8_t nodeID;
+  uint8_t hubID;
+  String nodeName;
+
+  // Alarm settings
+  AlarmMode alarmMode;
+  uint8_t detectionSensitivity;    // 0-100 (affects min confidence)
+  bool quietHoursEnabled;
+  uint8_t quietHourStart;          // 0-23 hour
+  uint8_t quietHourEnd;            // 0-23 hour
+
+  // Detection zones (in cm)
+  uint16_t nearZoneMax;
+  uint16_t middleZoneMax;
+  uint16_t farZoneMax;
+
+  // Display settings
+  uint8_t displayBrightness;       // 0-255
+  uint16_t displayTimeout;         // seconds
+  bool temperatureFahrenheit;      // true=F, false=C
+
+  // LoRa settings
+  float loraFrequency;             // MHz
+  uint8_t loraTxPower;             // dBm
+  uint8_t loraSpreadingFactor;     // 7-12
+
+  // Timing
+  uint32_t envDataInterval;        // milliseconds between env data transmissions
+  uint32_t heartbeatInterval;      // milliseconds between heartbeats
+
+  // Bumped by every remote change that takes effect
+  uint16_t revision;
+
+  NodeConfig() : dirty(0), dirtySince(0), probation(false), probationSince(0) {
+    memset(&committed, 0, sizeof(committed));
+    memset(&rollback, 0, sizeof(rollback));
+    memset(&stats, 0, sizeof(stats));
+    setDefaults();
+  }
 
+  bool load() {
+    uint32_t start = micros();
+    setDefaults();
+
+    ConfigBlob blob;
+    const char* source = "defaults";
+    prefs.begin(NAMESPACE, false);
+    size_t n = prefs.getBytes("blob", &blob, sizeof(blob));
+    if (n == sizeof(blob) && blob.version == CONFIG_BLOB_VERSION &&
+        blob.crc == blobCrc(blob)) {
+      fromBlob(blob);
+      source = "blob";
+    } else if (n == offsetof(ConfigBlob, revision) + 1 && blob.version == 1 &&
+               ((uint8_t*)&blob)[n - 1] == crc8_dallas((const uint8_t*)&blob, n - 1)) {
+      blob.revision = 0;
+      fromBlob(blob);
+      source = "blob v1";
+    } else if (prefs.isKey("nodeID")) {
+      loadLegacy();
+      source = "legacy keys";
+    }
     prefs.end();
 
-    Serial.println("Configuration loaded:");
+    // Anything not from the blob gets written as one on the next commit
+    if (strcmp(source, "blob") == 0) {
+      committed = blob;
+      dirty = 0;
+    } else {
+      memset(&committed, 0, sizeof(committed));
+      dirty = changedFields();
+      dirtySince = millis();
+    }
+
+    journal::Entry last;
+    if (modeJournal.begin() && modeJournal.latest(last) && last.mode <= MODE_QUIET) {
+      alarmMode = (AlarmMode)last.mode;
+    }
+    stats.loadUs = micros() - start;
+
+    Serial.print("Configuration loaded from ");
+    Serial.print(source);
+    Serial.print(" in ");
+    Serial.print(stats.loadUs);
+    Serial.println("us:");
     Serial.print("  Node ID: 0x");
     Serial.println(nodeID, HEX);
     Serial.print("  Node Name: ");
     Serial.println(nodeName);
     Serial.print("  Alarm Mode: ");
     Serial.println(alarmModeToString(alarmMode));
+    Serial.print("  Revision: ");
+    Serial.println(revision);
 
     return true;
   }
 
+  // Queue the changed fields for the next commit; nothing is written here
   bool save() {
-    prefs.begin(NAMESPACE, false);
+    stats.saves++;
+    bool wasDirty = dirty != 0;
+    dirty = changedFields();
+    if (dirty && !wasDirty) dirtySince = millis();
+    modeJournal.append(0, alarmMode, 0);
+    return true;
+  }
 
-    prefs.putUChar("nodeID", nodeID);
-    prefs.putUChar("hubID", hubID);
-    prefs.putString("nodeName", nodeName);
-    prefs.putUChar("alarmMode", alarmMode);
-    prefs.putUChar("sensitivity", detectionSensitivity);
-    prefs.putBool("quietHours", quietHoursEnabled);
-    prefs.putUChar("quietStart", quietHourStart);
-    prefs.putUChar("quietEnd", quietHourEnd);
-    prefs.putUShort("nearZone", nearZoneMax);
-    prefs.putUShort("middleZone", middleZoneMax);
-    prefs.putUShort("farZone", farZoneMax);
-    prefs.putUChar("brightness", displayBrightness);
-    prefs.putUShort("dispTimeout", displayTimeout);
-    prefs.putBool("tempF", temperatureFahrenheit);
-    prefs.putFloat("loraFreq", loraFrequency);
-    prefs.putUChar("loraPower", loraTxPower);
-    prefs.putUChar("loraSF", loraSpreadingFactor);
-    prefs.putULong("envInterval", envDataInterval);
-    prefs.putULong("hbInterval", heartbeatInterval);
+  // Commit once the changes have settled; call when the loop is idle
+  bool process() {
+    if (probation) return false;
+    if (!dirty || millis() - dirtySince < CONFIG_COMMIT_DELAY_MS) return false;
+    return commit();
+  }
 
-    prefs.end();
+  // Write the blob now (before a restart, for example)
+  bool commit() {
+    dirty = changedFields();
+    if (!dirty) return true;
+
+    uint32_t start = micros();
+    ConfigBlob blob;
+    toBlob(blob);
+    size_t n = 0;
+    if (prefs.begin(NAMESPACE, false)) {
+      n = prefs.putBytes("blob", &blob, sizeof(blob));
+      prefs.end();
+    }
+    if (n != sizeof(blob)) {
+      dirtySince = millis();  // try again after another delay
+      Serial.println("Configuration commit failed");
+      return false;
+    }
+
+    uint32_t took = micros() - start;
+    if (took > stats.commitMaxUs) stats.commitMaxUs = took;
+    stats.commits++;
 
-    Serial.println("Configuration saved");
+    char buf[64];
+    snprintf(buf, sizeof(buf), "Configuration committed (%u fields, %luus)",
+             __builtin_popcount(dirty), (unsigned long)took);
+    Serial.println(buf);
+
+    committed = blob;
+    dirty = 0;
     return true;
   }
 
+  uint32_t getDirty() const { return dirty; }
+  const Stats& getStats() const { return stats; }
+
+  void printStats(Print& out) const {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "config   saves=%lu commits=%lu dirty=0x%05lX load=%luus commit max=%luus "
+             "rev=%u remote=%lu rolled back=%lu",
+             (unsigned long)stats.saves, (unsigned long)stats.commits,
+             (unsigned long)dirty, (unsigned long)stats.loadUs,
+             (unsigned long)stats.commitMaxUs, revision,
+             (unsigned long)stats.remoteApplied, (unsigned long)stats.remoteRolledBack);
+    out.println(buf);
+  }
+
   void factoryReset() {
+    probation = false;
     prefs.begin(NAMESPACE, false);
     prefs.clear();
     prefs.end();
+    modeJournal.clear();
 
     Serial.println("Factory reset complete - reloading defaults");
     load(); // Reload defaults
   }
 
+  // Apply a remote change set to revision baseRevision: all entries or
+  // none. Returns CONFIG_OK (committed), CONFIG_PENDING (link change on
+  // probation; the caller retunes the radio after acknowledging), or why
+  // nothing changed. The alarm mode is not remotely settable; it has its
+  // own command.
+  uint8_t applyRemote(uint16_t baseRevision, const uint8_t* entries, uint8_t len) {
+    if (probation) return CONFIG_BUSY;
+    if (baseRevision != revision) return CONFIG_STALE;
+
+    ConfigBlob current, staged;
+    toBlob(current);
+    staged = current;
+
+    uint8_t pos = 0, field, size;
+    const uint8_t* value;
+    while (nextConfigEntry(entries, len, &pos, &field, &size, &value)) {
+      if (field >= CFG_FIELD_COUNT || field == CFG_ALARM_MODE) return CONFIG_BAD_FIELD;
+      const ConfigFieldInfo& info = configField((ConfigField)field);
+      uint8_t* dst = (uint8_t*)&staged + info.offset;
+
+      if (configFieldSpec(field).type == CFG_TYPE_TEXT) {
+        if (size > CONFIG_NAME_MAX) return CONFIG_BAD_VALUE;
+        memset(dst, 0, info.size);
+        memcpy(dst, value, size);
+      } else {
+        if (size != info.size) return CONFIG_BAD_VALUE;
+        uint32_t v = configEntryValue(value, size);
+        memcpy(dst, &v, size);     // low bytes first: the ESP32 is little-endian
+      }
+    }
+    if (pos != len || !validBlob(staged)) return CONFIG_BAD_VALUE;
+
+    uint32_t changed = 0;
+    for (uint8_t f = 0; f < CFG_FIELD_COUNT; f++) {
+      const ConfigFieldInfo& info = configField((ConfigField)f);
+      if (memcmp((const uint8_t*)&staged + info.offset,
+                 (const uint8_t*)&current + info.offset, info.size) != 0) {
+        changed |= 1UL << f;
+      }
+    }
+    if (!changed) return CONFIG_OK; // already set; revision stays
+
+    staged.revision = revision + 1;
+    fromBlob(staged);
+    stats.remoteApplied++;
+
+    if (changed & CONFIG_LINK_FIELDS) {
+      rollback = current;
+      probation = true;
+      probationSince = millis();
+      return CONFIG_PENDING;
+    }
+    commit();
+    return CONFIG_OK;
+  }
+
+  // The hub reached us with the settings on probation: keep them. A repeat
+  // CONFIRM (our ACK was lost) is answered OK again.
+  uint8_t confirmRemote(uint16_t confirmRevision) {
+    if (confirmRevision != revision) return CONFIG_STALE;
+    if (probation) {
+      probation = false;
+      commit();
+    }
+    return CONFIG_OK;
+  }
+
+  bool onProbation() const { return probation; }
+
+  bool probationExpired() const {
+    return probation && millis() - probationSince >= CONFIG_PROBATION_MS;
+  }
+
+  // Back to the settings before the change on probation
+  void rollbackRemote() {
+    if (!probation) return;
+    AlarmMode mode = alarmMode;  // may have changed since; it is journaled
+    fromBlob(rollback);
+    alarmMode = mode;
+    probation = false;
+    stats.remoteRolledBack++;
+    Serial.println("Remote config not confirmed - rolled back");
+  }
+
+  // One journal record instead of rewriting every key
+  void setAlarmMode(AlarmMode mode) {
+    alarmMode = mode;
+    modeJournal.append(0, mode, 0);
+  }
+
   // Get effective alarm mode (considering quiet hours)
   AlarmMode getEffectiveAlarmMode() {
     if (quietHoursEnabled && isQuietHours()) {
@@ -5,11 +5,34 @@
 #include <Adafruit_ILI9341.h>
 #include "../../common/CommonTypes.h"
 
+#define DISPLAY_BAND_ROWS   40     // 240 x 40 x 16 bpp = 19.2 KB per band
+#define DISPLAY_TASK_CORE   0      // the loop (sensors, radio) runs on core 1
+
 /**
  * Display Manager for Node
  * Handles TFT display rendering for environmental data and status
+ *
+ * The screen is a set of full-width row spans (header, one per reading,
+ * banner, mode bar) whose last drawn values are kept in `shown`. Updating
+ * a value marks its span dirty; flush() renders dirty spans into a 40-row
+ * offscreen band in RAM and hands it to a display task that pushes it to
+ * the panel. Two bands alternate, so the loop renders the next band while
+ * the previous one is on the wire and only waits when both are queued.
+ * Nothing is sent while the screen is unchanged.
  */
 class DisplayManager {
+public:
+  struct Stats {
+    uint32_t frames;           // flushes that pushed something
+    uint32_t bands;
+    uint32_t bytesPushed;
+    uint32_t renderLastUs;     // loop time per frame, including band waits
+    uint32_t renderAvgUs;
+    uint32_t renderMaxUs;
+    uint32_t waitMaxUs;        // loop blocked on a free band
+    uint32_t pushMaxUs;        // one band on the SPI bus (display task)
+  };
+
 private:
   Adafruit_ILI9341* tft;
   uint8_t csPin;
@@ -32,11 +55,320 @@ private:
   static const uint16_t COLOR_WARNING = 0xFD20;  // Orange
   static const uint16_t COLOR_OK = 0x07E0;       // Green
 
+  enum Screen { SCREEN_BLANK, SCREEN_BOOT, SCREEN_MAIN, SCREEN_ALARM, SCREEN_ERROR };
+  enum Banner { BANNER_NONE, BANNER_PRE_ALARM, BANNER_VISITOR };
+
+  // Row spans, top to bottom
+  enum Part {
+    PART_HEADER, PART_TEMP, PART_HUMIDITY, PART_PRESSURE, PART_TREND,
+    PART_SIGNAL, PART_BATTERY, PART_BANNER, PART_COUNTDOWN, PART_MODE, PART_COUNT
+  };
+
+  struct Span {
+    int16_t y;
+    int16_t h;
+  };
+
+  static Span span(uint8_t part) {
+    static const Span spans[PART_COUNT] = {
+      {0, 30}, {40, 16}, {70, 16}, {100, 16}, {125, 16},
+      {165, 8}, {180, 8}, {200, 60}, {215, 16}, {HEIGHT - 30, 30}
+    };
+    return spans[part];
+  }
+
+  // What is on the panel (or queued for it)
+  struct Shown {
+    Screen screen;
+    String title;              // node name, alarm zone or error text
+    AlarmMode mode;
+    float temp;
+    float humidity;
+    float pressure;
+    char trend[8];
+    int rssi;
+    uint16_t batteryMv;
+    Banner banner;
+    int countdown;
+  };
+
+  Shown shown;
+  uint16_t dirty;              // bit per Part
+  bool dirtyAll;
+
+  struct BandJob {
+    uint8_t band;
+    int16_t y;
+    int16_t h;
+  };
+
+  GFXcanvas16* bands[2];
+  QueueHandle_t freeBands;     // band indices ready to render into
+  QueueHandle_t readyBands;    // BandJobs for the display task
+  Stats stats;
+
+  void markDirty(uint8_t part) { dirty |= 1 << part; }
+
+  void setScreen(Screen screen, const String& title) {
+    if (shown.screen == screen && shown.title == title) return;
+    shown.screen = screen;
+    shown.title = title;
+    shown.banner = BANNER_NONE;
+    dirtyAll = true;
+  }
+
+  void setBanner(Banner banner, int countdown) {
+    if (shown.banner == banner && shown.countdown == countdown) return;
+    // A new number only needs its text rows; a new banner needs all of it
+    markDirty(shown.banner == banner ? PART_COUNTDOWN : PART_BANNER);
+    shown.banner = banner;
+    shown.countdown = countdown;
+  }
+
+  // Owns the SPI writes to the panel once begin() has started it
+  static void pushTask(void* param) {
+    DisplayManager* self = static_cast<DisplayManager*>(param);
+    BandJob job;
+    for (;;) {
+      xQueueReceive(self->readyBands, &job, portMAX_DELAY);
+      unsigned long start = micros();
+      self->tft->startWrite();
+      self->tft->setAddrWindow(0, job.y, WIDTH, job.h);
+      self->tft->writePixels(self->bands[job.band]->getBuffer(), (uint32_t)WIDTH * job.h);
+      self->tft->endWrite();
+      uint32_t us = micros() - start;
+      if (us > self->stats.pushMaxUs) self->stats.pushMaxUs = us;
+      xQueueSend(self->freeBands, &job.band, portMAX_DELAY);
+    }
+  }
+
+  // Render rows [y, y + h) of the current screen and queue them
+  void pushRows(int16_t y, int16_t h) {
+    for (int16_t end = y + h; y < end; y += DISPLAY_BAND_ROWS) {
+      BandJob job;
+      job.y = y;
+      job.h = end - y < DISPLAY_BAND_ROWS ? end - y : DISPLAY_BAND_ROWS;
+
+      unsigned long waitStart = micros();
+      xQueueReceive(freeBands, &job.band, portMAX_DELAY);
+      uint32_t waited = micros() - waitStart;
+      if (waited > stats.waitMaxUs) stats.waitMaxUs = waited;
+
+      compose(*bands[job.band], job.y, job.h);
+      xQueueSend(readyBands, &job, portMAX_DELAY);
+      stats.bands++;
+      stats.bytesPushed += (uint32_t)WIDTH * job.h * 2;
+    }
+  }
+
+  // Send every dirty span; neighbouring spans that fit in one band go
+  // together (the rows between them are unchanged background)
+  void flush() {
+    if (!dirty && !dirtyAll) return;
+    unsigned long start = micros();
+
+    if (dirtyAll) {
+      pushRows(0, HEIGHT);
+    } else {
+      int16_t runY = -1, runEnd = 0;
+      for (uint8_t p = 0; p < PART_COUNT; p++) {
+        if (!(dirty & (1 << p))) continue;
+        Span s = span(p);
+        if (runY >= 0 && s.y + s.h - runY <= DISPLAY_BAND_ROWS) {
+          runEnd = s.y + s.h;
+          continue;
+        }
+        if (runY >= 0) pushRows(runY, runEnd - runY);
+        runY = s.y;
+        runEnd = s.y + s.h;
+      }
+      if (runY >= 0) pushRows(runY, runEnd - runY);
+    }
+    dirty = 0;
+    dirtyAll = false;
+
+    uint32_t us = micros() - start;
+    stats.frames++;
+    stats.renderLastUs = us;
+    stats.renderAvgUs = stats.frames == 1 ? us : stats.renderAvgUs - (stats.renderAvgUs >> 3) + (us >> 3);
+    if (us > stats.renderMaxUs) stats.renderMaxUs = us;
+  }
+
+  // Draw the rows [oy, oy + h) of the current screen into a band; every
+  // y coordinate is shifted up by oy and the canvas clips the rest
+  void compose(GFXcanvas16& g, int16_t oy, int16_t h) {
+    switch (shown.screen) {
+      case SCREEN_BLANK:
+        g.fillScreen(COLOR_BG);
+        break;
+      case SCREEN_BOOT:
+        composeBoot(g, oy);
+        break;
+      case SCREEN_MAIN:
+        composeMain(g, oy, h);
+        break;
+      case SCREEN_ALARM:
+        composeAlarm(g, oy);
+        break;
+      case SCREEN_ERROR:
+        composeError(g, oy);
+        break;
+    }
+
+    if (shown.banner != BANNER_NONE && overlaps(PART_BANNER, oy, h)) {
+      composeBanner(g, oy);
+    }
+  }
+
+  static bool overlaps(uint8_t part, int16_t oy, int16_t h) {
+    Span s = span(part);
+    return s.y < oy + h && s.y + s.h > oy;
+  }
+
+  void composeBoot(GFXcanvas16& g, int16_t oy) {
+    g.fillScreen(COLOR_BG);
+    g.setTextColor(COLOR_HEADER);
+    g.setTextSize(2);
+    g.setCursor(20, 100 - oy);
+    g.println("LIBERTY");
+    g.setTextColor(COLOR_TEXT);
+    g.setTextSize(1);
+    g.setCursor(20, 130 - oy);
+    g.println(shown.title);
+    g.setCursor(20, 150 - oy);
+    g.println("Initializing...");
+  }
+
+  void composeMain(GFXcanvas16& g, int16_t oy, int16_t h) {
+    g.fillScreen(COLOR_BG);
+
+    // Header
+    if (overlaps(PART_HEADER, oy, h)) {
+      drawHeader(g, oy);
+    }
+
+    // Environmental data
+    g.setTextSize(2);
+    g.setTextColor(COLOR_TEXT);
+
+    // Temperature
+    if (overlaps(PART_TEMP, oy, h)) {
+      g.setCursor(10, 40 - oy);
+      g.print("Temp:  ");
+      g.print(shown.temp, 1);
+      g.print("C");
+    }
+
+    // Humidity
+    if (overlaps(PART_HUMIDITY, oy, h)) {
+      g.setCursor(10, 70 - oy);
+      g.print("Humid: ");
+      g.print((int)shown.humidity);
+      g.print("%");
+    }
+
+    // Pressure with trend
+    if (overlaps(PART_PRESSURE, oy, h)) {
+      g.setCursor(10, 100 - oy);
+      g.print("Baro:  ");
+      g.print((int)shown.pressure);
+      g.print("hPa");
+    }
+
+    if (overlaps(PART_TREND, oy, h)) {
+      g.setTextSize(1);
+      g.setCursor(10, 125 - oy);
+      g.print("Trend: ");
+      g.setTextSize(2);
+      g.print(shown.trend);
+    }
+
+    // Status info
+    g.setTextSize(1);
+    g.setTextColor(COLOR_TEXT);
+
+    if (overlaps(PART_SIGNAL, oy, h)) {
+      g.setCursor(10, 165 - oy);
+      g.print("Signal: ");
+      g.print(shown.rssi);
+      g.print(" dBm");
+    }
+
+    if (overlaps(PART_BATTERY, oy, h)) {
+      g.setCursor(10, 180 - oy);
+      g.print("Battery: ");
+      g.print(shown.batteryMv / 1000.0, 2);
+      g.print("V");
+    }
+
+    // Mode indicator at bottom
+    if (overlaps(PART_MODE, oy, h)) {
+      drawModeIndicator(g, oy);
+    }
+  }
+
+  void composeAlarm(GFXcanvas16& g, int16_t oy) {
+    g.fillScreen(COLOR_ALARM);
+    g.setTextColor(COLOR_TEXT);
+    g.setTextSize(3);
+    g.setCursor(20, 100 - oy);
+    g.println("ALARM!");
+    g.setTextSize(2);
+    g.setCursor(20, 140 - oy);
+    g.print("Zone: ");
+    g.println(shown.title);
+    g.setTextSize(1);
+    g.setCursor(20, 180 - oy);
+    g.println("Disarm to silence");
+  }
+
+  void composeError(GFXcanvas16& g, int16_t oy) {
+    g.fillScreen(COLOR_ALARM);
+    g.setTextColor(COLOR_TEXT);
+    g.setTextSize(2);
+    g.setCursor(20, 100 - oy);
+    g.println("ERROR");
+    g.setTextSize(1);
+    g.setCursor(20, 130 - oy);
+    g.println(shown.title);
+  }
+
+  void composeBanner(GFXcanvas16& g, int16_t oy) {
+    Span s = span(PART_BANNER);
+    if (shown.banner == BANNER_PRE_ALARM) {
+      g.fillRect(0, s.y - oy, WIDTH, s.h, COLOR_WARNING);
+      g.setTextColor(COLOR_TEXT);
+      g.setTextSize(2);
+      g.setCursor(20, 215 - oy);
+      g.print("WARNING: ");
+      g.print(shown.countdown);
+      g.print("s");
+    } else {
+      // Show doorbell notification
+      g.fillRect(0, s.y - oy, WIDTH, s.h, COLOR_OK);
+      g.setTextColor(COLOR_TEXT);
+      g.setTextSize(2);
+      g.setCursor(20, 215 - oy);
+      g.println("VISITOR");
+    }
+  }
+
 public:
   DisplayManager(uint8_t cs, uint8_t dc, uint8_t rst)
     : csPin(cs), dcPin(dc), rstPin(rst), brightness(128),
-      lastUpdate(0), displayOn(true) {
+      lastUpdate(0), displayOn(true), dirty(0), dirtyAll(false),
+      freeBands(nullptr), readyBands(nullptr) {
     tft = new Adafruit_ILI9341(cs, dc, rst);
+    bands[0] = bands[1] = nullptr;
+    shown.screen = SCREEN_BLANK;
+    shown.mode = MODE_DISARMED;
+    shown.temp = shown.humidity = shown.pressure = 0;
+    shown.trend[0] = '\0';
+    shown.rssi = 0;
+    shown.batteryMv = 0;
+    shown.banner = BANNER_NONE;
+    shown.countdown = 0;
+    memset(&stats, 0, sizeof(stats));
   }
 
   ~DisplayManager() {
@@ -51,6 +383,18 @@ public:
     setBrightness(brightness);
     displayOn = true;
 
+    for (uint8_t i = 0; i < 2; i++) {
+      bands[i] = new GFXcanvas16(WIDTH, DISPLAY_BAND_ROWS);
+      if (!bands[i]->getBuffer()) {
+        Serial.println("Display: no memory for band buffers");
+        return false;
+      }
+    }
+    freeBands = xQueueCreate(2, sizeof(uint8_t));
+    readyBands = xQueueCreate(2, sizeof(BandJob));
+    for (uint8_t i = 0; i < 2; i++) xQueueSend(freeBands, &i, 0);
+    xTaskCreatePinnedToCore(pushTask, "display", 2048, this, 1, nullptr, DISPLAY_TASK_CORE);
+
     Serial.println("Display initialized");
     return true;
   }
@@ -79,153 +423,107 @@ public:
   }
 
   void showBootScreen(const String& nodeName) {
-    tft->fillScreen(COLOR_BG);
-    tft->setTextColor(COLOR_HEADER);
-    tft->setTextSize(2);
-    tft->setCursor(20, 100);
-    tft->println("LIBERTY");
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(1);
-    tft->setCursor(20, 130);
-    tft->println(nodeName);
-    tft->setCursor(20, 150);
-    tft->println("Initializing...");
+    setScreen(SCREEN_BOOT, nodeName);
+    flush();
     delay(2000);
   }
 
+  // Only values that changed since the last call are redrawn. Any banner
+  // (pre-alarm, visitor) is taken down, as the old full redraw did.
   void drawMainScreen(const String& nodeName, float temp, float humidity,
                      float pressure, const char* trend, AlarmMode mode,
                      int rssi, uint16_t batteryMv) {
-    tft->fillScreen(COLOR_BG);
-
-    // Header
-    drawHeader(nodeName, mode);
-
-    // Environmental data
-    int yPos = 40;
-
-    tft->setTextSize(2);
-    tft->setTextColor(COLOR_TEXT);
-
-    // Temperature
-    tft->setCursor(10, yPos);
-    tft->print("Temp:  ");
-    tft->print(temp, 1);
-    tft->print("C");
-    yPos += 30;
-
-    // Humidity
-    tft->setCursor(10, yPos);
-    tft->print("Humid: ");
-    tft->print((int)humidity);
-    tft->print("%");
-    yPos += 30;
-
-    // Pressure with trend
-    tft->setCursor(10, yPos);
-    tft->print("Baro:  ");
-    tft->print((int)pressure);
-    tft->print("hPa");
-    yPos += 25;
-
-    tft->setTextSize(1);
-    tft->setCursor(10, yPos);
-    tft->print("Trend: ");
-    tft->setTextSize(2);
-    tft->print(trend);
-    yPos += 40;
-
-    // Status info
-    tft->setTextSize(1);
-    tft->setTextColor(COLOR_TEXT);
-
-    tft->setCursor(10, yPos);
-    tft->print("Signal: ");
-    tft->print(rssi);
-    tft->print(" dBm");
-    yPos += 15;
-
-    tft->setCursor(10, yPos);
-    tft->print("Battery: ");
-    tft->print(batteryMv / 1000.0, 2);
-    tft->print("V");
+    if (shown.screen != SCREEN_MAIN || shown.title != nodeName) {
+      setScreen(SCREEN_MAIN, nodeName);
+    } else {
+      // Compare at the precision printed
+      if (mode != shown.mode) {
+        markDirty(PART_HEADER);
+        markDirty(PART_MODE);
+      }
+      if (lroundf(temp * 10) != lroundf(shown.temp * 10)) markDirty(PART_TEMP);
+      if ((int)humidity != (int)shown.humidity) markDirty(PART_HUMIDITY);
+      if ((int)pressure != (int)shown.pressure) markDirty(PART_PRESSURE);
+      if (strncmp(trend, shown.trend, sizeof(shown.trend)) != 0) markDirty(PART_TREND);
+      if (rssi != shown.rssi) markDirty(PART_SIGNAL);
+      if ((batteryMv + 5) / 10 != (shown.batteryMv + 5) / 10) markDirty(PART_BATTERY);
+      setBanner(BANNER_NONE, 0);
+    }
 
-    // Mode indicator at bottom
-    drawModeIndicator(mode);
+    shown.mode = mode;
+    shown.temp = temp;
+    shown.humidity = humidity;
+    shown.pressure = pressure;
+    strncpy(shown.trend, trend, sizeof(shown.trend) - 1);
+    shown.trend[sizeof(shown.trend) - 1] = '\0';
+    shown.rssi = rssi;
+    shown.batteryMv = batteryMv;
 
+    flush();
     lastUpdate = millis();
   }
 
   void showAlarmTriggered(const String& zone) {
-    tft->fillScreen(COLOR_ALARM);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(3);
-    tft->setCursor(20, 100);
-    tft->println("ALARM!");
-    tft->setTextSize(2);
-    tft->setCursor(20, 140);
-    tft->print("Zone: ");
-    tft->println(zone);
-    tft->setTextSize(1);
-    tft->setCursor(20, 180);
-    tft->println("Disarm to silence");
+    setScreen(SCREEN_ALARM, zone);
+    flush();
   }
 
+  // Redraws only the countdown's text rows when the number changes
   void showPreAlarm(int countdown) {
-    tft->fillRect(0, 200, WIDTH, 60, COLOR_WARNING);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(2);
-    tft->setCursor(20, 215);
-    tft->print("WARNING: ");
-    tft->print(countdown);
-    tft->print("s");
+    setBanner(BANNER_PRE_ALARM, countdown);
+    flush();
   }
 
   void showVisitor() {
-    // Show doorbell notification
-    tft->fillRect(0, 200, WIDTH, 60, COLOR_OK);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(2);
-    tft->setCursor(20, 215);
-    tft->println("VISITOR");
+    setBanner(BANNER_VISITOR, 0);
+    flush();
   }
 
   void showError(const String& errorMsg) {
-    tft->fillScreen(COLOR_ALARM);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(2);
-    tft->setCursor(20, 100);
-    tft->println("ERROR");
-    tft->setTextSize(1);
-    tft->setCursor(20, 130);
-    tft->println(errorMsg);
+    setScreen(SCREEN_ERROR, errorMsg);
+    flush();
   }
 
   void clear() {
-    tft->fillScreen(COLOR_BG);
+    setScreen(SCREEN_BLANK, "");
+    flush();
+  }
+
+  const Stats& getStats() const { return stats; }
+
+  void printStats(Print& out) const {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "display  frames=%lu bands=%lu bytes=%lu "
+             "render last/avg/max=%lu/%lu/%luus wait max=%luus push max=%luus",
+             (unsigned long)stats.frames, (unsigned long)stats.bands,
+             (unsigned long)stats.bytesPushed, (unsigned long)stats.renderLastUs,
+             (unsigned long)stats.renderAvgUs, (unsigned long)stats.renderMaxUs,
+             (unsigned long)stats.waitMaxUs, (unsigned long)stats.pushMaxUs);
+    out.println(buf);
   }
 
 private:
-  void drawHeader(const String& nodeName, AlarmMode mode) {
+  void drawHeader(GFXcanvas16& g, int16_t oy) {
     // Draw header bar
-    tft->fillRect(0, 0, WIDTH, 30, COLOR_HEADER);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(1);
-    tft->setCursor(5, 10);
-    tft->print(nodeName);
+    g.fillRect(0, 0 - oy, WIDTH, 30, COLOR_HEADER);
+    g.setTextColor(COLOR_TEXT);
+    g.setTextSize(1);
+    g.setCursor(5, 10 - oy);
+    g.print(shown.title);
 
     // Status indicator
-    uint16_t statusColor = getStatusColor(mode);
-    tft->fillCircle(WIDTH - 15, 15, 8, statusColor);
+    uint16_t statusColor = getStatusColor(shown.mode);
+    g.fillCircle(WIDTH - 15, 15 - oy, 8, statusColor);
   }
 
-  void drawModeIndicator(AlarmMode mode) {
-    tft->fillRect(0, HEIGHT - 30, WIDTH, 30, COLOR_HEADER);
-    tft->setTextColor(COLOR_TEXT);
-    tft->setTextSize(1);
-    tft->setCursor(10, HEIGHT - 20);
-    tft->print("Mode: ");
-    tft->print(alarmModeToString(mode));
+  void drawModeIndicator(GFXcanvas16& g, int16_t oy) {
+    g.fillRect(0, HEIGHT - 30 - oy, WIDTH, 30, COLOR_HEADER);
+    g.setTextColor(COLOR_TEXT);
+    g.setTextSize(1);
+    g.setCursor(10, HEIGHT - 20 - oy);
+    g.print("Mode: ");
+    g.print(alarmModeToString(shown.mode));
   }
 
   uint16_t getStatusColor(AlarmMode mode) {
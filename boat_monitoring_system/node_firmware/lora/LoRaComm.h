@@ -27,11 +27,18 @@ private:
   typedef void (*MessageCallback)(uint8_t* data, uint8_t len, uint8_t from);
   MessageCallback onMessageReceived;
 
+  // Remote config: applies a QUERY/SET/CONFIRM, returns a CONFIG_* status
+  // and sets *current to the node's revision for the ACK
+  typedef uint8_t (*ConfigCallback)(uint8_t op, uint16_t revision,
+                                    const uint8_t* entries, uint8_t len,
+                                    uint16_t* current);
+  ConfigCallback onConfig;
+
 public:
   LoRaComm(uint8_t cs, uint8_t interrupt, uint8_t reset, uint8_t nodeAddr, uint8_t hubAddr)
     : rf95(cs, interrupt), csPin(cs), intPin(interrupt), rstPin(reset),
       nodeID(nodeAddr), hubID(hubAddr), sequenceNumber(0),
-      onMessageReceived(nullptr) {
+      onMessageReceived(nullptr), onConfig(nullptr) {
     manager = new RHReliableDatagram(rf95, nodeAddr);
   }
 
@@ -78,6 +85,27 @@ public:
     return true;
   }
 
+  // Apply radio settings and addresses from NodeConfig (after begin(), and
+  // again whenever they change remotely)
+  bool reconfigure(float frequency, uint8_t txPower, uint8_t spreadingFactor,
+                   uint8_t nodeAddr, uint8_t hubAddr) {
+    if (!rf95.setFrequency(frequency)) {
+      Serial.println("LoRa setFrequency failed");
+      return false;
+    }
+    rf95.setTxPower(txPower, false);
+    rf95.setSpreadingFactor(spreadingFactor);
+    manager->setThisAddress(nodeAddr);
+    nodeID = nodeAddr;
+    hubID = hubAddr;
+
+    char buf[80];
+    snprintf(buf, sizeof(buf), "LoRa %.1f MHz, %u dBm, SF%u, node 0x%02X, hub 0x%02X",
+             frequency, txPower, spreadingFactor, nodeAddr, hubAddr);
+    Serial.println(buf);
+    return true;
+  }
+
   // Send environmental data
   bool sendEnvironmentalData(const EnvData& data) {
     uint8_t packet[ENV_PACKET_SIZE];
@@ -101,7 +129,8 @@ public:
   bool sendDetectionEvent(const DetectionEvent& event) {
     uint8_t packet[DETECTION_PACKET_SIZE];
     packDetectionPacket(packet, nodeID, event.eventType,
-                       event.confidence, event.distance, event.zone);
+                       event.confidence, event.distance, event.zone,
+                       event.phase);
 
     bool success = manager->sendtoWait(packet, DETECTION_PACKET_SIZE, hubID);
 
@@ -130,6 +159,35 @@ public:
     return success;
   }
 
+  // Send hourly barograph trace (hPa * 10, oldest first, 0 = gap)
+  bool sendBarograph(const uint16_t* samples, uint8_t count) {
+    uint8_t packet[BAROGRAPH_MAX_PACKET_SIZE];
+    int len = packBarographPacket(packet, nodeID, samples, count);
+    if (len == 0) return false; // nothing recorded yet
+
+    bool success = manager->sendtoWait(packet, len, hubID);
+
+    if (!success) {
+      Serial.println("Barograph send failed");
+    }
+
+    return success;
+  }
+
+  // Announce this node to the hub (joins its registry on first contact)
+  bool sendAnnounce(const char* name, uint8_t capabilities, uint8_t fwVersion) {
+    uint8_t packet[ANNOUNCE_MAX_PACKET_SIZE];
+    int len = packAnnouncePacket(packet, nodeID, capabilities, fwVersion, name);
+
+    bool success = manager->sendtoWait(packet, len, hubID);
+
+    if (!success) {
+      Serial.println("Announce send failed");
+    }
+
+    return success;
+  }
+
   // Send heartbeat
   bool sendHeartbeat(uint16_t batteryMv) {
     uint8_t packet[HEARTBEAT_PACKET_SIZE];
@@ -144,6 +202,21 @@ public:
     return success;
   }
 
+  // Report config status and revision to the hub
+  bool sendConfigAck(uint8_t status, uint16_t revision) {
+    uint8_t packet[CONFIG_MAX_PACKET_SIZE];
+    int len = packConfigPacket(packet, nodeID, hubID, CONFIG_OP_ACK, revision,
+                               status, nullptr, 0);
+
+    bool success = manager->sendtoWait(packet, len, hubID);
+
+    if (!success) {
+      Serial.println("Config ACK send failed");
+    }
+
+    return success;
+  }
+
   // Process incoming messages
   void processIncoming() {
     if (manager->available()) {
@@ -167,6 +240,11 @@ public:
     onMessageReceived = callback;
   }
 
+  // Set handler for remote config packets
+  void setConfigCallback(ConfigCallback callback) {
+    onConfig = callback;
+  }
+
   // Get last RSSI
   int16_t getLastRSSI() {
     return rf95.lastRssi();
@@ -243,10 +321,34 @@ private:
     // Commands: 0x01=Arm, 0x02=Disarm, 0x03=Trigger, 0x04=Silence
   }
 
+  // The ACK goes out before the callback's changes reach the radio, so a
+  // radio change is acknowledged on the settings the hub sent it on
   void handleConfigUpdate(uint8_t* buf, uint8_t len) {
-    Serial.println("Config update received");
-    // Implement configuration update logic
-    // This would update node settings like sensitivity, zones, etc.
+    uint8_t fromID, target, op, status, entriesLen;
+    uint16_t revision;
+    const uint8_t* entries;
+    if (!unpackConfigPacket(buf, len, &fromID, &target, &op, &revision, &status,
+                            &entries, &entriesLen)) {
+      Serial.println("Config packet invalid");
+      return;
+    }
+
+    // Revisions are per node, so config is never broadcast
+    if (target != nodeID) return;
+    if (op != CONFIG_OP_QUERY && op != CONFIG_OP_SET && op != CONFIG_OP_CONFIRM) return;
+    if (!onConfig) return;
+
+    uint16_t current = 0;
+    status = onConfig(op, revision, entries, entriesLen, &current);
+
+    Serial.print("Config op ");
+    Serial.print(op);
+    Serial.print(" rev ");
+    Serial.print(revision);
+    Serial.print(": status ");
+    Serial.println(status);
+
+    sendConfigAck(status, current);
   }
 
   void handleTimeSync(uint8_t* buf, uint8_t len) {
@@ -23,6 +23,7 @@
 #include "config/NodeConfig.h"
 #include "sensors/BME280Sensor.h"
 #include "sensors/HumanDetector.h"
+#include "sensors/SensorScheduler.h"
 #include "lora/LoRaComm.h"
 #include "display/DisplayManager.h"
 #include "../common/CommonTypes.h"
@@ -69,8 +70,10 @@
 NodeConfig config;
 BME280Sensor envSensor;
 HumanDetector motionSensor(HUMAN_RX, HUMAN_TX);
-LoRaComm lora(LORA_CS, LORA_INT, LORA_RST, 0x01, 0x00); // Will be updated from config
+LoRaComm lora(LORA_CS, LORA_INT, LORA_RST, 0x01, 0x00); // Updated from config in setup()
 DisplayManager display(TFT_CS, TFT_DC, TFT_RST);
+SensorScheduler scheduler;
+int8_t envSlot = -1;
 
 // ============================================================================
 // STATE MACHINE
@@ -83,13 +86,21 @@ AlarmMode currentMode = MODE_DISARMED;
 // TIMING VARIABLES
 // ============================================================================
 
-unsigned long lastEnvRead = 0;
+uint32_t lastEnvRuns = 0;
+unsigned long lastSchedulerReport = 0;
 unsigned long lastEnvTransmit = 0;
 unsigned long lastHeartbeat = 0;
+uint32_t lastBarographSent = 0;
 unsigned long lastDisplayUpdate = 0;
 unsigned long lastButtonCheck = 0;
 unsigned long preAlarmStartTime = 0;
 
+// Set when an ONSET passed validation, so its UPDATEs and CLEAR follow it
+bool detectionReported = false;
+
+// A remote radio change is applied once its ACK has gone out
+bool radioRetunePending = false;
+
 // ============================================================================
 // FUNCTION DECLARATIONS
 // ============================================================================
@@ -104,6 +115,9 @@ void playDoorbellChime();
 void enterSleepMode();
 bool validateDetection(const DetectionEvent& event);
 void onLoRaMessage(uint8_t* data, uint8_t len, uint8_t from);
+uint8_t onConfigPacket(uint8_t op, uint16_t revision, const uint8_t* entries,
+                       uint8_t len, uint16_t* current);
+void applyConfig();
 
 // ============================================================================
 // SETUP
@@ -155,7 +169,10 @@ void setup() {
     currentState = STATE_ERROR;
   } else {
     Serial.println("LoRa initialized successfully");
+    lora.reconfigure(config.loraFrequency, config.loraTxPower,
+                     config.loraSpreadingFactor, config.nodeID, config.hubID);
     lora.setMessageCallback(onLoRaMessage);
+    lora.setConfigCallback(onConfigPacket);
   }
 
   // Initialize display
@@ -168,11 +185,19 @@ void setup() {
 
   // Send boot notification
   Serial.println("Sending boot notification...");
+  lora.sendAnnounce(config.nodeName.c_str(),
+                    NODE_CAP_ENV | NODE_CAP_DETECTION | NODE_CAP_DISPLAY |
+                    NODE_CAP_BAROGRAPH,
+                    0x10); // firmware 1.0
   uint16_t batteryMv = readBatteryVoltage();
   lora.sendHeartbeat(batteryMv);
 
-  // Read initial sensor values
-  envSensor.read();
+  // Hand periodic sensor reads to the scheduler
+  envSlot = scheduler.add(&envSensor);
+  scheduler.add(&motionSensor);
+  if (scheduler.enableLightSleep()) {
+    Serial.println("Light sleep between sensor reads enabled");
+  }
 
   currentMode = config.alarmMode;
   currentState = STATE_NORMAL;
@@ -195,6 +220,21 @@ void loop() {
   // Always process incoming LoRa messages
   lora.processIncoming();
 
+  // Remote config: retune after acknowledging a radio change, and go back
+  // to the old settings if the hub never confirmed it over the new ones
+  if (radioRetunePending) {
+    radioRetunePending = false;
+    applyConfig();
+  }
+  if (config.probationExpired()) {
+    config.rollbackRemote();
+    applyConfig();
+    lora.sendConfigAck(CONFIG_ROLLED_BACK, config.revision);
+  }
+
+  // Sensor reads run on their own periods in every state
+  scheduler.run();
+
   // Handle button presses
   if (now - lastButtonCheck >= 100) {
     handleButtons();
@@ -208,12 +248,10 @@ void loop() {
     // NORMAL OPERATION
     // ========================================================================
     case STATE_NORMAL:
-      // Read environmental sensors periodically
-      if (now - lastEnvRead >= 60000) { // Every 60 seconds
-        envSensor.read();
-        lastEnvRead = now;
+      // Check for storm warning after each new pressure sample
+      if (envSlot >= 0 && scheduler.getStats(envSlot).runs != lastEnvRuns) {
+        lastEnvRuns = scheduler.getStats(envSlot).runs;
 
-        // Check for storm warning
         if (envSensor.isStormApproaching()) {
           Serial.println("WARNING: Pressure falling rapidly - storm approaching!");
         }
@@ -241,6 +279,14 @@ void loop() {
         lastEnvTransmit = now;
       }
 
+      // Send the 48-hour barograph whenever a new hourly sample is in
+      if (envSensor.getBarograph().getHourlyCount() != lastBarographSent) {
+        uint16_t trace[BAROGRAPH_HOURS];
+        uint8_t n = envSensor.getBarograph().exportHourly(trace, BAROGRAPH_HOURS);
+        lora.sendBarograph(trace, n);
+        lastBarographSent = envSensor.getBarograph().getHourlyCount();
+      }
+
       // Send heartbeat
       if (now - lastHeartbeat >= config.heartbeatInterval) {
         lora.sendHeartbeat(readBatteryVoltage());
@@ -253,6 +299,9 @@ void loop() {
         lastDisplayUpdate = now;
       }
 
+      // Settled config changes go to flash here, never during an alarm
+      config.process();
+
       break;
 
     // ========================================================================
@@ -326,8 +375,21 @@ void loop() {
     lastBatteryCheck = now;
   }
 
-  // Small delay to prevent watchdog issues
-  delay(10);
+  // Sensor timing report
+  if (now - lastSchedulerReport >= 600000) {
+    scheduler.printStats(Serial);
+    display.printStats(Serial);
+    config.printStats(Serial);
+    lastSchedulerReport = now;
+  }
+
+  // Sleep until the next sensor release; buttons and the radio are polled
+  // at least every 100 ms. Alarm states keep the fast loop for the buzzer.
+  if (currentState == STATE_NORMAL) {
+    scheduler.idle(100);
+  } else {
+    delay(10);
+  }
 }
 
 // ============================================================================
@@ -356,6 +418,18 @@ uint16_t readBatteryVoltage() {
 void handleDetection() {
   DetectionEvent event = motionSensor.getEvent();
 
+  // Follow-up frames only for an approach the hub already knows about
+  if (event.phase != DETECTION_ONSET) {
+    if (detectionReported) {
+      lora.sendDetectionEvent(event);
+    }
+    if (event.phase == DETECTION_CLEAR) {
+      Serial.println("Detection cleared");
+      detectionReported = false;
+    }
+    return;
+  }
+
   Serial.println("Detection event!");
   Serial.print("  Confidence: ");
   Serial.print(event.confidence);
@@ -369,6 +443,7 @@ void handleDetection() {
     Serial.println("  -> Filtered as false positive");
     return;
   }
+  detectionReported = true;
 
   // Get effective mode (considering quiet hours)
   AlarmMode effectiveMode = config.getEffectiveAlarmMode();
@@ -456,8 +531,7 @@ void handleButtons() {
         break;
     }
 
-    config.alarmMode = currentMode;
-    config.save();
+    config.setAlarmMode(currentMode);
 
     Serial.print("Mode changed to: ");
     Serial.println(alarmModeToString(currentMode));
@@ -477,8 +551,7 @@ void handleButtons() {
       Serial.println("Alarm silenced/disarmed");
       currentState = STATE_NORMAL;
       currentMode = MODE_DISARMED;
-      config.alarmMode = MODE_DISARMED;
-      config.save();
+      config.setAlarmMode(MODE_DISARMED);
       noTone(BUZZER_PIN);
     }
 
@@ -556,3 +629,38 @@ void onLoRaMessage(uint8_t* data, uint8_t len, uint8_t from) {
     Serial.println("Alarm command received from hub");
   }
 }
+
+uint8_t onConfigPacket(uint8_t op, uint16_t revision, const uint8_t* entries,
+                       uint8_t len, uint16_t* current) {
+  uint8_t status = CONFIG_OK;
+
+  switch (op) {
+    case CONFIG_OP_QUERY:
+      status = config.onProbation() ? CONFIG_PENDING : CONFIG_OK;
+      break;
+
+    case CONFIG_OP_SET:
+      status = config.applyRemote(revision, entries, len);
+      if (status == CONFIG_OK) {
+        applyConfig();
+      } else if (status == CONFIG_PENDING) {
+        radioRetunePending = true;  // after the ACK, on the old settings
+      }
+      break;
+
+    case CONFIG_OP_CONFIRM:
+      status = config.confirmRemote(revision);
+      break;
+  }
+
+  *current = config.revision;
+  return status;
+}
+
+// Push settings that modules hold copies of
+void applyConfig() {
+  lora.reconfigure(config.loraFrequency, config.loraTxPower,
+                   config.loraSpreadingFactor, config.nodeID, config.hubID);
+  motionSensor.setZones(config.nearZoneMax, config.middleZoneMax, config.farZoneMax);
+  motionSensor.setSensitivity(config.getMinConfidence(), config.getMinDuration());
+}
@@ -2,32 +2,29 @@
 #define BME280_SENSOR_H
 
 #include "SensorBase.h"
-#include <Adafruit_BME280.h>
+#include "Barograph.h"
+#include "../../../lib/common/bme280_forced.h"
 
 /**
  * BME280 Environmental Sensor
- * Measures temperature, humidity, and barometric pressure
+ * Measures temperature, humidity, and barometric pressure.
+ * Runs in forced mode: the chip sleeps until read() triggers a conversion,
+ * then T/P/H are fetched in one burst and compensated together.
  */
 class BME280Sensor : public SensorBase {
 private:
-  Adafruit_BME280 bme;
+  bme280::Forced bme;
   float temperature;     // Celsius
   float humidity;        // Percentage
   float pressure;        // hPa
   bool initialized;
 
-  // For trend calculation
-  static const int HISTORY_SIZE = 12; // 1 hour at 5-minute intervals
-  float pressureHistory[HISTORY_SIZE];
-  int historyIndex;
-  unsigned long lastHistoryUpdate;
+  // Pressure history for trend and barograph export
+  Barograph barograph;
 
 public:
   BME280Sensor() : temperature(0), humidity(0), pressure(0),
-                   initialized(false), historyIndex(0),
-                   lastHistoryUpdate(0) {
-    memset(pressureHistory, 0, sizeof(pressureHistory));
-  }
+                   initialized(false) {}
 
   bool begin() override {
     // Try I2C address 0x76 first, then 0x77
@@ -37,14 +34,6 @@ public:
     }
 
     if (initialized) {
-      // Configure sensor for weather monitoring
-      bme.setSampling(Adafruit_BME280::MODE_NORMAL,
-                     Adafruit_BME280::SAMPLING_X2,  // temperature
-                     Adafruit_BME280::SAMPLING_X16, // pressure
-                     Adafruit_BME280::SAMPLING_X1,  // humidity
-                     Adafruit_BME280::FILTER_X16,
-                     Adafruit_BME280::STANDBY_MS_1000);
-
       // Initial reading
       read();
     }
@@ -55,30 +44,33 @@ public:
   bool read() override {
     if (!initialized) return false;
 
-    temperature = bme.readTemperature();
-    humidity = bme.readHumidity();
-    pressure = bme.readPressure() / 100.0F; // Pa to hPa
-
-    // Update pressure history every 5 minutes
-    unsigned long now = millis();
-    if (now - lastHistoryUpdate >= 300000) { // 5 minutes
-      pressureHistory[historyIndex] = pressure;
-      historyIndex = (historyIndex + 1) % HISTORY_SIZE;
-      lastHistoryUpdate = now;
-    }
-
-    // Check for valid readings
-    if (isnan(temperature) || isnan(humidity) || isnan(pressure)) {
+    // One conversion per call, only when the caller's schedule says so
+    bme280::Reading r;
+    if (!bme.measure(r)) {
       return false;
     }
 
+    temperature = r.temperature();
+    humidity = r.humidity();
+    pressure = r.pressure_hpa();
+
+    // Every reading feeds the current 5-minute slot of the history
+    barograph.addReading(pressure, millis());
+
     return true;
   }
 
   bool isAvailable() override {
-    return initialized && (bme.sensorID() == 0x60); // BME280 chip ID
+    return initialized && bme.present();
   }
 
+  // One forced conversion a minute; the 10 ms conversion plus burst read
+  // must finish well inside 50 ms
+  const char* getName() const override { return "BME280"; }
+  uint32_t getPeriodMs() const override { return 60000; }
+  uint32_t getDeadlineMs() const override { return 50; }
+  uint8_t getPriority() const override { return 1; }
+
   String getStatusString() override {
     if (!initialized) return "BME280: Not initialized";
 
@@ -93,20 +85,20 @@ public:
   float getHumidity() const { return humidity; }
   float getPressure() const { return pressure; }
 
-  // Get pressure trend (change in hPa over 3 hours)
-  // Returns: >0 rising, <0 falling, ~0 stable
+  // Get pressure trend (change in hPa over 3 hours, least-squares fit)
+  // Returns: >0 rising, <0 falling, ~0 stable (also while history builds up)
   float getPressureTrend() {
-    // Need at least 36 minutes of data (9 readings at 5-min intervals for 3 hours)
-    int oldestIndex = (historyIndex + 1) % HISTORY_SIZE;
-    if (pressureHistory[oldestIndex] == 0) {
-      return 0; // Not enough data yet
-    }
+    float trend = barograph.trend(180);
+    return isnan(trend) ? 0 : trend;
+  }
 
-    float oldest = pressureHistory[oldestIndex];
-    float current = pressure;
-    return current - oldest; // Positive = rising, negative = falling
+  // Pressure change in hPa over any window up to 7 days (NAN if no data)
+  float getPressureTrend(uint32_t minutes) const {
+    return barograph.trend(minutes);
   }
 
+  const Barograph& getBarograph() const { return barograph; }
+
   // Get trend arrow symbol
   const char* getTrendArrow() {
     float trend = getPressureTrend();
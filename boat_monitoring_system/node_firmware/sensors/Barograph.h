@@ -0,0 +1,166 @@
+#ifndef BAROGRAPH_H
+#define BAROGRAPH_H
+
+#include <Arduino.h>
+#include "../../common/CommonTypes.h"
+
+/**
+ * Multi-resolution pressure history
+ *
+ * Three ring buffers, each fed by averaging the one below it:
+ *   5 min x 36  (3 hours)
+ *   1 h   x 48  (48 hours, exported to the hub as the barograph trace)
+ *   6 h   x 28  (7 days)
+ * Samples are stored as hPa * 10; 0 marks a slot with no readings.
+ */
+class Barograph {
+public:
+  static const uint8_t FINE_SIZE = 36;
+  static const uint8_t HOURLY_SIZE = BAROGRAPH_HOURS;
+  static const uint8_t SIX_HOUR_SIZE = 28;
+  static const uint32_t FINE_PERIOD_MS = 300000;  // 5 minutes
+  static const uint8_t FINE_PER_HOUR = 12;
+  static const uint8_t HOURS_PER_SIX = 6;
+
+private:
+  template <uint8_t N>
+  struct Ring {
+    uint16_t data[N];
+    uint8_t head = 0;    // next write slot
+    uint8_t count = 0;
+
+    void push(uint16_t v) {
+      data[head] = v;
+      head = (head + 1) % N;
+      if (count < N) count++;
+    }
+    // i = 0 is the newest sample
+    uint16_t recent(uint8_t i) const { return data[(head + N - 1 - i) % N]; }
+  };
+
+  // Running average feeding the next tier up
+  struct Accumulator {
+    uint32_t sum = 0;
+    uint8_t valid = 0;
+    uint8_t slots = 0;
+
+    void add(uint16_t v) {
+      if (v) { sum += v; valid++; }
+      slots++;
+    }
+    uint16_t take() {
+      uint16_t avg = valid ? (uint16_t)((sum + valid / 2) / valid) : 0;
+      sum = 0; valid = 0; slots = 0;
+      return avg;
+    }
+  };
+
+  Ring<FINE_SIZE> fine;
+  Ring<HOURLY_SIZE> hourly;
+  Ring<SIX_HOUR_SIZE> sixHour;
+  Accumulator bucket;      // readings in the current 5-minute slot
+  Accumulator hourAcc;
+  Accumulator sixAcc;
+  unsigned long bucketStart;
+  bool started;
+  uint32_t hourlyPushed;
+
+public:
+  Barograph() : bucketStart(0), started(false), hourlyPushed(0) {}
+
+  // Feed every pressure reading; slots close on the 5-minute boundary
+  void addReading(float hPa, unsigned long now) {
+    if (!started) {
+      bucketStart = now;
+      started = true;
+    }
+
+    // Close elapsed slots, leaving gaps for any with no readings
+    // (bounded by the 7-day span of the coarsest tier)
+    uint16_t closed = 0;
+    while (now - bucketStart >= FINE_PERIOD_MS &&
+           closed < (uint16_t)SIX_HOUR_SIZE * HOURS_PER_SIX * FINE_PER_HOUR) {
+      closeSlot();
+      bucketStart += FINE_PERIOD_MS;
+      closed++;
+    }
+    if (now - bucketStart >= FINE_PERIOD_MS) {
+      bucketStart = now; // longer outage: history is all gaps anyway
+    }
+
+    if (hPa > 300 && hPa < 1100) {
+      bucket.sum += (uint32_t)(hPa * 10 + 0.5f);
+      bucket.valid++;
+    }
+  }
+
+  // Pressure change in hPa over the last `minutes`, from a least-squares fit
+  // on the finest tier that covers the window. NAN if there is not enough
+  // history (fewer than 3 samples, or less than half the window covered).
+  float trend(uint32_t minutes) const {
+    if (minutes <= (uint32_t)FINE_SIZE * 5) {
+      return fitSlope(fine, minutes / 5, 5.0f) * minutes;
+    }
+    if (minutes <= (uint32_t)HOURLY_SIZE * 60) {
+      return fitSlope(hourly, minutes / 60, 60.0f) * minutes;
+    }
+    return fitSlope(sixHour, minutes / 360, 360.0f) * minutes;
+  }
+
+  // Hourly trace, oldest first, hPa * 10 (0 = no data). Returns count.
+  uint8_t exportHourly(uint16_t* out, uint8_t maxCount) const {
+    uint8_t n = hourly.count < maxCount ? hourly.count : maxCount;
+    for (uint8_t i = 0; i < n; i++) {
+      out[i] = hourly.recent(n - 1 - i);
+    }
+    return n;
+  }
+
+  // Total hourly samples produced; changes once per hour
+  uint32_t getHourlyCount() const { return hourlyPushed; }
+
+private:
+  void closeSlot() {
+    uint16_t v = bucket.take();
+    fine.push(v);
+
+    hourAcc.add(v);
+    if (hourAcc.slots >= FINE_PER_HOUR) {
+      uint16_t h = hourAcc.take();
+      hourly.push(h);
+      hourlyPushed++;
+
+      sixAcc.add(h);
+      if (sixAcc.slots >= HOURS_PER_SIX) {
+        sixHour.push(sixAcc.take());
+      }
+    }
+  }
+
+  // Slope in hPa per minute over the newest `n` samples of a ring
+  template <uint8_t N>
+  static float fitSlope(const Ring<N>& ring, uint32_t n, float periodMin) {
+    const uint32_t window = n;
+    if (n > ring.count) n = ring.count;
+
+    // x = sample age in periods (newest 0), y = hPa*10; skip gaps
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint32_t valid = 0, oldest = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      uint16_t v = ring.recent(i);
+      if (!v) continue;
+      float x = -(float)i;
+      sx += x; sy += v; sxx += x * x; sxy += x * v;
+      valid++;
+      oldest = i;
+    }
+    if (valid < 3 || oldest * 2 < window) return NAN;
+
+    float denom = valid * sxx - sx * sx;
+    if (denom == 0) return NAN;
+    float slope = (valid * sxy - sx * sy) / denom; // (hPa*10) per period
+    return slope / 10.0f / periodMin;
+  }
+};
+
+#endif // BAROGRAPH_H
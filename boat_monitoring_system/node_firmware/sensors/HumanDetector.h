@@ -7,6 +7,15 @@
 /**
  * Human Presence Detector using mmWave Radar
  * Supports HLK-LD2410 and similar UART-based mmWave sensors
+ *
+ * Raw presence is turned into an event lifecycle:
+ *   IDLE -> PENDING     presence seen, waiting out minDuration
+ *   PENDING -> ACTIVE   sustained and confident: one ONSET event
+ *   ACTIVE              UPDATE events, at most one per updateInterval
+ *                       (sooner, but never within minUpdateGap, on a zone change)
+ *   ACTIVE -> IDLE      absent for clearHold: one CLEAR event
+ * A new ONSET is held off for refractoryPeriod after a CLEAR, so someone
+ * lingering at the edge of range is reported once, not once per dropout.
  */
 class HumanDetector : public SensorBase {
 private:
@@ -21,6 +30,22 @@ private:
   unsigned long detectionStartTime;
   unsigned long lastReadTime;
 
+  // Event lifecycle
+  enum LifecycleState { LC_IDLE, LC_PENDING, LC_ACTIVE };
+  static const uint8_t NO_EVENT = 0xFF;
+
+  LifecycleState lifecycle;
+  uint8_t pendingPhase;          // DetectionPhase waiting for detectionEvent()
+  uint8_t reportedZone;
+  unsigned long lastPresentTime;
+  unsigned long lastEventTime;
+  unsigned long clearTime;
+
+  uint32_t updateInterval;       // ms between periodic UPDATEs (default 30 s)
+  uint32_t minUpdateGap;         // ms floor for zone-change UPDATEs (default 5 s)
+  uint32_t clearHold;            // ms of absence before CLEAR (default 3 s)
+  uint32_t refractoryPeriod;     // ms after CLEAR before a new ONSET (default 10 s)
+
   // Configuration
   uint16_t nearZoneMax;      // cm (default 100)
   uint16_t middleZoneMax;    // cm (default 300)
@@ -37,6 +62,10 @@ public:
     : serial(ser), rxPin(rx), txPin(tx),
       presenceDetected(false), distance(0), confidence(0), zone(0),
       detectionStartTime(0), lastReadTime(0),
+      lifecycle(LC_IDLE), pendingPhase(NO_EVENT), reportedZone(0),
+      lastPresentTime(0), lastEventTime(0), clearTime(0),
+      updateInterval(30000), minUpdateGap(5000), clearHold(3000),
+      refractoryPeriod(10000),
       nearZoneMax(100), middleZoneMax(300), farZoneMax(600),
       minConfidence(70), minDuration(2000),
       useMotionCompensation(false), motionThreshold(5.0) {}
@@ -84,9 +113,18 @@ public:
       }
     }
 
+    updateLifecycle(millis());
     return true;
   }
 
+  // The LD2410 streams ~10 frames/s; draining the UART every 50 ms keeps the
+  // 256-byte RX FIFO from overflowing. Detection latency matters most, so
+  // this outranks the environmental sensors.
+  const char* getName() const override { return "mmWave"; }
+  uint32_t getPeriodMs() const override { return 50; }
+  uint32_t getDeadlineMs() const override { return 10; }
+  uint8_t getPriority() const override { return 2; }
+
   bool isAvailable() override {
     return serial && (millis() - lastReadTime < 5000); // Sensor responding within 5s
   }
@@ -101,32 +139,10 @@ public:
     return "Clear";
   }
 
-  // Check if there's a valid detection event
+  // True once per lifecycle event (ONSET / UPDATE / CLEAR); the event is
+  // consumed by the following getEvent()
   bool detectionEvent() {
-    if (!presenceDetected) {
-      detectionStartTime = 0;
-      return false;
-    }
-
-    // First detection
-    if (detectionStartTime == 0) {
-      detectionStartTime = millis();
-      return false; // Not sustained yet
-    }
-
-    // Check sustained duration
-    unsigned long duration = millis() - detectionStartTime;
-    if (duration < minDuration) {
-      return false; // Not sustained long enough
-    }
-
-    // Check confidence threshold
-    if (confidence < minConfidence) {
-      detectionStartTime = 0;
-      return false;
-    }
-
-    return true; // Valid detection
+    return pendingPhase != NO_EVENT;
   }
 
   // Get detection event structure
@@ -139,6 +155,8 @@ public:
     event.timestamp = millis();
     event.duration = detectionStartTime > 0 ? (millis() - detectionStartTime) : 0;
     event.eventType = 0x01; // Approach (default)
+    event.phase = pendingPhase == NO_EVENT ? DETECTION_UPDATE : pendingPhase;
+    pendingPhase = NO_EVENT;
 
     // Determine event type based on zone
     if (zone == 0) {
@@ -162,6 +180,14 @@ public:
     minDuration = minDur;
   }
 
+  void setEventTiming(uint32_t updateMs, uint32_t minGapMs,
+                      uint32_t clearMs, uint32_t refractoryMs) {
+    updateInterval = updateMs;
+    minUpdateGap = minGapMs;
+    clearHold = clearMs;
+    refractoryPeriod = refractoryMs;
+  }
+
   void enableMotionCompensation(bool enable, float threshold = 5.0) {
     useMotionCompensation = enable;
     motionThreshold = threshold;
@@ -174,6 +200,58 @@ public:
   uint8_t getZone() const { return zone; }
 
 private:
+  void postEvent(uint8_t phase, unsigned long now) {
+    // An unconsumed ONSET is never overwritten by an UPDATE
+    if (!(pendingPhase == DETECTION_ONSET && phase == DETECTION_UPDATE)) {
+      pendingPhase = phase;
+    }
+    lastEventTime = now;
+  }
+
+  void updateLifecycle(unsigned long now) {
+    if (presenceDetected) {
+      lastPresentTime = now;
+    }
+
+    switch (lifecycle) {
+      case LC_IDLE:
+        if (presenceDetected) {
+          detectionStartTime = now;
+          lifecycle = LC_PENDING;
+        }
+        break;
+
+      case LC_PENDING:
+        if (!presenceDetected || confidence < minConfidence) {
+          // Dropped out or too weak before it was sustained: start over
+          detectionStartTime = 0;
+          lifecycle = LC_IDLE;
+        } else if (now - detectionStartTime >= minDuration &&
+                   (clearTime == 0 || now - clearTime >= refractoryPeriod)) {
+          reportedZone = zone;
+          lifecycle = LC_ACTIVE;
+          postEvent(DETECTION_ONSET, now);
+        }
+        break;
+
+      case LC_ACTIVE:
+        if (now - lastPresentTime >= clearHold) {
+          clearTime = now;
+          detectionStartTime = 0;
+          lifecycle = LC_IDLE;
+          postEvent(DETECTION_CLEAR, now);
+        } else if (presenceDetected) {
+          unsigned long sinceLast = now - lastEventTime;
+          if (sinceLast >= updateInterval ||
+              (zone != reportedZone && sinceLast >= minUpdateGap)) {
+            reportedZone = zone;
+            postEvent(DETECTION_UPDATE, now);
+          }
+        }
+        break;
+    }
+  }
+
   void configureLD2410() {
     // Send configuration commands to HLK-LD2410
     // This is sensor-specific and should be adjusted based on datasheet
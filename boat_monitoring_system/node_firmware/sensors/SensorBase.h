@@ -22,6 +22,14 @@ public:
 
   // Get human-readable status string
   virtual String getStatusString() = 0;
+
+  // Scheduling parameters, used by SensorScheduler.
+  // read() is released every period and should complete within deadline
+  // of its release; when several sensors are due, higher priority runs first.
+  virtual const char* getName() const { return "Sensor"; }
+  virtual uint32_t getPeriodMs() const { return 1000; }
+  virtual uint32_t getDeadlineMs() const { return getPeriodMs(); }
+  virtual uint8_t getPriority() const { return 0; }
 };
 
 #endif // SENSOR_BASE_H
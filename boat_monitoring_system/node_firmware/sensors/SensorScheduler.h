@@ -0,0 +1,207 @@
+#ifndef SENSOR_SCHEDULER_H
+#define SENSOR_SCHEDULER_H
+
+#include <Arduino.h>
+#include "SensorBase.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#endif
+
+#define MAX_SCHEDULED_SENSORS 8
+
+/**
+ * Per-sensor timing statistics (all times in microseconds)
+ */
+struct SensorStats {
+  uint32_t runs;
+  uint32_t failures;        // read() returned false
+  uint32_t deadlineMisses;  // finished later than release + deadline
+  uint32_t overruns;        // releases skipped because the sensor fell behind
+  uint32_t execLastUs;
+  uint32_t execMaxUs;
+  uint32_t execAvgUs;       // EWMA, 1/8 weight
+  uint32_t jitterMaxUs;     // start - release
+  uint32_t jitterAvgUs;     // EWMA, 1/8 weight
+};
+
+/**
+ * Sensor registry and cooperative run queue
+ *
+ * Each registered SensorBase declares its period, deadline and priority.
+ * run() executes every sensor whose release time has passed, highest
+ * priority first (earliest release breaks ties), and records execution time
+ * and release jitter. idle() then blocks until the next release so the
+ * FreeRTOS idle task can drop into tickless light sleep when the build
+ * enables it (CONFIG_PM_ENABLE + CONFIG_FREERTOS_USE_TICKLESS_IDLE).
+ *
+ * Release times are kept in micros() and compared wrap-safely, so periods
+ * must stay below ~35 minutes.
+ */
+class SensorScheduler {
+private:
+  struct Entry {
+    SensorBase* sensor;
+    uint32_t periodUs;
+    uint32_t deadlineUs;
+    uint8_t priority;
+    uint32_t releaseUs;
+    SensorStats stats;
+  };
+
+  Entry entries[MAX_SCHEDULED_SENSORS];
+  uint8_t count;
+
+  static bool due(uint32_t releaseUs, uint32_t nowUs) {
+    return (int32_t)(nowUs - releaseUs) >= 0;
+  }
+
+  static uint32_t ewma(uint32_t avg, uint32_t sample, uint32_t runs) {
+    return runs == 1 ? sample : avg - (avg >> 3) + (sample >> 3);
+  }
+
+  void execute(Entry& e, uint32_t startUs) {
+    SensorStats& s = e.stats;
+    uint32_t jitter = startUs - e.releaseUs;
+
+    bool ok = e.sensor->read();
+    uint32_t endUs = micros();
+    uint32_t exec = endUs - startUs;
+
+    s.runs++;
+    if (!ok) s.failures++;
+    if (endUs - e.releaseUs > e.deadlineUs) s.deadlineMisses++;
+    s.execLastUs = exec;
+    if (exec > s.execMaxUs) s.execMaxUs = exec;
+    s.execAvgUs = ewma(s.execAvgUs, exec, s.runs);
+    if (jitter > s.jitterMaxUs) s.jitterMaxUs = jitter;
+    s.jitterAvgUs = ewma(s.jitterAvgUs, jitter, s.runs);
+
+    // Keep the release grid; if we fell a whole period behind, skip ahead
+    // rather than running back-to-back to catch up
+    e.releaseUs += e.periodUs;
+    if (due(e.releaseUs, endUs)) {
+      uint32_t missed = (endUs - e.releaseUs) / e.periodUs + 1;
+      s.overruns += missed;
+      e.releaseUs += missed * e.periodUs;
+    }
+  }
+
+public:
+  SensorScheduler() : count(0) {}
+
+  // Returns the slot index, or -1 if the registry is full
+  int8_t add(SensorBase* sensor) {
+    if (!sensor || count >= MAX_SCHEDULED_SENSORS) {
+      return -1;
+    }
+
+    Entry& e = entries[count];
+    memset(&e, 0, sizeof(e));
+    e.sensor = sensor;
+    e.periodUs = sensor->getPeriodMs() * 1000UL;
+    e.deadlineUs = sensor->getDeadlineMs() * 1000UL;
+    e.priority = sensor->getPriority();
+    e.releaseUs = micros();  // first read at the next run()
+    return count++;
+  }
+
+  // Run every sensor that is due. Returns the number of reads executed.
+  uint8_t run() {
+    uint8_t ran = 0;
+
+    // At most one pass per sensor, so a read that overruns cannot starve
+    // the caller
+    for (uint8_t pass = 0; pass < count; pass++) {
+      uint32_t now = micros();
+      Entry* next = nullptr;
+
+      for (uint8_t i = 0; i < count; i++) {
+        Entry& e = entries[i];
+        if (!due(e.releaseUs, now)) continue;
+        if (!next || e.priority > next->priority ||
+            (e.priority == next->priority &&
+             (int32_t)(e.releaseUs - next->releaseUs) < 0)) {
+          next = &e;
+        }
+      }
+
+      if (!next) break;
+      execute(*next, now);
+      ran++;
+    }
+
+    return ran;
+  }
+
+  // Milliseconds until the earliest release (0 if one is already due)
+  uint32_t msUntilNextRelease() const {
+    if (count == 0) return UINT32_MAX;
+
+    uint32_t now = micros();
+    uint32_t best = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+      if (due(entries[i].releaseUs, now)) return 0;
+      uint32_t wait = entries[i].releaseUs - now;
+      if (wait < best) best = wait;
+    }
+    return (best + 999) / 1000;
+  }
+
+  // Block until the next release, or maxMs, whichever comes first.
+  // vTaskDelay lets the idle task enter tickless light sleep in between.
+  void idle(uint32_t maxMs) {
+    uint32_t wait = msUntilNextRelease();
+    if (wait > maxMs) wait = maxMs;
+    if (wait > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait));
+    }
+  }
+
+  // Allow automatic light sleep between releases. Returns false if the
+  // framework was built without power management (stock Arduino-ESP32).
+  bool enableLightSleep(uint16_t maxFreqMhz = 240, uint16_t minFreqMhz = 40) {
+#if defined(CONFIG_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE) && \
+    ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pm = {};
+    pm.max_freq_mhz = maxFreqMhz;
+    pm.min_freq_mhz = minFreqMhz;
+    pm.light_sleep_enable = true;
+    return esp_pm_configure(&pm) == ESP_OK;
+#else
+    (void)maxFreqMhz;
+    (void)minFreqMhz;
+    return false;
+#endif
+  }
+
+  uint8_t getCount() const { return count; }
+
+  const SensorStats& getStats(uint8_t slot) const { return entries[slot].stats; }
+
+  void resetStats() {
+    for (uint8_t i = 0; i < count; i++) {
+      memset(&entries[i].stats, 0, sizeof(SensorStats));
+    }
+  }
+
+  void printStats(Print& out) const {
+    for (uint8_t i = 0; i < count; i++) {
+      const Entry& e = entries[i];
+      const SensorStats& s = e.stats;
+      char buf[160];
+      snprintf(buf, sizeof(buf),
+               "%-8s runs=%lu fail=%lu miss=%lu skip=%lu "
+               "exec avg/max=%lu/%luus jitter avg/max=%lu/%luus",
+               e.sensor->getName(),
+               (unsigned long)s.runs, (unsigned long)s.failures,
+               (unsigned long)s.deadlineMisses, (unsigned long)s.overruns,
+               (unsigned long)s.execAvgUs, (unsigned long)s.execMaxUs,
+               (unsigned long)s.jitterAvgUs, (unsigned long)s.jitterMaxUs);
+      out.println(buf);
+    }
+  }
+};
+
+#endif // SENSOR_SCHEDULER_H
@@ -1,11 +1,11 @@
 #include "WindSensor.h"
 
-// Wind direction lookup tables
-const int WIND_DIR_RESISTOR_VALUES[] = {0, 1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000};
-const float WIND_DIR_ANGLES[] = {0, 22.5, 45, 67.5, 90, 112.5, 135, 157.5, 180, 202.5, 225, 247.5, 270, 292.5, 315, 337.5};
-const int WIND_DIR_TABLE_SIZE = 16;
+// Default wind direction ladder
+const uint32_t WIND_DIR_RESISTORS[] = WIND_DIR_RESISTOR_VALUES;
+const float WIND_DIR_DEGREES[] = WIND_DIR_ANGLES;
+const int WIND_DIR_TABLE_SIZE = sizeof(WIND_DIR_RESISTORS) / sizeof(WIND_DIR_RESISTORS[0]);
 
-WindSensor::WindSensor() {
+WindSensor::WindSensor() : vaneReader(vaneTable) {
     apparentWindSpeed = 0.0;
     apparentWindDirection = 0.0;
     trueWindSpeed = 0.0;
@@ -13,6 +13,7 @@ WindSensor::WindSensor() {
     boatSpeed = 0.0;
     boatHeading = 0.0;
     boatCourse = 0.0;
+    calibratingCompass = false;
 }
 
 void WindSensor::begin() {
@@ -34,6 +35,20 @@ void WindSensor::begin() {
         Serial.println("LSM303 magnetometer not found");
     }
 
+    if (!compass::load(compassCal)) {
+        Serial.println("No compass calibration stored - using raw magnetometer");
+    }
+
+    // Vane table: stored calibration sweep, else the nominal ladder
+    if (!vane::load(vaneSweep) || !vaneTable.build(vaneSweep.kind, vaneSweep.pts, vaneSweep.count)) {
+        vane::Point pts[WIND_DIR_TABLE_SIZE];
+        for (int i = 0; i < WIND_DIR_TABLE_SIZE; i++) {
+            pts[i].code = vane::resistor_code(WIND_DIR_RESISTORS[i], WIND_DIR_PULLUP_OHMS);
+            pts[i].deg10 = (uint16_t)(WIND_DIR_DEGREES[i] * 10);
+        }
+        vaneTable.build(vane::DISCRETE, pts, WIND_DIR_TABLE_SIZE);
+    }
+
     // Configure wind sensor pins
     pinMode(WIND_SPEED_PIN, INPUT);
     pinMode(WIND_DIR_PIN, INPUT);
@@ -55,9 +70,14 @@ void WindSensor::update() {
     accel->getEvent(&accel_event);
     mag->getEvent(&mag_event);
 
-    // Calculate heading from magnetometer
-    float heading = atan2(mag_event.magnetic.y, mag_event.magnetic.x) * 180.0 / PI;
-    boatHeading = normalizeAngle(heading);
+    // Iron-corrected, tilt-compensated heading
+    compass::Vec3 rawMag = {mag_event.magnetic.x, mag_event.magnetic.y, mag_event.magnetic.z};
+    if (calibratingCompass) {
+        compassFitter.add(rawMag);
+    }
+    compass::Vec3 m = compassCal.valid() ? compass::apply(compassCal, rawMag) : rawMag;
+    compass::Vec3 g = {accel_event.acceleration.x, accel_event.acceleration.y, accel_event.acceleration.z};
+    boatHeading = compass::tilt_heading(m, g);
 
     // Read wind sensors
     apparentWindSpeed = readWindSpeed();
@@ -67,6 +87,23 @@ void WindSensor::update() {
     calculateTrueWind();
 }
 
+void WindSensor::beginCompassCalibration() {
+    compassFitter.reset();
+    calibratingCompass = true;
+}
+
+bool WindSensor::finishCompassCalibration() {
+    calibratingCompass = false;
+    compass::Calibration cal;
+    if (!compassFitter.solve(cal)) {
+        Serial.println("Compass calibration failed - rotate through more orientations");
+        return false;
+    }
+    compassCal = cal;
+    compass::save(compassCal);
+    return true;
+}
+
 float WindSensor::readWindSpeed() {
     int adcValue = analogRead(WIND_SPEED_PIN);
     float voltage = adcValue * (3.3 / 4095.0); // ESP32 ADC
@@ -79,23 +116,24 @@ float WindSensor::readWindSpeed() {
 }
 
 float WindSensor::readWindDirection() {
-    int adcValue = analogRead(WIND_DIR_PIN);
-    float voltage = adcValue * (3.3 / 4095.0);
-    int resistance = voltage / (3.3 - voltage) * 10000; // Assuming 10k pull-up
-
-    // Find closest resistance value in lookup table
-    int closestIndex = 0;
-    int minDiff = abs(resistance - WIND_DIR_RESISTOR_VALUES[0]);
-
-    for (int i = 1; i < WIND_DIR_TABLE_SIZE; i++) {
-        int diff = abs(resistance - WIND_DIR_RESISTOR_VALUES[i]);
-        if (diff < minDiff) {
-            minDiff = diff;
-            closestIndex = i;
-        }
-    }
+    return vaneReader.read(analogRead(WIND_DIR_PIN)) / 10.0;
+}
 
-    return WIND_DIR_ANGLES[closestIndex];
+void WindSensor::beginVaneCalibration() {
+    vaneSweep.reset(vane::DISCRETE);
+}
+
+bool WindSensor::addVanePoint(float degrees) {
+    return vaneSweep.add(analogRead(WIND_DIR_PIN), (uint16_t)(degrees * 10));
+}
+
+bool WindSensor::finishVaneCalibration() {
+    if (!vaneTable.build(vaneSweep.kind, vaneSweep.pts, vaneSweep.count)) {
+        Serial.println("Vane calibration failed - need distinct readings at 2+ positions");
+        return false;
+    }
+    vane::save(vaneSweep);
+    return true;
 }
 
 void WindSensor::calculateTrueWind() {
@@ -7,6 +7,8 @@
 #include <Adafruit_LSM303_Accel.h>
 #include <Adafruit_LSM303DLH_Mag.h>
 #include <Adafruit_Sensor.h>
+#include "../../../lib/common/compass_cal.h"
+#include "../../../lib/common/vane_cal.h"
 
 // Wind sensor pins
 #define WIND_SPEED_PIN A0        // Analog input for anemometer
@@ -17,7 +19,9 @@
 #define WIND_SPEED_V_MAX 2.0     // Maximum voltage for wind speed
 #define WIND_SPEED_MAX 32.4      // Maximum wind speed in m/s
 
-// Wind direction potentiometer values (0-360 degrees)
+// Wind direction resistor ladder (0-360 degrees), read against a pull-up.
+// Default vane table until a calibration sweep is stored.
+#define WIND_DIR_PULLUP_OHMS 10000
 #define WIND_DIR_RESISTOR_VALUES {0, 1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000}
 #define WIND_DIR_ANGLES {0, 22.5, 45, 67.5, 90, 112.5, 135, 157.5, 180, 202.5, 225, 247.5, 270, 292.5, 315, 337.5}
 
@@ -27,6 +31,15 @@ public:
     void begin();
     void update();
 
+    // Compass calibration (hard/soft iron), persisted to NVS
+    void beginCompassCalibration();
+    bool finishCompassCalibration();
+
+    // Vane calibration sweep: step the vane through known angles
+    void beginVaneCalibration();
+    bool addVanePoint(float degrees);
+    bool finishVaneCalibration();
+
     // Wind data
     float apparentWindSpeed;    // m/s
     float apparentWindDirection; // degrees (0-360)
@@ -44,6 +57,14 @@ private:
     Adafruit_LSM303_Accel_Unified* accel;
     Adafruit_LSM303DLH_Mag_Unified* mag;
 
+    compass::Calibration compassCal;
+    compass::Fitter compassFitter;
+    bool calibratingCompass;
+
+    vane::Table vaneTable;
+    vane::Reader vaneReader;
+    vane::Sweep vaneSweep;
+
     // Helper functions
     float readWindSpeed();
     float readWindDirection();
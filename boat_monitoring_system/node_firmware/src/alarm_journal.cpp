@@ -0,0 +1,2 @@
+// Builds lib/common/alarm_journal.cpp into the node sketch (see src/README.md)
+#include "../../../lib/common/alarm_journal.cpp"
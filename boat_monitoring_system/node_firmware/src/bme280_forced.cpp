@@ -0,0 +1,2 @@
+// Builds lib/common/bme280_forced.cpp into the node sketch (see src/README.md)
+#include "../../../lib/common/bme280_forced.cpp"
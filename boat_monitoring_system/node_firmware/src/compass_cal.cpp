@@ -0,0 +1,2 @@
+// Builds lib/common/compass_cal.cpp into the node sketch (see src/README.md)
+#include "../../../lib/common/compass_cal.cpp"
@@ -0,0 +1,2 @@
+// Builds lib/common/i2c_bus.cpp into the node sketch (see src/README.md)
+#include "../../../lib/common/i2c_bus.cpp"
@@ -0,0 +1,2 @@
+// Builds lib/common/vane_cal.cpp into the node sketch (see src/README.md)
+#include "../../../lib/common/vane_cal.cpp"
@@ -0,0 +1,163 @@
+/**
+ * compasscheck - compass iron calibration fit on synthetic rotations (host)
+ *
+ * Build:  g++ -std=c++11 -O2 -Itools/host -o compasscheck tools/compasscheck.cpp
+ *
+ * Usage:  compasscheck [samples]
+ *
+ * Compiles lib/common/compass_cal against an in-memory Preferences. A
+ * 48 uT field at 60 degrees inclination is seen through a known hard-iron
+ * offset and a symmetric soft-iron matrix, with 0.3 uT of noise, while the
+ * sensor rolls, pitches and yaws through random orientations (a logged
+ * figure-eight rotation). The fit must recover:
+ *   - the offset to within 0.5 uT,
+ *   - the soft-iron matrix up to scale (correction x distortion within
+ *     2% of a multiple of the identity),
+ *   - headings from the corrected field and the accelerometer, tilted up
+ *     to 30 degrees, to within 1 degree of the undistorted level heading.
+ * A flat spin, which cannot constrain the vertical axis, must be refused,
+ * and the calibration must round-trip through NVS. Exits 1 on any failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../lib/common/compass_cal.cpp"
+#include "../../lib/common/crc8.cpp"
+
+namespace {
+
+using compass::Vec3;
+
+const double DEG = M_PI / 180;
+const double FIELD_UT = 48;
+const double DIP = 60 * DEG;
+const double OFFSET[3] = { 12.5, -7.0, 25.0 };
+const double SOFT[3][3] = { { 1.10, 0.06, 0.02 },
+                            { 0.06, 0.93, -0.04 },
+                            { 0.02, -0.04, 1.03 } };
+
+double uniform(double lo, double hi) { return lo + (hi - lo) * rand() / RAND_MAX; }
+
+double gauss(double sigma) {
+  double u = uniform(1e-12, 1), v = uniform(0, 1);
+  return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Body-to-world rotation: yaw about z, then pitch about y, then roll about x
+void rotation(double yaw, double pitch, double roll, double r[3][3]) {
+  double cy = cos(yaw), sy = sin(yaw), cp = cos(pitch), sp = sin(pitch);
+  double cr = cos(roll), sr = sin(roll);
+  double m[3][3] = { { cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr },
+                     { sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr },
+                     { -sp, cp * sr, cp * cr } };
+  memcpy(r, m, sizeof(m));
+}
+
+// World vector w seen in the sensor frame: R' w
+Vec3 toSensor(const double r[3][3], const double w[3]) {
+  return { (float)(r[0][0] * w[0] + r[1][0] * w[1] + r[2][0] * w[2]),
+           (float)(r[0][1] * w[0] + r[1][1] * w[1] + r[2][1] * w[2]),
+           (float)(r[0][2] * w[0] + r[1][2] * w[1] + r[2][2] * w[2]) };
+}
+
+const double EARTH[3] = { FIELD_UT * cos(DIP), 0, -FIELD_UT * sin(DIP) };
+const double UP[3] = { 0, 0, 1 };
+
+// What the magnetometer reports in orientation r
+Vec3 measure(const double r[3][3], double noise) {
+  Vec3 b = toSensor(r, EARTH);
+  double v[3] = { b.x, b.y, b.z }, out[3];
+  for (int i = 0; i < 3; i++) {
+    out[i] = OFFSET[i] + gauss(noise);
+    for (int j = 0; j < 3; j++) out[i] += SOFT[i][j] * v[j];
+  }
+  return { (float)out[0], (float)out[1], (float)out[2] };
+}
+
+double headingError(double a, double b) {
+  double d = fmod(a - b + 540, 360) - 180;
+  return fabs(d);
+}
+
+bool check(bool ok, const char* what) {
+  printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int samples = argc > 1 ? atoi(argv[1]) : 2000;
+  if (samples <= 0) {
+    fprintf(stderr, "usage: compasscheck [samples]\n");
+    return 1;
+  }
+  srand(1);
+  bool ok = true;
+
+  compass::Fitter fitter;
+  double r[3][3];
+  for (int i = 0; i < samples; i++) {
+    rotation(uniform(-M_PI, M_PI), uniform(-M_PI / 2, M_PI / 2), uniform(-M_PI, M_PI), r);
+    fitter.add(measure(r, 0.3));
+  }
+  compass::Calibration cal;
+  bool solved = fitter.solve(cal);
+  ok &= check(solved, "fit solves");
+  if (!solved) return 1;
+
+  double offsetErr = 0;
+  for (int i = 0; i < 3; i++) offsetErr = fmax(offsetErr, fabs(cal.offset[i] - OFFSET[i]));
+  printf("offset %.2f %.2f %.2f uT (true %.2f %.2f %.2f), field %.2f uT, rms %.4f\n",
+         cal.offset[0], cal.offset[1], cal.offset[2], OFFSET[0], OFFSET[1], OFFSET[2],
+         cal.field, cal.rms_error);
+  ok &= check(offsetErr < 0.5, "hard-iron offset within 0.5 uT");
+
+  // The correction undoes the distortion up to the fitted field's scale
+  double scale = cal.field / FIELD_UT, softErr = 0;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      double ws = 0;
+      for (int k = 0; k < 3; k++) ws += cal.soft[i][k] * SOFT[k][j];
+      softErr = fmax(softErr, fabs(ws / scale - (i == j)));
+    }
+  }
+  printf("soft-iron: worst element of correction x distortion off by %.4f\n", softErr);
+  ok &= check(softErr < 0.02, "soft-iron matrix within 2%");
+
+  double worst = 0;
+  for (int yaw = 0; yaw < 360; yaw += 15) {
+    for (int tilt = 0; tilt < 8; tilt++) {
+      double pitch = (tilt & 1 ? 1 : -1) * (tilt / 2) * 10 * DEG;
+      double roll = (tilt & 2 ? 1 : -1) * (tilt / 2) * 10 * DEG;
+      double level[3][3];
+      rotation(yaw * DEG, 0, 0, level);
+      double truth = compass::tilt_heading(toSensor(level, EARTH), toSensor(level, UP));
+
+      rotation(yaw * DEG, pitch, roll, r);
+      Vec3 mag = compass::apply(cal, measure(r, 0));
+      double got = compass::tilt_heading(mag, toSensor(r, UP));
+      worst = fmax(worst, headingError(got, truth));
+    }
+  }
+  printf("heading: worst error %.2f deg over 24 headings, tilt up to 30 deg\n", worst);
+  ok &= check(worst < 1.0, "tilt-compensated heading within 1 deg");
+
+  // Yaw alone leaves the vertical axis unconstrained
+  compass::Fitter flat;
+  for (int i = 0; i < samples; i++) {
+    rotation(uniform(-M_PI, M_PI), 0, 0, r);
+    flat.add(measure(r, 0.3));
+  }
+  compass::Calibration refused;
+  ok &= check(!flat.solve(refused), "flat spin refused");
+
+  compass::Calibration loaded;
+  ok &= check(compass::save(cal) && compass::load(loaded) &&
+              !memcmp(&loaded, &cal, sizeof(cal)), "NVS round trip");
+  hostNvs()["compass"]["cal"][4] ^= 1;
+  ok &= check(!compass::load(loaded), "corrupted NVS blob rejected");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * displaybench - hub display SPI traffic over a simulated hour (host)
+ *
+ * Build:  g++ -std=c++11 -O2 -Itools/host -o displaybench tools/displaybench.cpp
+ *
+ * Usage:  displaybench [seconds]
+ *
+ * Compiles HubDisplay against the GFX/ILI9488 mocks in tools/host, which
+ * count every driver primitive as an address window plus 3 bytes a pixel,
+ * and redraws once a second as the hub loop does. Four nodes report every
+ * 60 s (staggered) with slowly drifting readings, a fifth stays offline,
+ * and an alarm shows for 10 s half way through. Barographs come from a
+ * TrendStore fed with the same samples.
+ *
+ * "retained" is the display as it is. "full" repaints everything every
+ * frame, as the hub did before retained mode; it is forced through
+ * showWelcome(), whose own text is measured once and subtracted. The
+ * display's own byte meter is checked against the mock panel's count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../hub_firmware/display/HubDisplay.h"
+
+namespace {
+
+const int NODES = 5;
+const int ONLINE = 4;
+const uint32_t EPOCH = 1792281600;
+
+struct Result {
+  uint64_t bytes;
+  uint64_t firstFrame;
+  uint32_t repaints;
+  bool meterMatches;
+};
+
+Result run(int seconds, bool full) {
+  static const char* names[NODES] = { "Companionway", "Foredeck", "Cockpit", "Cabin", "Engine" };
+
+  hostClockUs() = 0;
+  hostPanel() = HostPanel();
+  SpiArbiter spi;
+  HubDisplay display(15, 2, 4, spi);
+  display.begin();
+
+  // What showWelcome() itself costs, to take out of the full-repaint runs
+  uint64_t before = hostPanel().bytes;
+  display.showWelcome();
+  uint64_t welcome = hostPanel().bytes - before;
+
+  NodeInfo nodes[NODES];
+  for (int i = 0; i < NODES; i++) {
+    nodes[i] = NodeInfo();
+    nodes[i].id = i + 1;
+    nodes[i].name = names[i];
+    nodes[i].online = i < ONLINE;
+    nodes[i].temperature = 21.3f + i;
+    nodes[i].humidity = 60;
+    nodes[i].pressure = 1012.4f;
+    nodes[i].batteryVoltage = 3700;
+    nodes[i].rssi = -70 - i;
+    nodes[i].barographCount = 0;
+  }
+
+  TrendStore* trends = new TrendStore();
+  Result r = {};
+  uint64_t start = hostPanel().bytes;
+  for (int s = 0; s < seconds; s++) {
+    hostClockUs() = (uint64_t)s * 1000000;
+    for (int i = 0; i < ONLINE; i++) {
+      if ((s + i * 15) % 60 != 0) continue;
+      NodeInfo& n = nodes[i];
+      n.temperature = 21.3f + i + 0.5f * sinf(s / 900.0f);
+      n.humidity = 60 + 3 * sinf(s / 1200.0f + i);
+      n.pressure = 1012.4f + 0.8f * sinf(s / 2000.0f);
+      n.rssi = -70 - i - (s / 60) % 3;
+      trends->add(n.id, EPOCH + s, n.temperature, n.humidity, n.pressure,
+                  n.batteryVoltage, n.rssi);
+    }
+
+    if (full && s > 0) {
+      display.showWelcome();
+      start += welcome;
+    }
+    bool alarm = s >= seconds / 2 && s < seconds / 2 + 10;
+    display.drawMainScreen(nodes, NODES, alarm ? MODE_FULL : MODE_PERIMETER, alarm,
+                           trends, EPOCH + s);
+    if (alarm) display.showAlarm(names[2]);
+    else display.hideAlarm();
+
+    if (s == 0) r.firstFrame = hostPanel().bytes - start;
+  }
+  delete trends;
+
+  const HubDisplay::Stats& stats = display.getStats();
+  r.bytes = hostPanel().bytes - start;
+  r.repaints = stats.repaints;
+  r.meterMatches = stats.bytesPushed == (uint32_t)hostPanel().bytes;
+  return r;
+}
+
+void print(const char* name, int seconds, const Result& r) {
+  printf("%-9s %10llu %12.0f %9llu %9u  %s\n", name,
+         (unsigned long long)r.bytes, (double)r.bytes / seconds,
+         (unsigned long long)r.firstFrame, r.repaints,
+         r.meterMatches ? "yes" : "NO");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 3600;
+  if (seconds <= 0) {
+    fprintf(stderr, "usage: displaybench [seconds]\n");
+    return 1;
+  }
+
+  Result full = run(seconds, true);
+  Result retained = run(seconds, false);
+
+  printf("%-9s %10s %12s %9s %9s  %s\n", "display", "bytes", "bytes/s",
+         "1st frame", "repaints", "meter ok");
+  print("full", seconds, full);
+  print("retained", seconds, retained);
+  return full.meterMatches && retained.meterMatches ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+/**
+ * Adafruit_GFX reduced to the calls the hub display makes, decomposed
+ * into the driver primitives (drawPixel, drawFastHLine/VLine, fillRect)
+ * the way the real library does. Text is approximated: each printed
+ * glyph of the 5x7 font costs HOST_GLYPH_PIXELS pixels, drawn as single
+ * pixels at size 1 and as size x size rectangles above it.
+ */
+
+#include <Arduino.h>
+
+#define HOST_GLYPH_PIXELS 17
+
+class Adafruit_GFX : public Print {
+protected:
+  int16_t width_, height_;
+  int16_t cursorX, cursorY;
+  uint8_t textSize;
+
+public:
+  Adafruit_GFX(int16_t w, int16_t h)
+    : width_(w), height_(h), cursorX(0), cursorY(0), textSize(1) {}
+
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) = 0;
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) = 0;
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
+  virtual void fillScreen(uint16_t color) { fillRect(0, 0, width_, height_, color); }
+
+  void setRotation(uint8_t r) {
+    if ((r & 1) && width_ < height_) std::swap(width_, height_);
+  }
+  void setTextSize(uint8_t s) { textSize = s ? s : 1; }
+  void setTextColor(uint16_t) {}
+  void setCursor(int16_t x, int16_t y) {
+    cursorX = x;
+    cursorY = y;
+  }
+  int16_t width() const { return width_; }
+  int16_t height() const { return height_; }
+
+  void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  }
+
+  // Bresenham, one drawPixel per step (vertical/horizontal lines use the
+  // fast primitives, as in the library)
+  void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    if (x0 == x1) {
+      drawFastVLine(x0, min(y0, y1), abs(y1 - y0) + 1, color);
+      return;
+    }
+    if (y0 == y1) {
+      drawFastHLine(min(x0, x1), y0, abs(x1 - x0) + 1, color);
+      return;
+    }
+    int16_t steps = max(abs(x1 - x0), abs(y1 - y0)) + 1;
+    for (int16_t i = 0; i < steps; i++) drawPixel(x0, y0, color);
+  }
+
+  void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+    for (int16_t dx = 1; dx <= r; dx++) {
+      int16_t dy = (int16_t)sqrtf((float)(r * r - dx * dx));
+      drawFastVLine(x0 - dx, y0 - dy, 2 * dy + 1, color);
+      drawFastVLine(x0 + dx, y0 - dy, 2 * dy + 1, color);
+    }
+  }
+
+  size_t write(uint8_t c) override {
+    if (c == '\n') {
+      cursorX = 0;
+      cursorY += 8 * textSize;
+    } else if (c != '\r') {
+      if (c != ' ') {
+        for (uint8_t i = 0; i < HOST_GLYPH_PIXELS; i++) {
+          if (textSize == 1) drawPixel(cursorX, cursorY, 0);
+          else fillRect(cursorX, cursorY, textSize, textSize, 0);
+        }
+      }
+      cursorX += 6 * textSize;
+    }
+    return 1;
+  }
+  using Print::write;
+};
+
+#endif // HOST_ADAFRUIT_GFX_H
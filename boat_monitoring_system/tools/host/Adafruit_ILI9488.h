@@ -0,0 +1,47 @@
+#ifndef HOST_ADAFRUIT_ILI9488_H
+#define HOST_ADAFRUIT_ILI9488_H
+
+/**
+ * ILI9488 panel for host tools. Each primitive is counted in hostPanel()
+ * as one SPI transaction: an 11-byte address window, then 3 bytes per
+ * pixel (18-bit colour). Nothing is drawn.
+ */
+
+#include "Adafruit_GFX.h"
+
+struct HostPanel {
+  uint64_t bytes;
+  uint32_t transactions;
+
+  HostPanel() : bytes(0), transactions(0) {}
+
+  void send(uint32_t pixels) {
+    bytes += 11 + 3ULL * pixels;
+    transactions++;
+  }
+};
+
+inline HostPanel& hostPanel() {
+  static HostPanel panel;
+  return panel;
+}
+
+class Adafruit_ILI9488 : public Adafruit_GFX {
+public:
+  Adafruit_ILI9488(int8_t, int8_t, int8_t = -1) : Adafruit_GFX(320, 480) {}
+
+  void begin(uint32_t = 0) {}
+
+  void drawPixel(int16_t, int16_t, uint16_t) override { hostPanel().send(1); }
+  void drawFastHLine(int16_t, int16_t, int16_t w, uint16_t) override {
+    if (w > 0) hostPanel().send(w);
+  }
+  void drawFastVLine(int16_t, int16_t, int16_t h, uint16_t) override {
+    if (h > 0) hostPanel().send(h);
+  }
+  void fillRect(int16_t, int16_t, int16_t w, int16_t h, uint16_t) override {
+    if (w > 0 && h > 0) hostPanel().send((uint32_t)w * h);
+  }
+};
+
+#endif // HOST_ADAFRUIT_ILI9488_H
@@ -0,0 +1,170 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * Just enough of the Arduino-ESP32 core to compile the hub's header-only
+ * classes into host programs under tools/.
+ *
+ * Time is virtual: millis()/micros() read hostClockUs(), which only moves
+ * when a tool (or a mock device charging its cost) advances it, so runs
+ * are repeatable and independent of the host's speed. Serial charges the
+ * UART time of everything printed (115200 baud) and discards it;
+ * HostStdout is a Print that really writes to stdout.
+ *
+ * FreeRTOS calls are single-task stubs: semaphores are always free and
+ * task notifications never block.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+inline uint64_t& hostClockUs() {
+  static uint64_t us = 0;
+  return us;
+}
+
+inline unsigned long millis() { return (unsigned long)(hostClockUs() / 1000); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostClockUs(); }
+inline void delay(unsigned long ms) { hostClockUs() += ms * 1000ull; }
+inline void delayMicroseconds(unsigned int us) { hostClockUs() += us; }
+inline void yield() {}
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define DEC 10
+#define HEX 16
+#define IRAM_ATTR
+#define constrain(v, lo, hi) ((v) < (lo) ? (lo) : ((v) > (hi) ? (hi) : (v)))
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+
+class String : public std::string {
+public:
+  String() {}
+  String(const char* s) : std::string(s ? s : "") {}
+  String(const std::string& s) : std::string(s) {}
+  explicit String(int v) : std::string(std::to_string(v)) {}
+  explicit String(unsigned v) : std::string(std::to_string(v)) {}
+  explicit String(long v) : std::string(std::to_string(v)) {}
+  explicit String(unsigned long v) : std::string(std::to_string(v)) {}
+  unsigned int length() const { return (unsigned int)size(); }
+};
+
+inline String operator+(const String& a, const char* b) { return String(std::string(a) + b); }
+inline String operator+(const char* a, const String& b) { return String(a + std::string(b)); }
+inline String operator+(const String& a, const String& b) { return String(std::string(a) + std::string(b)); }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return write((const uint8_t*)s.data(), s.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC) {
+    if (base == DEC) return printf_("%ld", v);
+    return print((unsigned long)v, base);
+  }
+  size_t print(unsigned long v, int base = DEC) {
+    return printf_(base == HEX ? "%lX" : "%lu", v);
+  }
+  size_t print(double v, int digits = 2) { return printf_("%.*f", digits, v); }
+
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+  template <typename T> size_t println(T v, int mode) { return print(v, mode) + println(); }
+  size_t println() { return print("\r\n"); }
+
+private:
+  size_t printf_(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[64];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return n > 0 ? write((const uint8_t*)buf, (size_t)n) : 0;
+  }
+};
+
+// 115200 baud, 10 bits a character: ~87 us each once the TX FIFO is full
+class HostSerial : public Print {
+public:
+  uint64_t bytes = 0;
+  void begin(unsigned long) {}
+  size_t write(uint8_t) override {
+    bytes++;
+    hostClockUs() += 87;
+    return 1;
+  }
+  using Print::write;
+};
+
+class HostStdout : public Print {
+public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  using Print::write;
+};
+
+inline HostSerial& hostSerial() {
+  static HostSerial serial;
+  return serial;
+}
+#define Serial hostSerial()
+
+// FreeRTOS, single task
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef int BaseType_t;
+typedef int portMUX_TYPE;
+#define pdFALSE 0
+#define pdTRUE 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) (ms)
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux)
+#define portEXIT_CRITICAL_ISR(mux)
+#define portYIELD_FROM_ISR()
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return nullptr; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return nullptr; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, uint32_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, uint32_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t) { return pdTRUE; }
+inline TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t) { return nullptr; }
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, uint32_t) { return 0; }
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,78 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+/**
+ * In-memory NVS: one key/value map per namespace, kept for the life of the
+ * process so a tool can save, reopen and load again.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+inline std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& hostNvs() {
+  static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+  return nvs;
+}
+
+class Preferences {
+  std::string ns;
+  bool open_;
+  bool readOnly;
+
+  std::vector<uint8_t>* find(const char* key) {
+    if (!open_) return nullptr;
+    std::map<std::string, std::vector<uint8_t>>& keys = hostNvs()[ns];
+    auto it = keys.find(key);
+    return it == keys.end() ? nullptr : &it->second;
+  }
+
+public:
+  Preferences() : open_(false), readOnly(true) {}
+
+  bool begin(const char* name, bool ro = false) {
+    ns = name;
+    readOnly = ro;
+    open_ = true;
+    return true;
+  }
+  void end() { open_ = false; }
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    if (!open_ || readOnly) return 0;
+    const uint8_t* p = (const uint8_t*)value;
+    hostNvs()[ns][key].assign(p, p + len);
+    return len;
+  }
+  size_t getBytes(const char* key, void* buf, size_t len) {
+    std::vector<uint8_t>* v = find(key);
+    if (!v || v->size() > len) return 0;
+    memcpy(buf, v->data(), v->size());
+    return v->size();
+  }
+  size_t getBytesLength(const char* key) {
+    std::vector<uint8_t>* v = find(key);
+    return v ? v->size() : 0;
+  }
+
+  size_t putUChar(const char* key, uint8_t value) { return putBytes(key, &value, 1); }
+  uint8_t getUChar(const char* key, uint8_t def = 0) {
+    std::vector<uint8_t>* v = find(key);
+    return v && v->size() == 1 ? (*v)[0] : def;
+  }
+
+  bool remove(const char* key) {
+    return open_ && !readOnly && hostNvs()[ns].erase(key) != 0;
+  }
+  bool clear() {
+    if (!open_ || readOnly) return false;
+    hostNvs()[ns].clear();
+    return true;
+  }
+};
+
+#endif // HOST_PREFERENCES_H
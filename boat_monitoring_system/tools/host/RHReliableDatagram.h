@@ -0,0 +1,88 @@
+#ifndef HOST_RH_RELIABLE_DATAGRAM_H
+#define HOST_RH_RELIABLE_DATAGRAM_H
+
+/**
+ * RHReliableDatagram stand-in with the receive timing that matters for
+ * bursts (SF8 / 125 kHz):
+ *
+ *  - the radio has a single RX buffer: a frame that ends before the
+ *    previous one was read overwrites it;
+ *  - recvfromAck() transmits the ACK (HOST_ACK_US of airtime) and leaves
+ *    the radio idle, as RadioHead does; it only listens again at the next
+ *    available() call, and frames that started before then are missed.
+ *
+ * Frames come from hostAir(); everything missed is counted there.
+ */
+
+#include "RH_RF95.h"
+
+#define HOST_FRAME_US 62000   // 12-byte frame airtime
+#define HOST_ACK_US   41000   // 2-byte ACK airtime
+#define HOST_SEND_US  100000  // sendtoWait(): frame out and ACK back
+
+class RHReliableDatagram {
+  bool pending;
+  HostFrame current;
+  bool listening;
+  uint64_t listeningSince;
+
+  // Deliver every frame that has ended by now
+  void settle() {
+    HostAir& air = hostAir();
+    while (!air.frames.empty() && air.frames.front().endUs <= hostClockUs()) {
+      HostFrame f = air.frames.front();
+      air.frames.pop_front();
+      if (!listening || f.endUs - HOST_FRAME_US < listeningSince) {
+        air.missed++;
+        continue;
+      }
+      if (pending) air.missed++;
+      current = f;
+      pending = true;
+    }
+  }
+
+public:
+  RHReliableDatagram(RH_RF95&, uint8_t)
+    : pending(false), listening(true), listeningSince(0) {}
+
+  bool init() {
+    pending = false;
+    listening = true;
+    listeningSince = hostClockUs();
+    return true;
+  }
+  void setRetries(uint8_t) {}
+  void setTimeout(uint16_t) {}
+
+  bool available() {
+    settle();
+    if (!listening) {
+      listening = true;
+      listeningSince = hostClockUs();
+    }
+    return pending;
+  }
+
+  bool recvfromAck(uint8_t* buf, uint8_t* len, uint8_t* from = nullptr) {
+    settle();
+    if (!pending) return false;
+    uint8_t n = current.len < *len ? current.len : *len;
+    memcpy(buf, current.buf, n);
+    *len = n;
+    if (from) *from = current.from;
+    pending = false;
+
+    hostClockUs() += HOST_ACK_US;
+    settle();
+    listening = false;
+    return true;
+  }
+
+  bool sendtoWait(uint8_t*, uint8_t, uint8_t) {
+    hostClockUs() += HOST_SEND_US;
+    return true;
+  }
+};
+
+#endif // HOST_RH_RELIABLE_DATAGRAM_H
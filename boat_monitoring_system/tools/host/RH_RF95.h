@@ -0,0 +1,67 @@
+#ifndef HOST_RH_RF95_H
+#define HOST_RH_RF95_H
+
+/**
+ * RH_RF95 stand-in for host tools. Register access is a no-op; the frames
+ * a tool puts on the air are delivered by the RHReliableDatagram mock.
+ */
+
+#include <Arduino.h>
+#include <deque>
+
+#define RH_RF95_MAX_MESSAGE_LEN 251
+
+// A frame on the air, received when its last symbol arrives at endUs
+struct HostFrame {
+  uint64_t endUs;
+  uint8_t from;
+  uint8_t len;
+  uint8_t buf[RH_RF95_MAX_MESSAGE_LEN];
+};
+
+struct HostAir {
+  std::deque<HostFrame> frames;  // in order of endUs
+  uint32_t missed;               // ended while the radio was deaf or overwritten
+
+  void clear() {
+    frames.clear();
+    missed = 0;
+  }
+};
+
+inline HostAir& hostAir() {
+  static HostAir air;
+  return air;
+}
+
+class RH_RF95 {
+public:
+  enum RHMode { RHModeInitialising, RHModeSleep, RHModeIdle, RHModeTx, RHModeRx };
+
+  RH_RF95(uint8_t, uint8_t) {}
+  virtual ~RH_RF95() {}
+
+  virtual uint8_t spiRead(uint8_t) { return 0; }
+  virtual uint8_t spiWrite(uint8_t, uint8_t) { return 0; }
+  virtual uint8_t spiBurstRead(uint8_t, uint8_t*, uint8_t) { return 0; }
+  virtual uint8_t spiBurstWrite(uint8_t, const uint8_t*, uint8_t) { return 0; }
+
+  virtual bool init() { return true; }
+  virtual bool available() { return false; }
+  virtual bool waitPacketSent() { return true; }
+  virtual bool waitPacketSent(uint16_t) { return true; }
+  RHMode mode() const { return RHModeRx; }
+  void handleInterrupt() {}
+
+  bool setFrequency(float) { return true; }
+  void setTxPower(int8_t, bool) {}
+  void setSpreadingFactor(uint8_t) {}
+  void setSignalBandwidth(long) {}
+  void setCodingRate4(uint8_t) {}
+  void setPayloadCRC(bool) {}
+
+  int16_t lastRssi() { return -70; }
+  int8_t lastSNR() { return 9; }
+};
+
+#endif // HOST_RH_RF95_H
@@ -0,0 +1,236 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+/**
+ * In-memory SD card with a FAT cost model, charged to the virtual clock.
+ *
+ * Each open handle caches one sector, as the FAT driver does. Touching a
+ * sector not in the cache costs a card read, unless the write covers the
+ * whole sector; a dirty sector is written back when it is left, completed
+ * or flushed. Opening a file walks the directory; flush() and close()
+ * rewrite the FAT and the directory entry if the handle wrote anything.
+ * Seeking walks the cluster chain, from the start when going backwards.
+ */
+
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+#define HOST_SD_DIR_US     3000   // directory lookup
+#define HOST_SD_READ_US    800    // sector read
+#define HOST_SD_WRITE_US   1200   // sector write
+#define HOST_SD_FAT_US     2500   // FAT and directory entry update
+#define HOST_SD_LINK_US    20     // one cluster chain link
+#define HOST_SD_CLUSTER    32768
+#define HOST_SD_SECTOR     512
+
+struct HostCard {
+  std::map<std::string, std::vector<uint8_t>> files;
+  std::map<std::string, bool> dirs;
+  uint64_t totalBytes;
+  uint64_t reads;
+  uint64_t writes;
+
+  HostCard() : totalBytes(4ULL << 30), reads(0), writes(0) {}
+
+  void charge(uint64_t us) { hostClockUs() += us; }
+};
+
+inline HostCard& hostCard() {
+  static HostCard card;
+  return card;
+}
+
+class File : public Print {
+  std::string path;
+  bool dir;
+  bool open_;
+  uint32_t pos;
+  int32_t cached;    // sector in the handle's cache, -1 = none
+  bool dirty;
+  bool written;      // since the last flush
+  size_t next;       // directory listing position
+
+  std::vector<uint8_t>& data() { return hostCard().files[path]; }
+
+  void writeBack() {
+    if (dirty) {
+      hostCard().charge(HOST_SD_WRITE_US);
+      hostCard().writes++;
+    }
+    dirty = false;
+  }
+
+  // Bring `sector` into the cache; `whole` writes need no read
+  void load(int32_t sector, bool whole) {
+    if (sector == cached) return;
+    writeBack();
+    cached = sector;
+    if (!whole && (uint32_t)sector * HOST_SD_SECTOR < data().size()) {
+      hostCard().charge(HOST_SD_READ_US);
+      hostCard().reads++;
+    }
+  }
+
+public:
+  File() : dir(false), open_(false), pos(0), cached(-1), dirty(false), written(false), next(0) {}
+  File(const std::string& p, bool isDir, uint32_t at)
+    : path(p), dir(isDir), open_(true), pos(at), cached(-1), dirty(false), written(false),
+      next(0) {}
+
+  explicit operator bool() const { return open_; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override {
+    if (!open_ || dir) return 0;
+    std::vector<uint8_t>& d = data();
+    size_t left = len;
+    while (left > 0) {
+      uint32_t off = pos % HOST_SD_SECTOR;
+      size_t n = min(left, (size_t)(HOST_SD_SECTOR - off));
+      load(pos / HOST_SD_SECTOR, off == 0 && n == HOST_SD_SECTOR);
+      if (pos + n > d.size()) d.resize(pos + n);
+      memcpy(d.data() + pos, buf, n);
+      dirty = written = true;
+      buf += n;
+      pos += n;
+      left -= n;
+      if (pos % HOST_SD_SECTOR == 0) writeBack();
+    }
+    return len;
+  }
+  using Print::write;
+
+  size_t read(uint8_t* buf, size_t len) {
+    if (!open_ || dir) return 0;
+    std::vector<uint8_t>& d = data();
+    if (pos >= d.size()) return 0;
+    len = min(len, (size_t)(d.size() - pos));
+    for (size_t done = 0; done < len;) {
+      load(pos / HOST_SD_SECTOR, false);
+      size_t n = min(len - done, (size_t)(HOST_SD_SECTOR - pos % HOST_SD_SECTOR));
+      memcpy(buf + done, d.data() + pos, n);
+      pos += n;
+      done += n;
+    }
+    return len;
+  }
+
+  bool seek(uint32_t to) {
+    if (!open_ || dir || to > data().size()) return false;
+    uint32_t from = to < pos ? 0 : pos;
+    hostCard().charge((uint64_t)(to / HOST_SD_CLUSTER - from / HOST_SD_CLUSTER) * HOST_SD_LINK_US);
+    pos = to;
+    return true;
+  }
+
+  uint32_t position() const { return pos; }
+  uint32_t size() { return open_ && !dir ? (uint32_t)data().size() : 0; }
+
+  void flush() {
+    if (!open_ || dir || !written) return;
+    writeBack();
+    hostCard().charge(HOST_SD_FAT_US);
+    hostCard().writes++;
+    written = false;
+  }
+
+  void close() {
+    if (open_ && !dir) flush();
+    open_ = false;
+  }
+
+  const char* name() const {
+    size_t slash = path.rfind('/');
+    return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+  }
+  bool isDirectory() const { return dir; }
+
+  File openNextFile() {
+    HostCard& card = hostCard();
+    std::string prefix = path + "/";
+    size_t i = 0;
+    for (auto& f : card.files) {
+      if (f.first.compare(0, prefix.size(), prefix) != 0) continue;
+      if (f.first.find('/', prefix.size()) != std::string::npos) continue;
+      if (i++ == next) {
+        next++;
+        return File(f.first, false, 0);
+      }
+    }
+    return File();
+  }
+};
+
+class SDClass {
+public:
+  bool begin(uint8_t) { return true; }
+  bool exists(const char* path) {
+    HostCard& card = hostCard();
+    return card.files.count(path) || card.dirs.count(path);
+  }
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool mkdir(const char* path) {
+    hostCard().dirs[path] = true;
+    return true;
+  }
+
+  File open(const char* path, const char* mode = FILE_READ) {
+    HostCard& card = hostCard();
+    card.charge(HOST_SD_DIR_US);
+    card.reads++;
+    if (card.dirs.count(path)) return File(path, true, 0);
+
+    bool exists = card.files.count(path) != 0;
+    if (!strcmp(mode, FILE_WRITE)) {
+      card.files[path].clear();
+    } else if (!strcmp(mode, FILE_APPEND)) {
+      card.files[path];
+    } else if (!exists) {
+      return File();
+    }
+    uint32_t at = !strcmp(mode, FILE_APPEND) ? (uint32_t)card.files[path].size() : 0;
+    return File(path, false, at);
+  }
+  File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+
+  bool rename(const char* from, const char* to) {
+    HostCard& card = hostCard();
+    if (!card.files.count(from)) return false;
+    card.files[to] = std::move(card.files[from]);
+    card.files.erase(from);
+    card.charge(HOST_SD_DIR_US + HOST_SD_FAT_US);
+    return true;
+  }
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+
+  bool remove(const char* path) {
+    HostCard& card = hostCard();
+    card.charge(HOST_SD_DIR_US + HOST_SD_FAT_US);
+    return card.files.erase(path) != 0;
+  }
+  bool remove(const String& path) { return remove(path.c_str()); }
+
+  uint64_t totalBytes() { return hostCard().totalBytes; }
+  uint64_t usedBytes() {
+    uint64_t used = 0;
+    for (auto& f : hostCard().files) {
+      used += (f.second.size() + HOST_SD_CLUSTER - 1) / HOST_SD_CLUSTER * HOST_SD_CLUSTER;
+    }
+    return used;
+  }
+};
+
+inline SDClass& hostSD() {
+  static SDClass sd;
+  return sd;
+}
+#define SD hostSD()
+
+#endif // HOST_SD_H
@@ -0,0 +1,18 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+};
+
+inline SPIClass& hostSPI() {
+  static SPIClass spi;
+  return spi;
+}
+#define SPI hostSPI()
+
+#endif // HOST_SPI_H
@@ -0,0 +1,64 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+/**
+ * TwoWire with a DS3231 on it, reading hostRtcEpoch() plus the virtual
+ * clock. Every other register reads 0 (oscillator running).
+ */
+
+#include <Arduino.h>
+
+inline uint32_t& hostRtcEpoch() {
+  static uint32_t epoch = 1792281600;  // 2026-10-18 00:00:00 UTC
+  return epoch;
+}
+
+class TwoWire {
+  uint8_t reg;
+  uint8_t rx[8];
+  uint8_t rxLen;
+  uint8_t rxPos;
+
+  static uint8_t bcd(unsigned v) { return (uint8_t)(((v / 10) << 4) | (v % 10)); }
+
+public:
+  TwoWire() : reg(0), rxLen(0), rxPos(0) {}
+
+  void begin() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t v) {
+    reg = v;
+    return 1;
+  }
+  uint8_t endTransmission(bool = true) { return 0; }
+
+  uint8_t requestFrom(uint8_t, uint8_t len) {
+    memset(rx, 0, sizeof(rx));
+    if (reg == 0x00) {
+      time_t t = hostRtcEpoch() + (time_t)(hostClockUs() / 1000000);
+      struct tm g;
+      gmtime_r(&t, &g);
+      rx[0] = bcd(g.tm_sec);
+      rx[1] = bcd(g.tm_min);
+      rx[2] = bcd(g.tm_hour);
+      rx[3] = (uint8_t)(g.tm_wday + 1);
+      rx[4] = bcd(g.tm_mday);
+      rx[5] = bcd(g.tm_mon + 1);
+      rx[6] = bcd(g.tm_year - 100);
+    }
+    rxLen = len < sizeof(rx) ? len : sizeof(rx);
+    rxPos = 0;
+    return rxLen;
+  }
+
+  int read() { return rxPos < rxLen ? rx[rxPos++] : -1; }
+};
+
+inline TwoWire& hostWire() {
+  static TwoWire wire;
+  return wire;
+}
+#define Wire hostWire()
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,45 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+/**
+ * heap_caps_* for host tools: PSRAM of hostHeap().psram bytes (0 = board
+ * without PSRAM) and an internal heap with hostHeap().internalFree bytes
+ * free. Allocations come from malloc() and are charged against those.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_8BIT     (1 << 2)
+
+struct HostHeap {
+  size_t psram;
+  size_t psramFree;
+  size_t internalFree;
+
+  HostHeap() : psram(8 << 20), psramFree(8 << 20), internalFree(200 * 1024) {}
+};
+
+inline HostHeap& hostHeap() {
+  static HostHeap heap;
+  return heap;
+}
+
+inline size_t heap_caps_get_total_size(uint32_t caps) {
+  return caps & MALLOC_CAP_SPIRAM ? hostHeap().psram : 320 * 1024;
+}
+
+inline size_t heap_caps_get_free_size(uint32_t caps) {
+  return caps & MALLOC_CAP_SPIRAM ? hostHeap().psramFree : hostHeap().internalFree;
+}
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+  size_t& free = caps & MALLOC_CAP_SPIRAM ? hostHeap().psramFree : hostHeap().internalFree;
+  if (size > free) return nullptr;
+  free -= size;
+  return malloc(size);
+}
+
+#endif // HOST_ESP_HEAP_CAPS_H
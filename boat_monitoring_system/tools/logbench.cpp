@@ -0,0 +1,149 @@
+/**
+ * logbench - DataLogger write cost on an emulated FAT card (host)
+ *
+ * Build:  g++ -std=c++11 -O2 -Itools/host -o logbench tools/logbench.cpp
+ *
+ * Usage:  logbench [seconds]
+ *
+ * Compiles the hub's DataLogger against the in-memory card in
+ * tools/host/SD.h, whose FAT cost model charges directory lookups, sector
+ * reads and writes and FAT updates to the virtual clock. A mix of env and
+ * detection records (one in three) plus an alarm every two minutes is
+ * logged at 2, 10 and 50 records/s, with process() run after every record
+ * as the storage task does.
+ *
+ * "open/close" is the reference the logger replaced: open the CSV file,
+ * print one line, close it, for every record. "blocks" is the current
+ * logger; its process() time is shown separately from the log call. Until
+ * the next file's spare is fully preallocated, process() grows it by one
+ * block a call, which dominates the card writes at low record rates.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../hub_firmware/storage/DataLogger.h"
+
+namespace {
+
+struct Run {
+  uint64_t logUs;
+  uint64_t logWorstUs;
+  uint64_t processUs;
+  uint64_t processWorstUs;
+  uint32_t records;
+};
+
+// The pre-buffering logger: one open/print/close per record
+void logCsv(uint8_t nodeID, const char* type, const char* fields) {
+  File f = SD.open("/boat_log.csv", FILE_APPEND);
+  if (!f) return;
+  f.print(millis());
+  f.print(",");
+  f.print(type);
+  f.print(",");
+  f.print((int)nodeID);
+  f.print(",");
+  f.println(fields);
+  f.close();
+}
+
+void note(uint64_t start, uint64_t& total, uint64_t& worst) {
+  uint64_t us = hostClockUs() - start;
+  total += us;
+  if (us > worst) worst = us;
+}
+
+void print(const char* name, int rate, const Run& r) {
+  HostCard& card = hostCard();
+  printf("%-10s %4d %9.0f %9llu %9.0f %9llu %8llu %8llu\n", name, rate,
+         (double)r.logUs / r.records, (unsigned long long)r.logWorstUs,
+         (double)r.processUs / r.records, (unsigned long long)r.processWorstUs,
+         (unsigned long long)card.reads, (unsigned long long)card.writes);
+}
+
+void reset() {
+  HostCard& card = hostCard();
+  card.files.clear();
+  card.dirs.clear();
+  card.reads = card.writes = 0;
+  hostClockUs() = 0;
+}
+
+// Record i of second s: env, detection, or (once every 2 min) an alarm
+template <typename Log>
+void workload(int seconds, int rate, Run& r, Log log) {
+  uint64_t t0 = hostClockUs();
+  for (int s = 0; s < seconds; s++) {
+    for (int i = 0; i < rate; i++) {
+      log(s, i);
+      r.records++;
+      uint64_t due = t0 + (uint64_t)s * 1000000 + (uint64_t)(i + 1) * 1000000 / rate;
+      if (hostClockUs() < due) hostClockUs() = due;
+    }
+  }
+}
+
+void runCsv(int seconds, int rate) {
+  reset();
+  Run r = {};
+  workload(seconds, rate, r, [&](int s, int i) {
+    uint64_t start = hostClockUs();
+    if (s % 120 == 0 && i == 0) logCsv(2, "ALARM", "Detection triggered alarm");
+    else if (i % 3 == 0) logCsv(3, "DETECT", "1,85,240,1");
+    else logCsv(i % 8 + 1, "ENV", "21.37,64.20,1013.40,3710,-71");
+    note(start, r.logUs, r.logWorstUs);
+  });
+  print("open/close", rate, r);
+}
+
+void runBlocks(int seconds, int rate) {
+  reset();
+  RtcClock rtc;
+  rtc.begin(Wire);
+  SpiArbiter spi;
+  DataLogger logger(5, rtc, spi);
+  if (!logger.begin()) {
+    printf("DataLogger.begin() failed\n");
+    return;
+  }
+  HostCard& card = hostCard();
+  card.reads = card.writes = 0;  // leave out the first file's preallocation
+
+  Run r = {};
+  workload(seconds, rate, r, [&](int s, int i) {
+    uint64_t start = hostClockUs();
+    if (s % 120 == 0 && i == 0) logger.logAlarm(2, "Detection triggered alarm");
+    else if (i % 3 == 0) logger.logDetection(3, 1, 85, 240, 1);
+    else logger.logEnvironmental(i % 8 + 1, 21.37f, 64.2f, 1013.4f, 3710, -71);
+    note(start, r.logUs, r.logWorstUs);
+
+    start = hostClockUs();
+    logger.process();
+    rtc.process();
+    note(start, r.processUs, r.processWorstUs);
+  });
+  print("blocks", rate, r);
+  logger.end();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 600;
+  if (seconds <= 0) {
+    fprintf(stderr, "usage: logbench [seconds]\n");
+    return 1;
+  }
+
+  printf("%-10s %4s %9s %9s %9s %9s %8s %8s\n", "logger", "rec/s", "log avg",
+         "log max", "proc avg", "proc max", "reads", "writes");
+  printf("%-10s %4s %9s %9s %9s %9s %8s %8s\n", "", "", "us/rec", "us", "us/rec",
+         "us", "", "");
+  const int rates[] = { 2, 10, 50 };
+  for (int rate : rates) {
+    runCsv(seconds, rate);
+    runBlocks(seconds, rate);
+  }
+  return 0;
+}
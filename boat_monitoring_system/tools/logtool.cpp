@@ -0,0 +1,348 @@
+/**
+ * logtool - read hub binary logs (common/LogFormat.h) on a PC
+ *
+ * Build:  g++ -std=c++11 -O2 -o logtool tools/logtool.cpp
+ *
+ * Usage:  logtool info   <file>
+ *         logtool blocks <file>
+ *         logtool csv    <file> [--from S] [--to S] [--node ID] [--type T]
+ *                               [--boot N]
+ *
+ * The file is memory-mapped. A time query uses the trailing index (or the
+ * block headers of a file cut short by power loss) to pick the blocks whose
+ * range overlaps [from, to]; --node additionally skips blocks whose node
+ * bitmap lacks the address. Only the selected blocks are touched.
+ * Times are UTC epoch seconds (seconds since boot for files written without
+ * a clock), ID is a hex node address, T is one of
+ * env, detect, alarm, event.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "../common/LogFormat.h"
+
+namespace {
+
+struct Block {
+  uint32_t seq;
+  const LogBlockHeader* header;
+  uint16_t count;          // usable records (scanned for unsealed blocks)
+};
+
+struct Filter {
+  uint32_t from = 0;
+  uint32_t to = UINT32_MAX;
+  int node = -1;
+  int type = -1;
+  int boot = -1;
+};
+
+struct LogFile {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  const LogFileHeader* header = nullptr;
+  const LogIndexFooter* footer = nullptr;
+  const LogIndexEntry* index = nullptr;
+  uint32_t blockCount = 0;
+
+  ~LogFile() {
+    if (data) munmap((void*)data, size);
+  }
+
+  bool open(const char* path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < LOG_FILE_HEADER_SIZE) {
+      fprintf(stderr, "%s: too short for a log file\n", path);
+      close(fd);
+      return false;
+    }
+    size = st.st_size;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      fprintf(stderr, "%s: mmap failed: %s\n", path, strerror(errno));
+      return false;
+    }
+    data = (const uint8_t*)p;
+
+    header = (const LogFileHeader*)data;
+    if (strncmp(header->magic, LOG_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != LOG_FORMAT_VERSION ||
+        header->blockSize != LOG_BLOCK_SIZE ||
+        header->recordSize != sizeof(LogRecord)) {
+      fprintf(stderr, "%s: not a version %d boat log\n", path, LOG_FORMAT_VERSION);
+      return false;
+    }
+
+    uint32_t dataEnd = size;
+    const LogIndexFooter* f = (const LogIndexFooter*)(data + size - sizeof(LogIndexFooter));
+    if (f->magic == LOG_INDEX_MAGIC &&
+        f->indexOffset == logBlockOffset(f->blockCount) &&
+        f->indexOffset + f->blockCount * sizeof(LogIndexEntry) + sizeof(*f) <= size) {
+      footer = f;
+      index = (const LogIndexEntry*)(data + f->indexOffset);
+      dataEnd = f->indexOffset;
+    }
+    blockCount = (dataEnd - LOG_FILE_HEADER_SIZE + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE;
+
+    // Without an index, used slots end at the first one never written
+    // (preallocated files are zero beyond that)
+    if (!index) {
+      uint32_t used = 0;
+      while (used < blockCount && blockHeader(used)) used++;
+      blockCount = used;
+    }
+    return true;
+  }
+
+  const LogBlockHeader* blockHeader(uint32_t seq) const {
+    uint32_t offset = logBlockOffset(seq);
+    if (offset + sizeof(LogBlockHeader) > size) return nullptr;
+    const LogBlockHeader* h = (const LogBlockHeader*)(data + offset);
+    return h->magic == LOG_BLOCK_MAGIC ? h : nullptr;
+  }
+
+  const LogRecord* records(uint32_t seq) const {
+    return (const LogRecord*)(data + logBlockOffset(seq) + sizeof(LogBlockHeader));
+  }
+
+  // Records in a block; unsealed blocks end at the first empty slot or EOF
+  uint16_t recordCount(uint32_t seq, const LogBlockHeader* h) const {
+    if (h->flags & LOG_BLOCK_SEALED) return h->count;
+
+    uint32_t start = logBlockOffset(seq) + sizeof(LogBlockHeader);
+    uint32_t avail = start < size ? (size - start) / sizeof(LogRecord) : 0;
+    if (avail > LOG_RECORDS_PER_BLOCK) avail = LOG_RECORDS_PER_BLOCK;
+    const LogRecord* r = records(seq);
+    uint16_t n = 0;
+    while (n < avail && r[n].type != LOG_REC_EMPTY) n++;
+    return n;
+  }
+
+  // Blocks that can hold matches, from the index when there is one
+  std::vector<Block> select(const Filter& f) const {
+    std::vector<Block> out;
+    for (uint32_t seq = 0; seq < blockCount; seq++) {
+      if (index) {
+        const LogIndexEntry& e = index[seq];
+        if (e.count == 0 || e.firstTime > f.to) continue;
+        if ((e.flags & LOG_BLOCK_SEALED) && e.lastTime < f.from) continue;
+        if (f.boot >= 0 && e.boot != f.boot) continue;
+        if (f.type >= 0 && !(e.typeMask & (1 << f.type))) continue;
+      }
+
+      const LogBlockHeader* h = blockHeader(seq);
+      if (!h) continue;
+      if (!index) {
+        // Unsealed headers may understate lastTime, so only trust firstTime
+        if (h->firstTime > f.to) continue;
+        if ((h->flags & LOG_BLOCK_SEALED) && h->lastTime < f.from) continue;
+        if (f.boot >= 0 && h->boot != f.boot) continue;
+      }
+      if (f.node >= 0 && (h->flags & LOG_BLOCK_SEALED) &&
+          !(h->nodes[f.node >> 5] & (1UL << (f.node & 31)))) {
+        continue;
+      }
+
+      uint16_t n = recordCount(seq, h);
+      if (n) out.push_back(Block{seq, h, n});
+    }
+    return out;
+  }
+};
+
+const char* typeName(uint8_t type) {
+  switch (type) {
+    case LOG_REC_ENV: return "ENV";
+    case LOG_REC_DETECT: return "DETECT";
+    case LOG_REC_ALARM: return "ALARM";
+    case LOG_REC_EVENT: return "EVENT";
+    default: return "?";
+  }
+}
+
+int parseType(const char* s) {
+  if (!strcmp(s, "env")) return LOG_REC_ENV;
+  if (!strcmp(s, "detect")) return LOG_REC_DETECT;
+  if (!strcmp(s, "alarm")) return LOG_REC_ALARM;
+  if (!strcmp(s, "event")) return LOG_REC_EVENT;
+  return -1;
+}
+
+// Reassemble a text record and its continuations; returns records consumed
+uint16_t readText(const LogRecord* r, uint16_t avail, std::string& text) {
+  uint8_t length = r[0].text.length;
+  text.assign(r[0].text.text, length < LOG_TEXT_FIRST_BYTES ? length : LOG_TEXT_FIRST_BYTES);
+  uint16_t i = 1;
+  while (text.size() < length && i < avail && r[i].type == LOG_REC_TEXT_MORE) {
+    size_t n = length - text.size();
+    text.append(r[i].more, n < LOG_TEXT_MORE_BYTES ? n : LOG_TEXT_MORE_BYTES);
+    i++;
+  }
+  return i;
+}
+
+void csvText(const std::string& s) {
+  putchar('"');
+  for (char c : s) {
+    if (c == '"') putchar('"');
+    putchar(c);
+  }
+  putchar('"');
+}
+
+int cmdCsv(const LogFile& log, const Filter& f) {
+  printf("boot,time,node,type,temp_c,humidity,pressure_hpa,battery_mv,rssi,"
+         "event,confidence,distance_cm,zone,text\n");
+
+  uint32_t rows = 0;
+  std::string text;
+  for (const Block& b : log.select(f)) {
+    const LogRecord* r = log.records(b.seq);
+    for (uint16_t i = 0; i < b.count; ) {
+      const LogRecord& rec = r[i];
+      uint32_t t = b.header->firstTime + rec.dt;
+      uint16_t used = 1;
+      if (rec.type == LOG_REC_ALARM || rec.type == LOG_REC_EVENT) {
+        used = readText(&r[i], b.count - i, text);
+      }
+
+      bool match = rec.type != LOG_REC_TEXT_MORE && t >= f.from && t <= f.to &&
+                   (f.node < 0 || rec.node == f.node) &&
+                   (f.type < 0 || rec.type == f.type);
+      i += used;
+      if (!match) continue;
+
+      printf("%u,%u,%02X,%s,", b.header->boot, t, rec.node, typeName(rec.type));
+      switch (rec.type) {
+        case LOG_REC_ENV:
+          printf("%.2f,%.1f,%.1f,%u,%d,,,,,\n", rec.env.tempC100 / 100.0,
+                 rec.env.humidity2 / 2.0, rec.env.pressure10 / 10.0,
+                 rec.env.batteryMv, rec.env.rssi);
+          break;
+        case LOG_REC_DETECT:
+          printf(",,,,,%u,%u,%u,%u,\n", rec.detect.eventType,
+                 rec.detect.confidence, rec.detect.distance, rec.detect.zone);
+          break;
+        default:
+          printf(",,,,,,,,,");
+          csvText(text);
+          putchar('\n');
+          break;
+      }
+      rows++;
+    }
+  }
+  fprintf(stderr, "%u rows\n", rows);
+  return 0;
+}
+
+int cmdBlocks(const LogFile& log) {
+  printf("seq,offset,boot,first,last,records,sealed,nodes\n");
+  for (uint32_t seq = 0; seq < log.blockCount; seq++) {
+    const LogBlockHeader* h = log.blockHeader(seq);
+    if (!h) {
+      printf("%u,%u,,,,,invalid,\n", seq, logBlockOffset(seq));
+      continue;
+    }
+    printf("%u,%u,%u,%u,%u,%u,%s,", seq, logBlockOffset(seq), h->boot,
+           h->firstTime, h->lastTime, log.recordCount(seq, h),
+           (h->flags & LOG_BLOCK_SEALED) ? "yes" : "no");
+    const char* sep = "";
+    for (int id = 0; id < 256; id++) {
+      if (h->nodes[id >> 5] & (1UL << (id & 31))) {
+        printf("%s%02X", sep, id);
+        sep = " ";
+      }
+    }
+    putchar('\n');
+  }
+  return 0;
+}
+
+int cmdInfo(const LogFile& log) {
+  uint32_t records = 0, sealed = 0;
+  uint32_t first = UINT32_MAX, last = 0;
+  for (uint32_t seq = 0; seq < log.blockCount; seq++) {
+    const LogBlockHeader* h = log.blockHeader(seq);
+    if (!h) continue;
+    uint16_t n = log.recordCount(seq, h);
+    if (!n) continue;
+    records += n;
+    sealed += (h->flags & LOG_BLOCK_SEALED) ? 1 : 0;
+    if (h->firstTime < first) first = h->firstTime;
+    const LogRecord* r = log.records(seq);
+    uint32_t end = h->firstTime + r[n - 1].dt;
+    if (end > last) last = end;
+  }
+
+  printf("size:       %zu bytes\n", log.size);
+  printf("boots:      %u\n", log.header->boot);
+  printf("blocks:     %u (%u sealed)\n", log.blockCount, sealed);
+  printf("records:    %u (%.1f bytes each, block headers included)\n", records,
+         records ? (double)log.blockCount * LOG_BLOCK_SIZE / records : 0.0);
+  if (records) printf("time:       %u - %u s\n", first, last);
+  printf("index:      %s\n", log.index ? "yes" : "no (file not closed)");
+  return 0;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: logtool info|blocks <file>\n"
+          "       logtool csv <file> [--from S] [--to S] [--node ID] "
+          "[--type env|detect|alarm|event] [--boot N]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    usage();
+    return 2;
+  }
+
+  Filter f;
+  for (int i = 3; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!val) {
+      usage();
+      return 2;
+    }
+    if (!strcmp(arg, "--from")) f.from = strtoul(val, nullptr, 0);
+    else if (!strcmp(arg, "--to")) f.to = strtoul(val, nullptr, 0);
+    else if (!strcmp(arg, "--node")) f.node = strtol(val, nullptr, 16) & 0xFF;
+    else if (!strcmp(arg, "--boot")) f.boot = atoi(val);
+    else if (!strcmp(arg, "--type") && (f.type = parseType(val)) >= 0) {}
+    else {
+      usage();
+      return 2;
+    }
+    i++;
+  }
+
+  LogFile log;
+  if (!log.open(argv[2])) return 1;
+
+  std::string cmd = argv[1];
+  if (cmd == "info") return cmdInfo(log);
+  if (cmd == "blocks") return cmdBlocks(log);
+  if (cmd == "csv") return cmdCsv(log, f);
+  usage();
+  return 2;
+}
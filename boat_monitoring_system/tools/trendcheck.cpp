@@ -0,0 +1,182 @@
+/**
+ * trendcheck - TrendStore rollups against a rehydrated copy (host)
+ *
+ * Build:  g++ -std=c++11 -O2 -DESP_PLATFORM -Itools/host \
+ *             -o trendcheck tools/trendcheck.cpp
+ *
+ * Usage:  trendcheck [days] [--no-psram]
+ *
+ * ESP_PLATFORM selects TrendStore's real allocation path; the heap_caps
+ * calls come from tools/host/esp_heap_caps.h, which has 8 MB of PSRAM, or
+ * none with --no-psram (a board that gets the short internal-RAM rings).
+ *
+ * Six nodes report every 30 s for `days` days. Each sample goes to a live
+ * TrendStore and to the DataLogger on the emulated card. A second store
+ * is then rehydrated from the card TREND_REHYDRATE_BLOCKS at a time, as
+ * the hub loop does, with one live sample added part way through (it is
+ * on the card too, after the replay's start, and must count once). Every
+ * bucket of both stores is compared at each resolution. The card's cost
+ * model times the replay and its longest step, which approximate the
+ * hub's history load and the longest loop pass it adds on a real SD card. The tool also checks the rings at their edges: a sample after a
+ * long gap, one older than the minute ring and one older than all of
+ * them, and a bucket past 65535 samples. Exits 1 on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../hub_firmware/history/TrendStore.h"
+
+namespace {
+
+const uint8_t NODES = 6;
+const uint32_t SAMPLE_S = 30;
+const uint16_t MAX_POINTS = 1500;
+
+TrendStore live;
+TrendStore rebuilt;
+TrendPoint a[MAX_POINTS];
+TrendPoint b[MAX_POINTS];
+
+void sample(uint8_t node, uint32_t s, float& temp, float& humidity, float& pressure,
+            uint16_t& batteryMv, int16_t& rssi) {
+  temp = 20 + 5 * sinf(s / 86400.0f * 6.283f) + node;
+  humidity = 55.0f + node;
+  pressure = 1010 + 8 * sinf(s / 300000.0f) + node * 0.1f;
+  batteryMv = 3700 + node;
+  rssi = -70 - node;
+}
+
+bool same(const TrendPoint& x, const TrendPoint& y) {
+  return x.time == y.time && x.count == y.count && x.min == y.min &&
+         x.max == y.max && fabsf(x.mean - y.mean) < 1e-3f;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int days = 3;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--no-psram")) hostHeap().psram = hostHeap().psramFree = 0;
+    else days = atoi(argv[i]);
+  }
+  if (days <= 0) {
+    fprintf(stderr, "usage: trendcheck [days] [--no-psram]\n");
+    return 1;
+  }
+
+  RtcClock rtc;
+  rtc.begin(Wire);
+  SpiArbiter spi;
+  DataLogger logger(5, rtc, spi);
+  if (!logger.begin()) {
+    printf("DataLogger.begin() failed\n");
+    return 1;
+  }
+
+  uint64_t start = hostClockUs();
+  for (uint32_t s = 0; s < (uint32_t)days * 86400; s += SAMPLE_S) {
+    if (hostClockUs() < start + s * 1000000ULL) hostClockUs() = start + s * 1000000ULL;
+    for (uint8_t node = 1; node <= NODES; node++) {
+      float temp, humidity, pressure;
+      uint16_t batteryMv;
+      int16_t rssi;
+      sample(node, s, temp, humidity, pressure, batteryMv, rssi);
+      logger.logEnvironmental(node, temp, humidity, pressure, batteryMv, rssi);
+      live.add(node, rtc.now(), temp, humidity, pressure, batteryMv, rssi);
+    }
+    logger.process();
+    rtc.process();
+  }
+
+  // The hub reboots. The replay starts at `now`; a sample from then on
+  // reaches the card too, but is added live in the middle of the replay.
+  hostClockUs() += 5000000;
+  uint32_t now = rtc.now();
+  float temp, humidity, pressure;
+  uint16_t batteryMv;
+  int16_t rssi;
+  sample(1, now, temp, humidity, pressure, batteryMv, rssi);
+  logger.logEnvironmental(1, temp, humidity, pressure, batteryMv, rssi);
+  live.add(1, now, temp, humidity, pressure, batteryMv, rssi);
+  logger.end();
+
+  printf("live: %u samples, %u nodes, %u B/node in %s\n", live.getSamples(),
+         live.getNodeCount(), (unsigned)live.bytesPerNode(),
+         live.isInternal() ? "internal RAM" : "PSRAM");
+
+  uint64_t before = hostClockUs(), longest = 0;
+  uint32_t steps = 0;
+  bool more = rebuilt.beginRehydrate(now, days);
+  longest = hostClockUs() - before;
+  while (more) {
+    uint64_t t = hostClockUs();
+    more = rebuilt.rehydrateStep(TREND_REHYDRATE_BLOCKS);
+    if (hostClockUs() - t > longest) longest = hostClockUs() - t;
+    if (++steps == 1) rebuilt.add(1, now, temp, humidity, pressure, batteryMv, rssi);
+  }
+  printf("rehydrate: %u samples from %u files, %.1f s on the card in %u steps "
+         "(longest %.1f ms)\n", rebuilt.getRehydrated(),
+         (unsigned)hostCard().files.size(), (hostClockUs() - before) / 1e6, steps,
+         longest / 1e3);
+
+  uint32_t points = 0, mismatches = 0;
+  for (uint8_t node = 1; node <= NODES; node++) {
+    for (uint8_t m = 0; m < TREND_METRICS; m++) {
+      for (uint8_t r = 0; r < TREND_RESOLUTIONS; r++) {
+        TrendMetric metric = (TrendMetric)m;
+        TrendResolution res = (TrendResolution)r;
+        uint32_t from = now > (uint32_t)days * 86400 ? now - days * 86400 : 0;
+        uint16_t na = live.query(node, metric, res, from, now, a, MAX_POINTS);
+        uint16_t nb = rebuilt.query(node, metric, res, from, now, b, MAX_POINTS);
+        points += na;
+        if (na != nb) {
+          printf("node %u metric %u res %u: %u buckets live, %u rehydrated\n",
+                 node, m, r, na, nb);
+          mismatches++;
+          continue;
+        }
+        for (uint16_t i = 0; i < na; i++) {
+          if (same(a[i], b[i])) continue;
+          if (mismatches < 5) {
+            printf("node %u metric %u res %u at %u: mean %.3f/%.3f count %u/%u\n",
+                   node, m, r, a[i].time, a[i].mean, b[i].mean, a[i].count, b[i].count);
+          }
+          mismatches++;
+        }
+      }
+    }
+  }
+  printf("compared %u buckets: %u mismatches\n", points, mismatches);
+
+  // A sample ten days on clears every minute bucket it skips over
+  uint32_t later = now + 10 * 86400;
+  live.add(1, later, 20, 50, 1000, 3700, -70);
+  uint16_t n = live.query(1, TREND_TEMPERATURE, TREND_MINUTE, 0, later, a, MAX_POINTS);
+  bool gapOk = n == 1;
+  printf("after a 10-day gap: %u minute bucket(s) (expect 1)\n", n);
+
+  // Older than the minute ring: kept by the coarser rings only
+  live.add(1, now, 20, 50, 1000, 3700, -70);
+  n = live.query(1, TREND_TEMPERATURE, TREND_MINUTE, 0, later, a, MAX_POINTS);
+  gapOk = gapOk && n == 1;
+  printf("sample 10 days late: %u minute bucket(s) (expect 1)\n", n);
+
+  // Older than every ring: dropped
+  uint32_t dropped = live.getDropped();
+  live.add(1, later - 400 * 86400, 20, 50, 1000, 3700, -70);
+  bool lateOk = live.getDropped() == dropped + 1;
+  printf("sample 400 days late: dropped %u -> %u (expect +1)\n", dropped,
+         live.getDropped());
+
+  // A bucket stops summing when its count saturates, so the mean holds
+  for (uint32_t i = 0; i < 70000; i++) live.add(2, later, i < 65535 ? 20 : 30, 50, 1000, 3700, -70);
+  n = live.query(2, TREND_TEMPERATURE, TREND_DAY, later - later % 86400, later, a, MAX_POINTS);
+  bool fullOk = n == 1 && a[0].count == 65535 && fabsf(a[0].mean - 20) < 1e-3f &&
+                a[0].max == 30;
+  printf("70000 samples in a bucket: count %u, mean %.2f, max %.2f (expect 65535, 20, 30)\n",
+         n ? a[0].count : 0, n ? a[0].mean : 0, n ? a[0].max : 0);
+
+  return mismatches == 0 && gapOk && lateOk && fullOk ? 0 : 1;
+}
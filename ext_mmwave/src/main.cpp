@@ -1,9 +1,11 @@
 #include <Arduino.h>
 #include <RadioLib.h>
 #include <Wire.h>
-#include <Adafruit_BME280.h>
 #include <Adafruit_SSD1306.h>
 #include "mmwave_gpio.h"
+#include "i2c_bus.h"
+#include "bme280_forced.h"
+#include "ssd1306_pages.h"
 #include "proto.h"
 #include "config.h"
 
@@ -14,8 +16,12 @@ static const int PIN_LORA_SS=18, PIN_LORA_RST=14, PIN_LORA_DIO0=26,
 AppCfg CFG; // defaults from config.h
 
 SX1276 radio = new Module(PIN_LORA_SS, PIN_LORA_DIO0, PIN_LORA_RST, PIN_LORA_BUSY);
-Adafruit_BME280 bme;
-Adafruit_SSD1306 oled(128, 64, &Wire, -1);
+i2cbus::Bus bus(Wire, 4, 15); // BME280 + OLED, shared by task_env/task_oled
+bme280::Forced bme(bus);
+// Both clocks at the bus's 400 kHz: the driver's default clkAfter would
+// leave Wire at 100 kHz once begin() returns
+Adafruit_SSD1306 oled(128, 64, &Wire, -1, 400000, 400000);
+ssd1306::PageRenderer screen(oled, bus);
 MmwaveGPIO mmw(13);
 
 static uint16_t NODE_ID = 0xB032;
@@ -30,9 +36,11 @@ QueueHandle_t q_tx; // raw payloads for TX (simplified)
 
 void setup() {
   Serial.begin(115200);
-  Wire.begin(4, 15);
+  bus.begin();
   oled.begin(SSD1306_SWITCHCAPVCC, 0x3C);
-  oled.clearDisplay(); oled.display();
+  screen.begin();
+  screen.set_idle_blank_ms(CFG.oled.idle_blank_s*1000);
+  oled.clearDisplay(); screen.flush();
 
   mmw.begin();
   bme.begin(0x76);
@@ -68,12 +76,19 @@ void task_motion(void*) {
 }
 
 void task_env(void*) {
+  // One forced conversion per period; the BME280 sleeps in between
+  TickType_t wake = xTaskGetTickCount();
+  uint32_t lastStats = millis();
   for(;;){
-    proto::Header h; h.type=proto::ENV; h.node_id=NODE_ID; h.seq=++SEQ;
-    proto::EnvPayload ep{ bme.readTemperature(), bme.readHumidity(), bme.readPressure()/100.0f };
-    uint8_t buf[64]; size_t n = proto::encode(buf, sizeof(buf), h, &ep, sizeof(ep));
-    if(n) xQueueSend(q_tx, buf, 0);
-    vTaskDelay(pdMS_TO_TICKS(CFG.env.period_s*1000));
+    if (millis() - lastStats >= 600000) { lastStats = millis(); bus.print_stats(Serial); }
+    bme280::Reading r;
+    if (bme.measure(r)) {
+      proto::Header h; h.type=proto::ENV; h.node_id=NODE_ID; h.seq=++SEQ;
+      proto::EnvPayload ep{ r.temperature(), r.humidity(), r.pressure_hpa() };
+      uint8_t buf[64]; size_t n = proto::encode(buf, sizeof(buf), h, &ep, sizeof(ep));
+      if(n) xQueueSend(q_tx, buf, 0);
+    }
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(CFG.env.period_s*1000));
   }
 }
 
@@ -101,12 +116,15 @@ void task_lora_tx(void*) {
 }
 
 void task_oled(void*) {
+  bool last=false;
   for(;;){
+    bool p = mmw.presence();
+    if (p != last) { last = p; screen.wake(); } // light up on presence changes
     oled.clearDisplay();
     oled.setCursor(0,0); oled.setTextSize(1); oled.setTextColor(WHITE);
     oled.println("Bristol32 EXT");
-    oled.printf("mmw:%d\n", (int)mmw.presence());
-    oled.display();
+    oled.printf("mmw:%d\n", (int)p);
+    screen.flush(); // changed columns only
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
 }
@@ -1,8 +1,13 @@
+#include "alarm_journal.h"
+#include "alert_rules.h"
 #include "config.h"
+#include "i2c_bus.h"
 #include "proto.h"
+#include "ssd1306_pages.h"
 #include <Adafruit_INA219.h>
 #include <Adafruit_SSD1306.h>
 #include <Arduino.h>
+#include <LittleFS.h>
 #include <Wire.h>
 
 void smtp_send_async(const String &subject, const String &body);
@@ -12,21 +17,52 @@ static const int PIN_LORA_SS = 18, PIN_LORA_RST = 14, PIN_LORA_DIO0 = 26,
                  PIN_LORA_DIO1 = 35, PIN_LORA_BUSY = 32;
 SX1276 radio =
     new Module(PIN_LORA_SS, PIN_LORA_DIO0, PIN_LORA_RST, PIN_LORA_BUSY);
+i2cbus::Bus bus(Wire, 4, 15); // INA219 + OLED, shared by task_power/task_oled
 Adafruit_INA219 ina;
-Adafruit_SSD1306 oled(128, 64, &Wire, -1);
+// clkAfter = bus clock, or oled.begin() drops Wire to 100 kHz
+Adafruit_SSD1306 oled(128, 64, &Wire, -1, 400000, 400000);
+ssd1306::PageRenderer screen(oled, bus);
+static const uint8_t INA219_ADDR = 0x40;
+
+// Fed from the radio, power and alarm tasks; the lock covers the handler too
+rules::Engine alert_rules;
+static SemaphoreHandle_t rules_lock;
+static const char *RULES_FILE = "/rules.txt";
+static const size_t RULES_FILE_MAX = 2048;
 
 void task_lora_rx(void *);
 void task_power(void *);
 void task_oled(void *);
 void task_alarm_manager(void *);
+void load_rules();
+void restore_alarm_state();
+
+// The INA219 driver talks to Wire itself, so its calls run as bus jobs
+struct PowerSample {
+  float v, i;
+};
+
+static bool ina_begin(TwoWire &wire, void *) { return ina.begin(&wire); }
+
+static bool ina_sample(TwoWire &, void *ctx) {
+  PowerSample *s = static_cast<PowerSample *>(ctx);
+  s->v = ina.getBusVoltage_V() + ina.getShuntVoltage_mV() / 1000.0f;
+  s->i = ina.getCurrent_mA() / 1000.0f;
+  return true;
+}
 
 void setup() {
   Serial.begin(115200);
-  Wire.begin(4, 15);
+  bus.begin();
   oled.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  screen.begin();
+  screen.set_idle_blank_ms(CFG.oled.idle_blank_s * 1000);
   oled.clearDisplay();
-  oled.display();
-  ina.begin();
+  screen.flush();
+  bus.label(INA219_ADDR, "ina219");
+  bus.run(INA219_ADDR, ina_begin, nullptr);
+  restore_alarm_state();
+  load_rules();
   radio.begin(CFG.lora.freq, CFG.lora.bw, CFG.lora.sf, CFG.lora.cr, 8,
               CFG.lora.power);
   xTaskCreatePinnedToCore(task_lora_rx, "lrx", 4096, nullptr, 2, nullptr, 1);
@@ -46,6 +82,137 @@ static uint32_t last_alert_time = 0;
 static bool grace_period_active = false;
 static float last_tws_knots = 0;
 static int last_twd_deg = 0;
+static proto::EnvPayload last_env{};
+
+// Every transition is journaled; the lock covers the radio and alarm tasks
+static journal::Journal alarm_journal("gw-alarm");
+static SemaphoreHandle_t journal_lock;
+
+static void set_state(AlarmState state) {
+  alarm_state = state;
+  xSemaphoreTake(journal_lock, portMAX_DELAY);
+  alarm_journal.append(state, 0, 0);
+  xSemaphoreGive(journal_lock);
+}
+
+// Back to the state before a reset. Its timers restart, so a reset during
+// the grace period allows a full grace period again before the alarm.
+void restore_alarm_state() {
+  journal_lock = xSemaphoreCreateMutex();
+  journal::Entry last;
+  if (!alarm_journal.begin() || !alarm_journal.latest(last) ||
+      last.state > GRACE_PERIOD)
+    return;
+
+  alarm_state = (AlarmState)last.state;
+  grace_period_active = alarm_state == GRACE_PERIOD;
+  if (alarm_state == GRACE_PERIOD)
+    last_motion_time = millis();
+  if (alarm_state == ALARM_ACTIVE)
+    last_alert_time = millis();
+  Serial.printf("alarm state %u restored in %luus (#%lu)\n", last.state,
+                (unsigned long)alarm_journal.stats().restore_us,
+                (unsigned long)last.seq);
+}
+
+static void feed(rules::Metric metric, uint16_t node, float value) {
+  xSemaphoreTake(rules_lock, portMAX_DELAY);
+  alert_rules.sample(metric, node, value, millis());
+  xSemaphoreGive(rules_lock);
+}
+
+// Grace period over with no visitor confirmed
+static void raise_intruder_alarm() {
+  grace_period_active = false;
+  last_alert_time = millis();
+  set_state(ALARM_ACTIVE);
+  smtp_send_async("[Bristol32] INTRUDER ALERT",
+                  "Motion detected without visitor confirmation - "
+                  "possible intruder!");
+  Serial.println("Grace period expired - INTRUDER ALERT triggered");
+}
+
+static void reset_alarm() {
+  set_state(ARMED);
+  smtp_send_async("[Bristol32] ALARM RESET",
+                  "Alarm system reset to armed state");
+  Serial.println("Alarm system reset to armed state");
+}
+
+// Rule edges. The state machine moves on rules over its own timers
+// (grace_age, alarm_age); other metrics can notify or raise the alarm too.
+static void on_rule(const rules::Event &ev, void *) {
+  const rules::Rule &r = *ev.rule;
+  char text[96];
+  snprintf(text, sizeof(text), "%s: %s %.1f (node %04X)", r.name,
+           rules::Engine::metric_name(r.metric), ev.value, ev.node);
+  Serial.printf("rule %s %s\n", ev.raised ? "raised" : "cleared", text);
+
+  if (!ev.raised) {
+    if (r.action == rules::NOTIFY)
+      smtp_send_async(String("[Bristol32] CLEARED ") + r.name, text);
+    return;
+  }
+
+  switch (r.action) {
+  case rules::NOTIFY:
+    smtp_send_async(String("[Bristol32] ") + r.name, text);
+    break;
+
+  case rules::ALARM:
+    if (alarm_state == DISARMED || alarm_state == ALARM_ACTIVE)
+      break;
+    if (r.metric == rules::GRACE_AGE) {
+      raise_intruder_alarm();
+    } else {
+      grace_period_active = false;
+      last_alert_time = millis();
+      set_state(ALARM_ACTIVE);
+      smtp_send_async("[Bristol32] ALARM", text);
+    }
+    break;
+
+  case rules::RESET:
+    if (alarm_state != ALARM_ACTIVE)
+      break;
+    reset_alarm();
+    break;
+
+  default:
+    break;
+  }
+}
+
+// /rules.txt on LittleFS, or defaults built from CFG.alarm
+void load_rules() {
+  rules_lock = xSemaphoreCreateMutex();
+  alert_rules.on_event(on_rule);
+
+  static char text[RULES_FILE_MAX + 1];
+  const char *source = "defaults";
+  File f;
+  if (LittleFS.begin(false))
+    f = LittleFS.open(RULES_FILE, "r");
+  if (f) {
+    text[f.read((uint8_t *)text, RULES_FILE_MAX)] = '\0';
+    f.close();
+    source = RULES_FILE;
+  } else {
+    snprintf(text, sizeof(text),
+             "grace_expired grace_age > %lu alarm\n"
+             "alarm_reset   alarm_age > %lu reset\n"
+             "house_low     supply_v < 12.0 hyst 0.4 for 5m notify\n"
+             "cabin_hot     temp > 45 hyst 2 for 2m notify\n"
+             "baro_falling  pressure rate 3h < -3 hyst 0.5 notify\n"
+             "gale          wind > 34 hyst 4 for 1m notify\n",
+             (unsigned long)CFG.alarm.grace_period_s,
+             (unsigned long)CFG.alarm.alert_cooldown_s);
+  }
+
+  uint8_t count = alert_rules.load(text, &Serial);
+  Serial.printf("alert rules: %u from %s\n", count, source);
+  alert_rules.print(Serial);
+}
 
 void handle_frame(const uint8_t *buf, size_t len) {
   proto::Header h;
@@ -61,8 +228,8 @@ void handle_frame(const uint8_t *buf, size_t len) {
 
     if (alarm_state == ARMED) {
       // Start grace period for potential visitor
-      alarm_state = GRACE_PERIOD;
       grace_period_active = true;
+      set_state(GRACE_PERIOD);
       smtp_send_async("[Bristol32] NOTICE",
                       "Motion detected - grace period started");
       Serial.println("Motion detected - entering grace period");
@@ -82,13 +249,18 @@ void handle_frame(const uint8_t *buf, size_t len) {
     }
 
   } else if (h.type == proto::ENV) {
-    // TODO: update last env snapshot and optionally include in emails
-    // Could add environmental alarms here (temp too high/low, etc.)
+    if (n < sizeof(proto::EnvPayload))
+      return;
+    memcpy(&last_env, p, sizeof(last_env));
+    feed(rules::TEMP, h.node_id, last_env.t_c);
+    feed(rules::HUMIDITY, h.node_id, last_env.h_rh);
+    feed(rules::PRESSURE, h.node_id, last_env.p_hpa);
   } else if (h.type == proto::WIND) {
     const proto::WindPayload *wp = (const proto::WindPayload *)p;
     last_tws_knots = wp->tws_mms / 514.444; // mm/s -> knots
     last_twd_deg = wp->twd_deg10 / 10;
     Serial.printf("WIND: %.1fkt %03d\n", last_tws_knots, last_twd_deg);
+    feed(rules::WIND, h.node_id, last_tws_knots);
   }
 }
 
@@ -103,48 +275,65 @@ void task_lora_rx(void *) {
   }
 }
 
+// Time since `t`, or 0 if the radio task moved `t` past `now` meanwhile
+static uint32_t age_ms(uint32_t now, uint32_t t) {
+  return (int32_t)(now - t) > 0 ? now - t : 0;
+}
+
 void task_alarm_manager(void *) {
   for (;;) {
     uint32_t now = millis();
 
-    if (alarm_state == GRACE_PERIOD && grace_period_active) {
-      if (now - last_motion_time > CFG.alarm.grace_period_s * 1000) {
-        // Grace period expired - this was likely an intruder
-        alarm_state = ALARM_ACTIVE;
-        grace_period_active = false;
-        smtp_send_async("[Bristol32] INTRUDER ALERT",
-                        "Motion detected without visitor confirmation - "
-                        "possible intruder!");
-        Serial.println("Grace period expired - INTRUDER ALERT triggered");
-        last_alert_time = now;
-      }
-    }
+    // State timers as metrics (0 outside the state); the grace_expired and
+    // alarm_reset rules move the state machine on
+    bool in_grace = alarm_state == GRACE_PERIOD && grace_period_active;
+    feed(rules::GRACE_AGE, 0,
+         in_grace ? age_ms(now, last_motion_time) / 1000.0f : 0);
+    feed(rules::ALARM_AGE, 0,
+         alarm_state == ALARM_ACTIVE ? age_ms(now, last_alert_time) / 1000.0f : 0);
 
-    // Auto-reset alarm after cooldown period
-    if (alarm_state == ALARM_ACTIVE &&
-        now - last_alert_time > CFG.alarm.alert_cooldown_s * 1000) {
-      alarm_state = ARMED;
-      smtp_send_async("[Bristol32] ALARM RESET",
-                      "Alarm system reset to armed state");
-      Serial.println("Alarm system reset to armed state");
+    // Hard stops at the configured times, whatever /rules.txt says: a file
+    // without grace_expired or alarm_reset must not disable the alarm or
+    // latch it. A rule can only move the state on sooner.
+    xSemaphoreTake(rules_lock, portMAX_DELAY);  // on_rule runs under it
+    if (alarm_state == GRACE_PERIOD && grace_period_active &&
+        age_ms(now, last_motion_time) > CFG.alarm.grace_period_s * 1000) {
+      raise_intruder_alarm();
+    } else if (alarm_state == ALARM_ACTIVE &&
+               age_ms(now, last_alert_time) > CFG.alarm.alert_cooldown_s * 1000) {
+      reset_alarm();
     }
+    xSemaphoreGive(rules_lock);
 
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
 }
 
 void task_power(void *) {
+  uint32_t ticks = 0;
   for (;;) {
-    float v = ina.getBusVoltage_V() + ina.getShuntVoltage_mV() / 1000.0f;
-    float i = ina.getCurrent_mA() / 1000.0f;
-    (void)v;
-    (void)i; // TODO: detect edges and email
+    PowerSample s{};
+    if (bus.run(INA219_ADDR, ina_sample, &s)) {
+      feed(rules::SUPPLY_V, 0, s.v);
+      feed(rules::SUPPLY_A, 0, s.i);
+    }
+    if (++ticks % 600 == 0)
+      bus.print_stats(Serial);
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
 }
 
 void task_oled(void *) {
+  AlarmState shown_state = alarm_state;
+  uint32_t shown_motion = last_motion_time;
   for (;;) {
+    // Light the panel up when the alarm state changes or motion arrives
+    if (alarm_state != shown_state || last_motion_time != shown_motion) {
+      shown_state = alarm_state;
+      shown_motion = last_motion_time;
+      screen.wake();
+    }
+
     oled.clearDisplay();
     oled.setCursor(0, 0);
     oled.setTextSize(1);
@@ -179,7 +368,7 @@ void task_oled(void *) {
     oled.setCursor(0, 48);
     oled.printf("TWS:%.1fkt TWD:%03d", last_tws_knots, last_twd_deg);
 
-    oled.display();
+    screen.flush(); // changed columns only
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
 }
@@ -0,0 +1,105 @@
+#include "alarm_journal.h"
+#include "crc8.h"
+
+using namespace journal;
+
+namespace {
+struct __attribute__((packed)) Record {
+  uint32_t seq;
+  uint8_t state;
+  uint8_t mode;
+  uint16_t node;
+  uint8_t crc;  // over the bytes above
+};
+const size_t CRC_SPAN = sizeof(Record) - 1;
+const size_t KEY_LEN = 5;  // "j0".."j15"
+} // namespace
+
+void Journal::key_for(uint8_t slot, char *key) {
+  snprintf(key, KEY_LEN, "j%u", slot);
+}
+
+bool Journal::read_slot(uint8_t slot, Entry &out) {
+  char key[KEY_LEN];
+  key_for(slot, key);
+  Record r;
+  if (prefs_.getBytes(key, &r, sizeof(r)) != sizeof(r)) return false;
+  if (crc8_dallas((const uint8_t *)&r, CRC_SPAN) != r.crc) {
+    prefs_.remove(key);
+    stats_.bad++;
+    return false;
+  }
+  // A record only belongs in the slot its sequence number maps to
+  if (r.seq % SLOTS != slot) {
+    prefs_.remove(key);
+    stats_.bad++;
+    return false;
+  }
+  out = Entry{r.seq, r.state, r.mode, r.node};
+  return true;
+}
+
+bool Journal::begin() {
+  uint32_t start = micros();
+  if (!open_) open_ = prefs_.begin(ns_, false);
+  if (!open_) return false;
+
+  have_ = false;
+  for (uint8_t slot = 0; slot < SLOTS; ++slot) {
+    Entry e;
+    if (!read_slot(slot, e)) continue;
+    if (!have_ || e.seq > last_.seq) {
+      last_ = e;
+      have_ = true;
+    }
+  }
+  stats_.restore_us = micros() - start;
+  return true;
+}
+
+bool Journal::latest(Entry &out) const {
+  if (!have_) return false;
+  out = last_;
+  return true;
+}
+
+bool Journal::append(uint8_t state, uint8_t mode, uint16_t node) {
+  if (!open_) return false;
+  if (have_ && last_.state == state && last_.mode == mode && last_.node == node) {
+    stats_.unchanged++;
+    return true;
+  }
+
+  uint32_t start = micros();
+  Record r{have_ ? last_.seq + 1 : 0, state, mode, node, 0};
+  r.crc = crc8_dallas((const uint8_t *)&r, CRC_SPAN);
+
+  char key[KEY_LEN];
+  key_for(r.seq % SLOTS, key);
+  if (prefs_.putBytes(key, &r, sizeof(r)) != sizeof(r)) return false;
+
+  last_ = Entry{r.seq, state, mode, node};
+  have_ = true;
+  stats_.appends++;
+  uint32_t took = micros() - start;
+  if (took > stats_.append_max_us) stats_.append_max_us = took;
+  return true;
+}
+
+void Journal::clear() {
+  if (open_) prefs_.clear();
+  have_ = false;
+}
+
+void Journal::print(Print &out) {
+  if (!have_) return;
+  uint32_t first = last_.seq >= SLOTS - 1 ? last_.seq - (SLOTS - 1) : 0;
+  char buf[64];
+  for (uint32_t seq = first; seq <= last_.seq; ++seq) {
+    Entry e;
+    if (!read_slot(seq % SLOTS, e) || e.seq != seq) continue;
+    snprintf(buf, sizeof(buf), "%s #%lu state=%u mode=%u node=%02X", ns_,
+             (unsigned long)e.seq, e.state, e.mode, e.node);
+    out.println(buf);
+  }
+}
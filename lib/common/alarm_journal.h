@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Append-only journal of alarm state transitions in NVS.
+//
+// Each transition is one small CRC'd record holding the whole alarm state
+// (state, mode, node), written to the next of SLOTS keys in a ring. NVS
+// appends every put as a new entry and garbage-collects its own pages, so
+// a transition costs one ~32-byte entry write, not a rewrite of the
+// config namespace. begin() reads the ring back and keeps the newest
+// valid record, which is all a restore needs; wrapping simply overwrites
+// the oldest transition, and records that fail their CRC (a write cut off
+// by a brown-out) are ignored and erased. Reading 16 keys takes well under
+// a millisecond.
+//
+// Not thread-safe: callers serialize appends.
+namespace journal {
+
+struct Entry {
+  uint32_t seq;
+  uint8_t state;  // caller's alarm state
+  uint8_t mode;   // caller's alarm mode
+  uint16_t node;  // node that raised the alarm, if any
+};
+
+class Journal {
+public:
+  static const uint8_t SLOTS = 16;
+
+  struct Stats {
+    uint32_t appends;
+    uint32_t unchanged;      // appends skipped, same state as the newest
+    uint8_t bad;             // records erased at begin()
+    uint32_t restore_us;
+    uint32_t append_max_us;
+  };
+
+  explicit Journal(const char *ns) : ns_(ns) {}
+
+  // Open the namespace and find the newest valid record
+  bool begin();
+
+  // The newest record; false when the journal is empty
+  bool latest(Entry &out) const;
+
+  bool append(uint8_t state, uint8_t mode, uint16_t node);
+  void clear();
+
+  // Transitions still in the ring, oldest first
+  void print(Print &out);
+
+  const Stats &stats() const { return stats_; }
+
+private:
+  bool read_slot(uint8_t slot, Entry &out);
+  static void key_for(uint8_t slot, char *key);
+
+  Preferences prefs_;
+  const char *ns_;
+  bool open_{false};
+  bool have_{false};
+  Entry last_{};
+  Stats stats_{};
+};
+
+} // namespace journal
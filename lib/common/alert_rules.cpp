@@ -0,0 +1,275 @@
+#include "alert_rules.h"
+
+using namespace rules;
+
+namespace {
+const uint8_t LINE_LEN = 96;
+
+const char *const METRIC_NAMES[METRIC_COUNT] = {
+    "temp",    "humidity", "pressure", "battery",   "bilge",
+    "wind",    "supply_v", "supply_a", "alarm_age", "grace_age"};
+const char *const ACTION_NAMES[ACTION_COUNT] = {"notify", "alarm", "reset"};
+
+bool parse_float(const char *s, float &out) {
+  char *end;
+  out = strtof(s, &end);
+  return end != s && *end == '\0';
+}
+
+// "90", "90s", "5m", "3h"
+bool parse_duration(const char *s, uint32_t &ms) {
+  char *end;
+  float v = strtof(s, &end);
+  if (end == s || v < 0) return false;
+  uint32_t scale = 1000;
+  if (*end == 'm') scale = 60000;
+  else if (*end == 'h') scale = 3600000;
+  else if (*end != 's' && *end != '\0') return false;
+  if (*end && end[1]) return false;
+  ms = (uint32_t)(v * scale);
+  return true;
+}
+
+template <typename T>
+bool lookup(const char *s, const char *const *names, uint8_t n, T &out) {
+  for (uint8_t i = 0; i < n; ++i) {
+    if (strcmp(s, names[i]) == 0) {
+      out = (T)i;
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+const char *Engine::metric_name(Metric metric) {
+  return metric < METRIC_COUNT ? METRIC_NAMES[metric] : "?";
+}
+
+const char *Engine::action_name(Action action) {
+  return action < ACTION_COUNT ? ACTION_NAMES[action] : "?";
+}
+
+bool Engine::parse_line(char *line, Rule &r) {
+  char *save;
+  char *tok[12];
+  uint8_t n = 0;
+  for (char *t = strtok_r(line, " \t", &save); t && n < 12;
+       t = strtok_r(nullptr, " \t", &save)) {
+    tok[n++] = t;
+  }
+  if (n < 5) return false;
+
+  memset(&r, 0, sizeof(r));
+  strncpy(r.name, tok[0], sizeof(r.name) - 1);
+  r.node = ANY_NODE;
+  r.rate_slot = NO_RATE;
+
+  char *at = strchr(tok[1], '@');
+  if (at) {
+    *at = '\0';
+    char *end;
+    unsigned long node = strtoul(at + 1, &end, 16);
+    if (end == at + 1 || *end || node >= ANY_NODE) return false;
+    r.node = (uint16_t)node;
+  }
+  if (!lookup(tok[1], METRIC_NAMES, METRIC_COUNT, r.metric)) return false;
+  if (!lookup(tok[n - 1], ACTION_NAMES, ACTION_COUNT, r.action)) return false;
+
+  uint8_t i = 2;
+  if (strcmp(tok[i], "rate") == 0) {
+    if (i + 1 >= n - 1 || !parse_duration(tok[i + 1], r.rate_ms) || !r.rate_ms)
+      return false;
+    i += 2;
+  }
+  if (i + 1 >= n - 1) return false;
+  if (strcmp(tok[i], "<") == 0) r.below = true;
+  else if (strcmp(tok[i], ">") != 0) return false;
+  if (!parse_float(tok[i + 1], r.trip)) return false;
+  i += 2;
+
+  float hyst = 0;
+  for (; i + 1 < n - 1; i += 2) {
+    if (strcmp(tok[i], "hyst") == 0) {
+      if (!parse_float(tok[i + 1], hyst) || hyst < 0) return false;
+    } else if (strcmp(tok[i], "for") == 0) {
+      if (!parse_duration(tok[i + 1], r.hold_ms)) return false;
+    } else {
+      return false;
+    }
+  }
+  if (i != n - 1) return false;  // a dangling option
+
+  r.clear = r.below ? r.trip + hyst : r.trip - hyst;
+  return true;
+}
+
+uint8_t Engine::load(const char *text, Print *log) {
+  Rule parsed[MAX_RULES];
+  uint8_t count = 0;
+  uint16_t line_no = 0;
+  char line[LINE_LEN];
+
+  for (const char *p = text; p && *p;) {
+    const char *eol = strchr(p, '\n');
+    size_t len = eol ? (size_t)(eol - p) : strlen(p);
+    line_no++;
+
+    size_t copy = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+    memcpy(line, p, copy);
+    line[copy] = '\0';
+    p = eol ? eol + 1 : nullptr;
+
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    char *start = line;
+    while (*start == ' ' || *start == '\t' || *start == '\r') start++;
+    for (char *end = start + strlen(start);
+         end > start && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r');)
+      *--end = '\0';
+    if (!*start) continue;
+
+    char msg[48];
+    if (count == MAX_RULES) {
+      snprintf(msg, sizeof(msg), "rules: line %u: table full", line_no);
+      if (log) log->println(msg);
+      break;
+    }
+    if (len >= sizeof(line) || !parse_line(start, parsed[count])) {
+      snprintf(msg, sizeof(msg), "rules: line %u: not understood", line_no);
+      if (log) log->println(msg);
+      continue;
+    }
+    count++;
+  }
+
+  // Flat table grouped by metric (stable, so file order is kept within a
+  // metric), with each metric's first index for dispatch
+  count_ = 0;
+  uint8_t rate_rules = 0;
+  for (uint8_t m = 0; m < METRIC_COUNT; ++m) {
+    first_[m] = count_;
+    for (uint8_t i = 0; i < count; ++i) {
+      if (parsed[i].metric != m) continue;
+      Rule &r = rules_[count_];
+      r = parsed[i];
+      if (r.rate_ms) {
+        if (rate_rules == MAX_RATE_RULES) {
+          if (log) log->println("rules: too many rate rules, skipping one");
+          continue;
+        }
+        r.rate_slot = rate_rules++;
+      }
+      count_++;
+    }
+  }
+  first_[METRIC_COUNT] = count_;
+
+  // New table, new state
+  memset(state_, 0, sizeof(state_));
+  memset(history_, 0, sizeof(history_));
+  node_count_ = 0;
+  return count_;
+}
+
+int8_t Engine::node_slot(uint16_t node, bool add) {
+  for (uint8_t i = 0; i < node_count_; ++i)
+    if (nodes_[i] == node) return i;
+  if (!add || node_count_ == MAX_NODE_SLOTS) return -1;
+  nodes_[node_count_] = node;
+  return node_count_++;
+}
+
+// Change over `window`, from the oldest kept sample, scaled to the window.
+// Samples are kept about window/(HISTORY-1) apart, so the oldest is close
+// to a window old once the history has filled.
+bool Engine::rate_change(History &h, float value, uint32_t now, uint32_t window,
+                         float &change) {
+  uint8_t newest = (h.head + HISTORY - 1) % HISTORY;
+  if (h.count == 0 || now - h.time[newest] >= window / (HISTORY - 1)) {
+    h.value[h.head] = value;
+    h.time[h.head] = now;
+    h.head = (h.head + 1) % HISTORY;
+    if (h.count < HISTORY) h.count++;
+  }
+
+  uint8_t oldest = (h.head + HISTORY - h.count) % HISTORY;
+  uint32_t age = now - h.time[oldest];
+  if (age < window * 3 / 4) return false;  // not enough history yet
+  change = (value - h.value[oldest]) * window / age;
+  return true;
+}
+
+void Engine::evaluate(uint8_t index, uint8_t slot, uint16_t node, float value,
+                      uint32_t now) {
+  const Rule &r = rules_[index];
+  State &s = state_[index][slot];
+
+  float x = value;
+  if (r.rate_slot != NO_RATE &&
+      !rate_change(history_[r.rate_slot][slot], value, now, r.rate_ms, x)) {
+    return;
+  }
+
+  bool tripped = r.below ? x < r.trip : x > r.trip;
+  bool cleared = r.below ? x > r.clear : x < r.clear;
+
+  if (!(s.flags & ACTIVE)) {
+    if (!tripped) {
+      s.flags = 0;
+      return;
+    }
+    if (!(s.flags & PENDING)) {
+      s.flags = PENDING;
+      s.since = now;
+    }
+    if (now - s.since < r.hold_ms) return;
+    s.flags = ACTIVE;
+  } else if (cleared) {
+    s.flags = 0;
+  } else {
+    return;
+  }
+
+  if (handler_) {
+    Event ev{&r, node, x, s.flags == ACTIVE};
+    handler_(ev, ctx_);
+  }
+}
+
+bool Engine::sample(Metric metric, uint16_t node, float value, uint32_t now_ms) {
+  if (metric >= METRIC_COUNT || first_[metric] == first_[metric + 1]) return true;
+  int8_t slot = node_slot(node, true);
+  if (slot < 0) {
+    untracked_++;
+    return false;
+  }
+
+  for (uint8_t i = first_[metric]; i < first_[metric + 1]; ++i) {
+    if (rules_[i].node == ANY_NODE || rules_[i].node == node)
+      evaluate(i, slot, node, value, now_ms);
+  }
+  return true;
+}
+
+bool Engine::active(uint8_t rule, uint16_t node) const {
+  for (uint8_t i = 0; i < node_count_; ++i)
+    if (nodes_[i] == node) return rule < count_ && (state_[rule][i].flags & ACTIVE);
+  return false;
+}
+
+void Engine::print(Print &out) const {
+  char buf[112];
+  for (uint8_t i = 0; i < count_; ++i) {
+    const Rule &r = rules_[i];
+    char node[8] = "";
+    if (r.node != ANY_NODE) snprintf(node, sizeof(node), "@%02X", r.node);
+    char rate[16] = "";
+    if (r.rate_ms) snprintf(rate, sizeof(rate), " rate %lus", (unsigned long)(r.rate_ms / 1000));
+    snprintf(buf, sizeof(buf), "rule %-15s %s%s%s %c %g (clear %g) for %lus -> %s",
+             r.name, metric_name(r.metric), node, rate, r.below ? '<' : '>',
+             r.trip, r.clear, (unsigned long)(r.hold_ms / 1000),
+             action_name(r.action));
+    out.println(buf);
+  }
+}
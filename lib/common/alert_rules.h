@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+
+// Declarative alert rules, shared by the hub and int_gateway.
+//
+// Rules are plain text, one per line, so they can live on the SD card or
+// in flash and change without a rebuild:
+//
+//   <name> <metric>[@<node hex>] [rate <dur>] <'<'|'>'> <value>
+//          [hyst <value>] [for <dur>] <notify|alarm|reset>
+//
+//   low_battery   battery < 3300 hyst 100 for 5m notify
+//   baro_falling  pressure rate 3h < -3 hyst 0.5 notify
+//   cabin_hot     temp@04 > 45 hyst 2 for 2m notify
+//
+// load() compiles the text into a flat table sorted by metric. sample()
+// then only visits the rules for that metric, and each rule keeps a few
+// bytes of state per node. A rule raises once the condition has held for
+// `for` and clears once the value is back past the threshold by `hyst`.
+// With `rate`, the condition applies to the change over that window,
+// taken from a small per-node history. Both edges go to the handler.
+namespace rules {
+
+enum Metric : uint8_t {
+  TEMP,       // degC
+  HUMIDITY,   // %RH
+  PRESSURE,   // hPa
+  BATTERY,    // node battery, mV
+  BILGE,      // bilge level, % (for nodes that report one)
+  WIND,       // true wind speed, kt
+  SUPPLY_V,   // house supply, V
+  SUPPLY_A,   // house current, A
+  ALARM_AGE,  // s since the alarm went off (0 when not active)
+  GRACE_AGE,  // s since the last motion while in a grace period (0 otherwise)
+  METRIC_COUNT
+};
+
+enum Action : uint8_t { NOTIFY, ALARM, RESET, ACTION_COUNT };
+
+const uint16_t ANY_NODE = 0xFFFF;
+
+struct Rule {
+  char name[16];
+  Metric metric;
+  Action action;
+  bool below;         // trips under the threshold instead of over
+  uint8_t rate_slot;  // history slot for rate rules, NO_RATE otherwise
+  uint16_t node;      // ANY_NODE or a node ID
+  float trip;
+  float clear;        // trip moved back by the hysteresis
+  uint32_t hold_ms;
+  uint32_t rate_ms;
+};
+
+struct Event {
+  const Rule *rule;
+  uint16_t node;
+  float value;        // the sample, or the change for rate rules
+  bool raised;        // false when the rule clears
+};
+
+typedef void (*Handler)(const Event &ev, void *ctx);
+
+class Engine {
+public:
+  static const uint8_t MAX_RULES = 16;
+  // Nodes with rule state: the hub registry's 32 plus node 0, which the
+  // hub and int_gateway use for their own metrics
+  static const uint8_t MAX_NODE_SLOTS = 33;
+  static const uint8_t MAX_RATE_RULES = 4;
+  static const uint8_t HISTORY = 8;          // samples across a rate window
+  static const uint8_t NO_RATE = 0xFF;
+
+  void on_event(Handler handler, void *ctx = nullptr) {
+    handler_ = handler;
+    ctx_ = ctx;
+  }
+
+  // Replace the table. Lines that do not parse are reported to `log` and
+  // skipped. Returns the number of rules loaded.
+  uint8_t load(const char *text, Print *log = nullptr);
+
+  // False if the sample was ignored because every node slot is taken
+  bool sample(Metric metric, uint16_t node, float value, uint32_t now_ms);
+
+  uint8_t rule_count() const { return count_; }
+  uint32_t untracked() const { return untracked_; }  // samples sample() refused
+  const Rule &rule(uint8_t i) const { return rules_[i]; }
+  bool active(uint8_t rule, uint16_t node) const;
+  void print(Print &out) const;
+
+  static const char *metric_name(Metric metric);
+  static const char *action_name(Action action);
+
+private:
+  enum : uint8_t { PENDING = 1, ACTIVE = 2 };
+
+  struct State {
+    uint8_t flags;
+    uint32_t since;
+  };
+
+  struct History {
+    float value[HISTORY];
+    uint32_t time[HISTORY];
+    uint8_t head, count;
+  };
+
+  bool parse_line(char *line, Rule &r);
+  int8_t node_slot(uint16_t node, bool add);
+  bool rate_change(History &h, float value, uint32_t now, uint32_t window,
+                   float &change);
+  void evaluate(uint8_t index, uint8_t slot, uint16_t node, float value,
+                uint32_t now);
+
+  Rule rules_[MAX_RULES];
+  uint8_t count_{0};
+  uint8_t first_[METRIC_COUNT + 1]{};  // rules_[first_[m] .. first_[m+1]) use m
+
+  uint16_t nodes_[MAX_NODE_SLOTS]{};
+  uint8_t node_count_{0};
+  uint32_t untracked_{0};
+  State state_[MAX_RULES][MAX_NODE_SLOTS]{};
+  History history_[MAX_RATE_RULES][MAX_NODE_SLOTS]{};
+
+  Handler handler_{nullptr};
+  void *ctx_{nullptr};
+};
+
+} // namespace rules
@@ -0,0 +1,159 @@
+#include "bme280_forced.h"
+
+using namespace bme280;
+
+namespace {
+const uint8_t REG_CALIB_TP = 0x88; // 0x88..0x9F, 24 bytes
+const uint8_t REG_CALIB_H1 = 0xA1;
+const uint8_t REG_CHIP_ID = 0xD0;
+const uint8_t REG_CALIB_H = 0xE1;  // 0xE1..0xE7, 7 bytes
+const uint8_t REG_CTRL_HUM = 0xF2;
+const uint8_t REG_STATUS = 0xF3;
+const uint8_t REG_CTRL_MEAS = 0xF4;
+const uint8_t REG_CONFIG = 0xF5;
+const uint8_t REG_DATA = 0xF7;     // press[3] temp[3] hum[2]
+const uint8_t CHIP_ID = 0x60;
+
+const uint8_t OSRS_X1 = 0x01;
+const uint8_t MODE_FORCED = 0x01;
+const uint8_t CTRL_MEAS_FORCED = (OSRS_X1 << 5) | (OSRS_X1 << 2) | MODE_FORCED;
+const uint8_t STATUS_MEASURING = 0x08;
+} // namespace
+
+bool Forced::write_reg(uint8_t reg, uint8_t value) {
+  if (bus_) return bus_->write_reg(addr_, reg, value);
+  wire_->beginTransmission(addr_);
+  wire_->write(reg);
+  wire_->write(value);
+  return wire_->endTransmission() == 0;
+}
+
+bool Forced::read_regs(uint8_t reg, uint8_t *buf, uint8_t len) {
+  if (bus_) return bus_->read_regs(addr_, reg, buf, len);
+  wire_->beginTransmission(addr_);
+  wire_->write(reg);
+  if (wire_->endTransmission(false) != 0) return false; // repeated start
+  if (wire_->requestFrom(addr_, len) != len) return false;
+  for (uint8_t i = 0; i < len; ++i) buf[i] = wire_->read();
+  return true;
+}
+
+bool Forced::read_batch(const i2cbus::RegRead *reads, uint8_t count) {
+  if (bus_) return bus_->read_batch(addr_, reads, count, true);
+  for (uint8_t i = 0; i < count; ++i)
+    if (!read_regs(reads[i].reg, reads[i].buf, reads[i].len)) return false;
+  return true;
+}
+
+bool Forced::begin(uint8_t addr) {
+  addr_ = addr;
+  present_ = false;
+  if (bus_) bus_->label(addr_, "bme280");
+
+  uint8_t id = 0;
+  if (!read_regs(REG_CHIP_ID, &id, 1) || id != CHIP_ID) return false;
+
+  // The three trimming blocks in one bus transaction
+  uint8_t c[24];
+  uint8_t h[7];
+  const i2cbus::RegRead calib[] = {
+      {REG_CALIB_TP, c, sizeof(c)},
+      {REG_CALIB_H1, &h1_, 1},
+      {REG_CALIB_H, h, sizeof(h)},
+  };
+  if (!read_batch(calib, 3)) return false;
+  t1_ = c[0] | (c[1] << 8);
+  t2_ = (int16_t)(c[2] | (c[3] << 8));
+  t3_ = (int16_t)(c[4] | (c[5] << 8));
+  p1_ = c[6] | (c[7] << 8);
+  p2_ = (int16_t)(c[8] | (c[9] << 8));
+  p3_ = (int16_t)(c[10] | (c[11] << 8));
+  p4_ = (int16_t)(c[12] | (c[13] << 8));
+  p5_ = (int16_t)(c[14] | (c[15] << 8));
+  p6_ = (int16_t)(c[16] | (c[17] << 8));
+  p7_ = (int16_t)(c[18] | (c[19] << 8));
+  p8_ = (int16_t)(c[20] | (c[21] << 8));
+  p9_ = (int16_t)(c[22] | (c[23] << 8));
+
+  h2_ = (int16_t)(h[0] | (h[1] << 8));
+  h3_ = h[2];
+  h4_ = (int16_t)(((int8_t)h[3] << 4) | (h[4] & 0x0F));
+  h5_ = (int16_t)(((int8_t)h[5] << 4) | (h[4] >> 4));
+  h6_ = (int8_t)h[6];
+
+  // ctrl_hum only latches on the following ctrl_meas write; mode stays
+  // sleep until trigger()
+  if (!write_reg(REG_CONFIG, 0x00)) return false; // filter off
+  if (!write_reg(REG_CTRL_HUM, OSRS_X1)) return false;
+  if (!write_reg(REG_CTRL_MEAS, CTRL_MEAS_FORCED & ~MODE_FORCED)) return false;
+
+  present_ = true;
+  return true;
+}
+
+bool Forced::trigger() {
+  return present_ && write_reg(REG_CTRL_MEAS, CTRL_MEAS_FORCED);
+}
+
+bool Forced::ready() {
+  uint8_t status;
+  return read_regs(REG_STATUS, &status, 1) && !(status & STATUS_MEASURING);
+}
+
+bool Forced::read(Reading &out) {
+  if (!present_) return false;
+  uint8_t d[8];
+  if (!read_regs(REG_DATA, d, sizeof(d))) return false;
+
+  int32_t adc_p = ((int32_t)d[0] << 12) | ((int32_t)d[1] << 4) | (d[2] >> 4);
+  int32_t adc_t = ((int32_t)d[3] << 12) | ((int32_t)d[4] << 4) | (d[5] >> 4);
+  int32_t adc_h = ((int32_t)d[6] << 8) | d[7];
+  if (adc_t == 0x80000 || adc_p == 0x80000 || adc_h == 0x8000)
+    return false; // channel skipped / no conversion yet
+
+  compensate(adc_t, adc_p, adc_h, out);
+  return true;
+}
+
+bool Forced::measure(Reading &out) {
+  if (!trigger()) return false;
+  delay(measurement_ms());
+  for (uint8_t i = 0; i < 5 && !ready(); ++i) delay(1);
+  return read(out);
+}
+
+// Integer compensation, BME280 datasheet section 4.2.3
+void Forced::compensate(int32_t adc_t, int32_t adc_p, int32_t adc_h,
+                              Reading &out) const {
+  int32_t var1 = ((((adc_t >> 3) - ((int32_t)t1_ << 1))) * t2_) >> 11;
+  int32_t var2 = (((((adc_t >> 4) - (int32_t)t1_) *
+                    ((adc_t >> 4) - (int32_t)t1_)) >> 12) * t3_) >> 14;
+  const int32_t t_fine = var1 + var2;
+  out.t_c100 = (t_fine * 5 + 128) >> 8;
+
+  int64_t p1 = (int64_t)t_fine - 128000;
+  int64_t p2 = p1 * p1 * p6_;
+  p2 += (p1 * p5_) << 17;
+  p2 += ((int64_t)p4_) << 35;
+  p1 = ((p1 * p1 * p3_) >> 8) + ((p1 * p2_) << 12);
+  p1 = ((((int64_t)1) << 47) + p1) * p1_ >> 33;
+  if (p1 == 0) {
+    out.p_pa256 = 0;
+  } else {
+    int64_t p = 1048576 - adc_p;
+    p = (((p << 31) - p2) * 3125) / p1;
+    p1 = ((int64_t)p9_ * (p >> 13) * (p >> 13)) >> 25;
+    p2 = ((int64_t)p8_ * p) >> 19;
+    out.p_pa256 = (uint32_t)(((p + p1 + p2) >> 8) + ((int64_t)p7_ << 4));
+  }
+
+  int32_t h = t_fine - 76800;
+  h = (((((adc_h << 14) - ((int32_t)h4_ << 20) - ((int32_t)h5_ * h)) +
+         16384) >> 15) *
+       (((((((h * h6_) >> 10) * (((h * (int32_t)h3_) >> 11) + 32768)) >> 10) +
+          2097152) * h2_ + 8192) >> 14));
+  h -= (((((h >> 15) * (h >> 15)) >> 7) * (int32_t)h1_) >> 4);
+  h = h < 0 ? 0 : h;
+  h = h > 419430400 ? 419430400 : h;
+  out.h_rh1024 = (uint32_t)(h >> 12);
+}
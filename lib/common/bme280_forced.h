@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include "i2c_bus.h"
+
+// BME280 in forced mode.
+//
+// The chip sleeps between measurements and converts only when trigger() is
+// called, so a sensor polled once a minute draws ~0.1 uA instead of sampling
+// continuously. All 8 data registers (0xF7..0xFE) come back in one burst
+// read, which guarantees T, P and H belong to the same conversion, and the
+// three are compensated together with the datasheet's integer routines
+// (one shared t_fine, no float on the read path).
+//
+// Built on an i2cbus::Bus, register access is queued with the other tasks'
+// transactions and the conversion wait in measure() does not hold the bus;
+// built on a TwoWire it talks to the bus directly.
+namespace bme280 {
+
+struct Reading {
+  int32_t t_c100;    // degC * 100
+  uint32_t p_pa256;  // Pa * 256 (Q24.8)
+  uint32_t h_rh1024; // %RH * 1024 (Q22.10)
+
+  float temperature() const { return t_c100 / 100.0f; }
+  float pressure_hpa() const { return p_pa256 / 25600.0f; }
+  float humidity() const { return h_rh1024 / 1024.0f; }
+};
+
+class Forced {
+public:
+  explicit Forced(TwoWire &wire = Wire) : wire_(&wire) {}
+  explicit Forced(i2cbus::Bus &bus) : bus_(&bus) {}
+
+  // Checks the chip id, reads the trimming parameters and configures x1
+  // oversampling with the IIR filter off (Bosch "weather monitoring"
+  // profile). The chip is left asleep.
+  bool begin(uint8_t addr = 0x76);
+
+  bool trigger();
+  bool ready();
+  // Worst-case conversion time at x1/x1/x1 (datasheet 9.3 ms)
+  uint32_t measurement_ms() const { return 10; }
+  bool read(Reading &out);
+  // trigger(), wait out the conversion, read()
+  bool measure(Reading &out);
+
+  bool present() const { return present_; }
+  uint8_t address() const { return addr_; }
+
+private:
+  bool write_reg(uint8_t reg, uint8_t value);
+  bool read_regs(uint8_t reg, uint8_t *buf, uint8_t len);
+  bool read_batch(const i2cbus::RegRead *reads, uint8_t count);
+  void compensate(int32_t adc_t, int32_t adc_p, int32_t adc_h,
+                  Reading &out) const;
+
+  TwoWire *wire_{nullptr};
+  i2cbus::Bus *bus_{nullptr};
+  uint8_t addr_{0x76};
+  bool present_{false};
+
+  uint16_t t1_{0};
+  int16_t t2_{0}, t3_{0};
+  uint16_t p1_{0};
+  int16_t p2_{0}, p3_{0}, p4_{0}, p5_{0}, p6_{0}, p7_{0}, p8_{0}, p9_{0};
+  uint8_t h1_{0}, h3_{0};
+  int16_t h2_{0}, h4_{0}, h5_{0};
+  int8_t h6_{0};
+};
+
+} // namespace bme280
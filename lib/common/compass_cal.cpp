@@ -0,0 +1,215 @@
+#include "compass_cal.h"
+#include "crc8.h"
+#include <Preferences.h>
+#include <math.h>
+#include <string.h>
+
+using namespace compass;
+
+namespace {
+
+const char *NVS_NAMESPACE = "compass";
+const uint32_t MIN_SAMPLES = 200;
+const double MAX_AXIS_RATIO = 2.0; // reject fits squashed beyond 2:1
+
+// Gaussian elimination with partial pivoting, solves m * x = rhs in place.
+template <int N> bool solve_linear(double m[N][N], double rhs[N], double x[N]) {
+  for (int col = 0; col < N; ++col) {
+    int pivot = col;
+    for (int r = col + 1; r < N; ++r)
+      if (fabs(m[r][col]) > fabs(m[pivot][col])) pivot = r;
+    if (fabs(m[pivot][col]) < 1e-12) return false;
+    if (pivot != col) {
+      for (int c = 0; c < N; ++c) {
+        double t = m[col][c]; m[col][c] = m[pivot][c]; m[pivot][c] = t;
+      }
+      double t = rhs[col]; rhs[col] = rhs[pivot]; rhs[pivot] = t;
+    }
+    for (int r = col + 1; r < N; ++r) {
+      double f = m[r][col] / m[col][col];
+      for (int c = col; c < N; ++c) m[r][c] -= f * m[col][c];
+      rhs[r] -= f * rhs[col];
+    }
+  }
+  for (int r = N - 1; r >= 0; --r) {
+    double s = rhs[r];
+    for (int c = r + 1; c < N; ++c) s -= m[r][c] * x[c];
+    x[r] = s / m[r][r];
+  }
+  return true;
+}
+
+// Cyclic Jacobi eigen-decomposition of a symmetric 3x3 matrix.
+// On return a holds the eigenvalues on its diagonal, v the eigenvectors
+// as columns.
+void jacobi3(double a[3][3], double v[3][3]) {
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) v[i][j] = (i == j) ? 1.0 : 0.0;
+
+  for (int sweep = 0; sweep < 32; ++sweep) {
+    double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+    if (off < 1e-15) return;
+    for (int p = 0; p < 2; ++p) {
+      for (int q = p + 1; q < 3; ++q) {
+        if (fabs(a[p][q]) < 1e-18) continue;
+        double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        double t = (theta >= 0 ? 1.0 : -1.0) /
+                   (fabs(theta) + sqrt(theta * theta + 1.0));
+        double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+        for (int k = 0; k < 3; ++k) {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < 3; ++k) {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < 3; ++k) {
+          double vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+
+void Fitter::reset() {
+  memset(ata_, 0, sizeof(ata_));
+  memset(atb_, 0, sizeof(atb_));
+  n_ = 0;
+}
+
+void Fitter::add(const Vec3 &raw) {
+  // Quadric x'Ax + 2g'x = 1 with A symmetric: 9 unknowns
+  const double x = raw.x, y = raw.y, z = raw.z;
+  const double phi[9] = {x * x,     y * y,     z * z,     2 * x * y, 2 * x * z,
+                         2 * y * z, 2 * x,     2 * y,     2 * z};
+  for (int i = 0; i < 9; ++i) {
+    atb_[i] += phi[i];
+    for (int j = i; j < 9; ++j) ata_[i][j] += phi[i] * phi[j];
+  }
+  ++n_;
+}
+
+bool Fitter::solve(Calibration &out) const {
+  if (n_ < MIN_SAMPLES) return false;
+
+  double m[9][9], rhs[9], v[9];
+  for (int i = 0; i < 9; ++i) {
+    rhs[i] = atb_[i];
+    for (int j = 0; j < 9; ++j) m[i][j] = (j >= i) ? ata_[i][j] : ata_[j][i];
+  }
+  if (!solve_linear<9>(m, rhs, v)) return false;
+
+  double A[3][3] = {{v[0], v[3], v[4]}, {v[3], v[1], v[5]}, {v[4], v[5], v[2]}};
+  double g[3] = {v[6], v[7], v[8]};
+
+  // Centre c = -A^-1 g
+  double a_copy[3][3], neg_g[3] = {-g[0], -g[1], -g[2]}, c[3];
+  memcpy(a_copy, A, sizeof(A));
+  if (!solve_linear<3>(a_copy, neg_g, c)) return false;
+
+  // (x-c)'A(x-c) = 1 + c'Ac = k  ->  M = A / k
+  double k = 1.0;
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) k += c[i] * A[i][j] * c[j];
+  if (k <= 0) return false;
+
+  double eig[3][3], vec[3][3];
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j) eig[i][j] = A[i][j] / k;
+  jacobi3(eig, vec);
+
+  double lambda[3] = {eig[0][0], eig[1][1], eig[2][2]};
+  double radius[3];
+  for (int i = 0; i < 3; ++i) {
+    if (lambda[i] <= 0) return false; // hyperboloid: not enough coverage
+    radius[i] = 1.0 / sqrt(lambda[i]);
+  }
+  double r_min = fmin(radius[0], fmin(radius[1], radius[2]));
+  double r_max = fmax(radius[0], fmax(radius[1], radius[2]));
+  if (r_max / r_min > MAX_AXIS_RATIO) return false;
+
+  // W = field * V diag(sqrt(lambda)) V' maps the ellipsoid onto a sphere of
+  // radius `field` (geometric mean of the semi-axes).
+  double field = cbrt(radius[0] * radius[1] * radius[2]);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      double s = 0;
+      for (int e = 0; e < 3; ++e) s += vec[i][e] * sqrt(lambda[e]) * vec[j][e];
+      out.soft[i][j] = (float)(field * s);
+    }
+    out.offset[i] = (float)c[i];
+  }
+  out.field = (float)field;
+
+  // Algebraic residual from the normal equations: |Pv - 1|^2 =
+  // v'(P'P)v - 2v'(P'1) + n. Each row residual is k(s^2 - 1) ~ 2k(s - 1)
+  // for a sample at relative radius s, so this converts to radial error.
+  double vtav = 0, vtb = 0;
+  for (int i = 0; i < 9; ++i) {
+    vtb += v[i] * atb_[i];
+    for (int j = 0; j < 9; ++j)
+      vtav += v[i] * ((j >= i) ? ata_[i][j] : ata_[j][i]) * v[j];
+  }
+  double rss = fmax(vtav - 2 * vtb + n_, 0.0);
+  out.rms_error = (float)(sqrt(rss / n_) / (2 * k));
+  out.version = Calibration().version;
+  return true;
+}
+
+Vec3 compass::apply(const Calibration &cal, const Vec3 &raw) {
+  const float dx = raw.x - cal.offset[0];
+  const float dy = raw.y - cal.offset[1];
+  const float dz = raw.z - cal.offset[2];
+  return {cal.soft[0][0] * dx + cal.soft[0][1] * dy + cal.soft[0][2] * dz,
+          cal.soft[1][0] * dx + cal.soft[1][1] * dy + cal.soft[1][2] * dz,
+          cal.soft[2][0] * dx + cal.soft[2][1] * dy + cal.soft[2][2] * dz};
+}
+
+float compass::tilt_heading(const Vec3 &mag, const Vec3 &accel) {
+  // Roll/pitch sines and cosines straight from the gravity vector, no trig
+  const float r = sqrtf(accel.y * accel.y + accel.z * accel.z);
+  const float g = sqrtf(accel.x * accel.x + r * r);
+  float bx = mag.x, by = mag.y;
+  if (g > 0 && r > 1e-3f * g) {
+    const float sin_roll = accel.y / r, cos_roll = accel.z / r;
+    const float sin_pitch = -accel.x / g, cos_pitch = r / g;
+    bx = mag.x * cos_pitch +
+         (mag.y * sin_roll + mag.z * cos_roll) * sin_pitch;
+    by = mag.y * cos_roll - mag.z * sin_roll;
+  }
+  float heading = atan2f(by, bx) * (180.0f / (float)M_PI);
+  if (heading < 0) heading += 360.0f;
+  return heading;
+}
+
+bool compass::load(Calibration &cal) {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, true);
+  Calibration stored;
+  size_t n = prefs.getBytes("cal", &stored, sizeof(stored));
+  uint8_t crc = prefs.getUChar("crc", 0);
+  prefs.end();
+
+  if (n != sizeof(stored) || stored.version != Calibration().version)
+    return false;
+  if (crc8_dallas((const uint8_t *)&stored, sizeof(stored)) != crc)
+    return false;
+  cal = stored;
+  return cal.valid();
+}
+
+bool compass::save(const Calibration &cal) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return false;
+  size_t n = prefs.putBytes("cal", &cal, sizeof(cal));
+  prefs.putUChar("crc", crc8_dallas((const uint8_t *)&cal, sizeof(cal)));
+  prefs.end();
+  return n == sizeof(cal);
+}
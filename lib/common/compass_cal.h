@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Magnetometer hard/soft-iron calibration and tilt-compensated heading.
+//
+// Calibration is done once from a logged rotation of the sensor (slow
+// figure-eights / full rolls): every raw sample is folded into a 9x9
+// normal-equation accumulator, so the capture needs no sample storage.
+// solve() fits a general ellipsoid and reduces it to an offset vector and a
+// 3x3 correction matrix. The per-sample hot path is then one subtract, one
+// matrix multiply and one atan2.
+namespace compass {
+
+struct Vec3 {
+  float x, y, z;
+};
+
+struct Calibration {
+  uint8_t version{1};
+  float offset[3]{0, 0, 0};                  // hard-iron, raw units (uT)
+  float soft[3][3]{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}; // soft-iron correction
+  float field{0};                            // fitted field magnitude (uT)
+  float rms_error{0};                        // RMS residual, fraction of field
+  bool valid() const { return field > 0; }
+};
+
+class Fitter {
+public:
+  void reset();
+  void add(const Vec3 &raw);
+  uint32_t count() const { return n_; }
+  // Fit an ellipsoid to the accumulated samples. Returns false when the
+  // rotation did not cover enough orientations to constrain the fit.
+  bool solve(Calibration &out) const;
+
+private:
+  double ata_[9][9]{};
+  double atb_[9]{};
+  uint32_t n_{0};
+};
+
+// Hard/soft-iron corrected field vector.
+Vec3 apply(const Calibration &cal, const Vec3 &raw);
+
+// Heading in degrees [0, 360) from a corrected field vector and the
+// accelerometer reading (sensor frame, any units). Falls back to the
+// untilted formula when the accelerometer reading is degenerate.
+float tilt_heading(const Vec3 &mag, const Vec3 &accel);
+
+// NVS persistence (Preferences namespace "compass").
+bool load(Calibration &cal);
+bool save(const Calibration &cal);
+
+} // namespace compass
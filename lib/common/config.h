@@ -6,6 +6,11 @@ struct MotionCfg { uint32_t refractory_ms=10000; };
 struct EnvCfg { uint32_t period_s=60; };
 struct SmtpCfg { String host; uint16_t port=465; String user; String app_pw; String to; };
 struct AlarmCfg { bool armed=true; uint32_t grace_period_s=30; uint32_t alert_cooldown_s=300; };
-struct AppCfg { LoraCfg lora; MotionCfg motion; EnvCfg env; SmtpCfg smtp; AlarmCfg alarm; bool chime=true; };
+struct WindCfg { bool motion_correction=true; uint32_t sample_ms=50; uint32_t report_ms=1000;
+                 bool pulse_anemometer=false; // analog 0.4-2.0 V cups unless set
+                 uint8_t pulses_per_rev=1; float ms_per_hz=1.0f; float offset_ms=0.0f;
+                 uint32_t debounce_us=2000; }; // min reed pulse spacing; 0 = hall, counted in hardware
+struct OledCfg { uint32_t idle_blank_s=300; }; // 0 = never blank
+struct AppCfg { LoraCfg lora; MotionCfg motion; EnvCfg env; SmtpCfg smtp; AlarmCfg alarm; WindCfg wind; OledCfg oled; bool chime=true; };
 
 extern AppCfg CFG; // defined in each firmware target
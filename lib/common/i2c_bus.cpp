@@ -0,0 +1,251 @@
+#include "i2c_bus.h"
+
+using namespace i2cbus;
+
+namespace {
+const uint8_t QUEUE_DEPTH = 8;      // per priority
+const uint16_t WIRE_TIMEOUT_MS = 20;
+const uint8_t RECOVER_AFTER = 3;    // failures in a row
+
+// Wire status codes (endTransmission)
+const uint8_t I2C_OK = 0;
+const uint8_t I2C_NACK_ADDR = 2;
+const uint8_t I2C_OTHER = 4;
+const uint8_t I2C_TIMEOUT = 5;
+const uint8_t JOB_FAILED = 0xFF;   // ours: a run() job returned false
+
+uint32_t ewma(uint32_t avg, uint32_t sample, uint32_t n) {
+  return n == 1 ? sample : avg - (avg >> 3) + (sample >> 3);
+}
+} // namespace
+
+bool Bus::begin(BaseType_t core, UBaseType_t task_prio) {
+  if (!wire_.begin(sda_, scl_, hz_)) return false;
+  wire_.setTimeOut(WIRE_TIMEOUT_MS);
+
+  pending_ = xSemaphoreCreateCounting(PRIO_COUNT * QUEUE_DEPTH, 0);
+  for (uint8_t p = 0; p < PRIO_COUNT; ++p)
+    queues_[p] = xQueueCreate(QUEUE_DEPTH, sizeof(Request *));
+  return xTaskCreatePinnedToCore(task, "i2c", 4096, this, task_prio, &owner_,
+                                 core) == pdPASS;
+}
+
+void Bus::label(uint8_t addr, const char *name) { stats_for(addr).name = name; }
+
+DeviceStats &Bus::stats_for(uint8_t addr) {
+  for (uint8_t i = 0; i < device_count_; ++i)
+    if (devices_[i].addr == addr) return devices_[i];
+  // Table full: share the last slot rather than fail a transaction
+  if (device_count_ == MAX_DEVICES) return devices_[MAX_DEVICES - 1];
+  DeviceStats &d = devices_[device_count_++];
+  d.addr = addr;
+  d.name = "?";
+  return d;
+}
+
+const DeviceStats *Bus::device(uint8_t addr) const {
+  for (uint8_t i = 0; i < device_count_; ++i)
+    if (devices_[i].addr == addr) return &devices_[i];
+  return nullptr;
+}
+
+bool Bus::write(uint8_t addr, const uint8_t *data, uint8_t len, Priority prio) {
+  Request req{};
+  req.kind = KIND_WRITE;
+  req.addr = addr;
+  req.data = data;
+  req.len = len;
+  return submit(req, prio);
+}
+
+bool Bus::write_reg(uint8_t addr, uint8_t reg, uint8_t value, Priority prio) {
+  const uint8_t data[] = {reg, value};
+  return write(addr, data, sizeof(data), prio);
+}
+
+bool Bus::read_regs(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len,
+                    Priority prio) {
+  const RegRead read{reg, buf, len};
+  return read_batch(addr, &read, 1, false, prio);
+}
+
+bool Bus::read_batch(uint8_t addr, const RegRead *reads, uint8_t count,
+                     bool auto_increment, Priority prio) {
+  Request req{};
+  req.kind = KIND_READ;
+  req.addr = addr;
+  req.reads = reads;
+  req.count = count;
+  req.auto_increment = auto_increment;
+  return submit(req, prio);
+}
+
+bool Bus::run(uint8_t addr, Job job, void *ctx, Priority prio) {
+  Request req{};
+  req.kind = KIND_JOB;
+  req.addr = addr;
+  req.job = job;
+  req.ctx = ctx;
+  return submit(req, prio);
+}
+
+bool Bus::submit(Request &req, Priority prio) {
+  req.queued_us = micros();
+
+  // Before begin() nothing else runs; inside a job the bus is already ours
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  if (!owner_ || self == owner_) {
+    execute(req, 0);
+    return req.ok;
+  }
+
+  req.waiter = self;
+  req.done = false;
+  Request *ptr = &req;
+  xQueueSend(queues_[prio < PRIO_COUNT ? prio : PRIO_LOW], &ptr, portMAX_DELAY);
+  xSemaphoreGive(pending_);
+  // The request lives on this stack, so wait for it however long it takes
+  while (!req.done) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  return req.ok;
+}
+
+void Bus::task(void *param) {
+  Bus *bus = static_cast<Bus *>(param);
+  for (;;) {
+    xSemaphoreTake(bus->pending_, portMAX_DELAY);
+    Request *req = nullptr;
+    for (uint8_t p = 0; p < PRIO_COUNT && !req; ++p)
+      xQueueReceive(bus->queues_[p], &req, 0);
+    if (!req) continue;
+
+    bus->execute(*req, micros() - req->queued_us);
+    TaskHandle_t waiter = req->waiter;
+    req->done = true;   // req may be gone once the waiter runs
+    xTaskNotifyGive(waiter);
+  }
+}
+
+void Bus::execute(Request &req, uint32_t wait_us) {
+  const uint32_t start = micros();
+  const uint8_t status = transfer(req);
+  const uint32_t bus_us = micros() - start;
+  req.ok = status == I2C_OK;
+
+  DeviceStats &d = stats_for(req.addr);
+  d.txns++;
+  d.bus_avg_us = ewma(d.bus_avg_us, bus_us, d.txns);
+  d.wait_avg_us = ewma(d.wait_avg_us, wait_us, d.txns);
+  if (bus_us > d.bus_max_us) d.bus_max_us = bus_us;
+  if (wait_us > d.wait_max_us) d.wait_max_us = wait_us;
+
+  if (req.ok) {
+    failures_in_row_ = 0;
+    return;
+  }
+  d.errors++;
+  // A job failing says nothing about the bus (a driver's begin() on an
+  // absent chip, say) unless it ran into the Wire timeout or left SDA low
+  if (status == JOB_FAILED) {
+    if (stuck() || bus_us >= WIRE_TIMEOUT_MS * 1000UL) recover();
+    return;
+  }
+  // A NACK from an absent device is not a bus fault on its own
+  if (status == I2C_TIMEOUT || status == I2C_OTHER || stuck() ||
+      ++failures_in_row_ >= RECOVER_AFTER) {
+    recover();
+  }
+}
+
+uint8_t Bus::transfer(Request &req) {
+  switch (req.kind) {
+  case KIND_WRITE:
+    wire_.beginTransmission(req.addr);
+    wire_.write(req.data, req.len);
+    return wire_.endTransmission();
+
+  case KIND_READ:
+    for (uint8_t i = 0; i < req.count;) {
+      // Extend the burst over registers that follow on directly
+      uint8_t reg = req.reads[i].reg;
+      uint8_t len = req.reads[i].len;
+      uint8_t j = i + 1;
+      while (req.auto_increment && j < req.count &&
+             req.reads[j].reg == reg + len && len + req.reads[j].len <= 32) {
+        len += req.reads[j].len;
+        ++j;
+      }
+
+      if (j == i + 1) {
+        uint8_t status = read_into(req.addr, reg, req.reads[i].buf, len);
+        if (status != I2C_OK) return status;
+      } else {
+        uint8_t burst[32];
+        uint8_t status = read_into(req.addr, reg, burst, len);
+        if (status != I2C_OK) return status;
+        for (uint8_t k = i, off = 0; k < j; off += req.reads[k].len, ++k)
+          memcpy(req.reads[k].buf, burst + off, req.reads[k].len);
+      }
+      i = j;
+    }
+    return I2C_OK;
+
+  case KIND_JOB:
+    return req.job(wire_, req.ctx) ? I2C_OK : JOB_FAILED;
+  }
+  return I2C_OTHER;
+}
+
+uint8_t Bus::read_into(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+  wire_.beginTransmission(addr);
+  wire_.write(reg);
+  uint8_t status = wire_.endTransmission(false); // repeated start
+  if (status != I2C_OK) return status;
+  if (wire_.requestFrom(addr, len) != len) return I2C_NACK_ADDR;
+  for (uint8_t i = 0; i < len; ++i) buf[i] = wire_.read();
+  return I2C_OK;
+}
+
+bool Bus::stuck() const { return digitalRead(sda_) == LOW; }
+
+// Clock out whatever a slave is still sending, then STOP and restart Wire
+void Bus::recover() {
+  wire_.end();
+  pinMode(sda_, INPUT_PULLUP);
+  pinMode(scl_, OUTPUT_OPEN_DRAIN);
+  digitalWrite(scl_, HIGH);
+  delayMicroseconds(5);
+  for (uint8_t i = 0; i < 9 && digitalRead(sda_) == LOW; ++i) {
+    digitalWrite(scl_, LOW);
+    delayMicroseconds(5);
+    digitalWrite(scl_, HIGH);
+    delayMicroseconds(5);
+  }
+
+  // STOP: SDA rises while SCL is high
+  pinMode(sda_, OUTPUT_OPEN_DRAIN);
+  digitalWrite(sda_, LOW);
+  delayMicroseconds(5);
+  digitalWrite(sda_, HIGH);
+  delayMicroseconds(5);
+
+  wire_.begin(sda_, scl_, hz_);
+  wire_.setTimeOut(WIRE_TIMEOUT_MS);
+  failures_in_row_ = 0;
+  recoveries_++;
+}
+
+void Bus::print_stats(Print &out) const {
+  char buf[160];
+  for (uint8_t i = 0; i < device_count_; ++i) {
+    const DeviceStats &d = devices_[i];
+    snprintf(buf, sizeof(buf),
+             "i2c %-8s 0x%02X txns=%lu err=%lu bus avg/max=%lu/%luus "
+             "wait avg/max=%lu/%luus",
+             d.name, d.addr, (unsigned long)d.txns, (unsigned long)d.errors,
+             (unsigned long)d.bus_avg_us, (unsigned long)d.bus_max_us,
+             (unsigned long)d.wait_avg_us, (unsigned long)d.wait_max_us);
+    out.println(buf);
+  }
+  snprintf(buf, sizeof(buf), "i2c recoveries=%lu", (unsigned long)recoveries_);
+  out.println(buf);
+}
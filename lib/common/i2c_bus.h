@@ -0,0 +1,115 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+
+// Shared I2C bus for firmwares where several tasks talk to devices on Wire.
+//
+// Every transaction is queued to one owner task, which runs them one at a
+// time: highest priority first, FIFO within a priority. The caller blocks
+// until its transaction is done, so the calls read like plain Wire code.
+// Calls made before begin(), or from inside a run() job, go straight to
+// the bus.
+//
+// read_batch() does several register reads from one device as a single
+// queued job (one hand-off, no other device in between), merging adjacent
+// registers into one burst on devices that auto-increment. run() hands the
+// bus to library code (Adafruit drivers) that can only talk to a TwoWire.
+//
+// A timeout, SDA held low, or three failures in a row trigger recovery
+// (a failed run() job only on the first two, since library code reports
+// an absent or unhappy device the same way as a bus fault):
+// up to nine SCL pulses to clock out a slave stuck mid-byte, a STOP, and a
+// Wire restart. Per-device transaction counts, errors, time on the bus and
+// time queued are kept for print_stats().
+namespace i2cbus {
+
+enum Priority : uint8_t { PRIO_HIGH, PRIO_NORMAL, PRIO_LOW, PRIO_COUNT };
+
+struct RegRead {
+  uint8_t reg;
+  uint8_t *buf;
+  uint8_t len;
+};
+
+// Library code run with the bus to itself; return false on failure
+typedef bool (*Job)(TwoWire &wire, void *ctx);
+
+struct DeviceStats {
+  uint8_t addr;
+  const char *name;
+  uint32_t txns;
+  uint32_t errors;
+  uint32_t bus_avg_us, bus_max_us;    // start to finish on the wire
+  uint32_t wait_avg_us, wait_max_us;  // queued behind other transactions
+};
+
+class Bus {
+public:
+  static const uint8_t MAX_DEVICES = 8;
+
+  Bus(TwoWire &wire, int sda, int scl, uint32_t hz = 400000)
+      : wire_(wire), sda_(sda), scl_(scl), hz_(hz) {}
+
+  // Starts Wire and the owner task
+  bool begin(BaseType_t core = 0, UBaseType_t task_prio = 3);
+
+  // Name a device for print_stats()
+  void label(uint8_t addr, const char *name);
+
+  bool write(uint8_t addr, const uint8_t *data, uint8_t len,
+             Priority prio = PRIO_NORMAL);
+  bool write_reg(uint8_t addr, uint8_t reg, uint8_t value,
+                 Priority prio = PRIO_NORMAL);
+  bool read_regs(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len,
+                 Priority prio = PRIO_NORMAL);
+  bool read_batch(uint8_t addr, const RegRead *reads, uint8_t count,
+                  bool auto_increment, Priority prio = PRIO_NORMAL);
+  bool run(uint8_t addr, Job job, void *ctx, Priority prio = PRIO_NORMAL);
+
+  uint32_t recoveries() const { return recoveries_; }
+  const DeviceStats *device(uint8_t addr) const;
+  void print_stats(Print &out) const;
+
+private:
+  enum Kind : uint8_t { KIND_WRITE, KIND_READ, KIND_JOB };
+
+  struct Request {
+    Kind kind;
+    uint8_t addr;
+    const uint8_t *data;  // KIND_WRITE
+    uint8_t len;
+    const RegRead *reads; // KIND_READ
+    uint8_t count;
+    bool auto_increment;
+    Job job;              // KIND_JOB
+    void *ctx;
+    TaskHandle_t waiter;
+    uint32_t queued_us;
+    volatile bool done;
+    bool ok;
+  };
+
+  static void task(void *param);
+  bool submit(Request &req, Priority prio);
+  void execute(Request &req, uint32_t wait_us);
+  uint8_t transfer(Request &req);
+  uint8_t read_into(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+  bool stuck() const;
+  void recover();
+  DeviceStats &stats_for(uint8_t addr);
+
+  TwoWire &wire_;
+  int sda_, scl_;
+  uint32_t hz_;
+
+  TaskHandle_t owner_{nullptr};
+  QueueHandle_t queues_[PRIO_COUNT]{};
+  SemaphoreHandle_t pending_{nullptr};
+
+  DeviceStats devices_[MAX_DEVICES]{};
+  uint8_t device_count_{0};
+  uint8_t failures_in_row_{0};
+  uint32_t recoveries_{0};
+};
+
+} // namespace i2cbus
@@ -0,0 +1,63 @@
+#include "mast_motion.h"
+#include <math.h>
+
+using namespace motion;
+
+namespace {
+// The field must dip at least this far out of the level plane
+const float MIN_DIP_SIN = 0.34f;  // 20 degrees
+
+float dot(const float a[3], const float b[3]) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+} // namespace
+
+void MastMotion::reset() {
+  for (uint8_t i = 0; i < 3; ++i) f0_[i] = m0_[i] = 0;
+  vx_ = vy_ = 0;
+  primed_ = false;
+  tilt_ = false;
+}
+
+// For a small rotation w, every earth-fixed vector u reads u0 + u0 x w.
+// With w level (no yaw) the field's shift across the level plane is
+// t * (m0.f0) / |f0|^2, where t = f0 x w is gravity's shift.
+bool MastMotion::gravity_shift(const float field[3], float &tx, float &ty) const {
+  const float ff = dot(f0_, f0_);
+  const float mf = dot(m0_, f0_);
+  if (ff <= 0 || mf * mf < MIN_DIP_SIN * MIN_DIP_SIN * dot(m0_, m0_) * ff) {
+    return false;
+  }
+
+  float d[3];
+  for (uint8_t i = 0; i < 3; ++i) d[i] = field[i] - m0_[i];
+  const float along = dot(d, f0_) / ff;  // drop the vertical part
+  const float k = ff / mf;
+  tx = k * (d[0] - along * f0_[0]);
+  ty = k * (d[1] - along * f0_[1]);
+  return true;
+}
+
+void MastMotion::update(const float accel[3], const float field[3], float dt) {
+  if (!primed_) {
+    // Start from the current heel/trim so the first seconds don't integrate it
+    for (uint8_t i = 0; i < 3; ++i) {
+      f0_[i] = accel[i];
+      m0_[i] = field ? field[i] : 0;
+    }
+    primed_ = true;
+    return;
+  }
+  const float alpha = dt / (tau_ + dt);
+  for (uint8_t i = 0; i < 3; ++i) {
+    f0_[i] += alpha * (accel[i] - f0_[i]);
+    if (field) m0_[i] += alpha * (field[i] - m0_[i]);
+  }
+
+  float tx = 0, ty = 0;
+  tilt_ = field && gravity_shift(field, tx, ty);
+
+  const float leak = 1.0f - alpha;
+  vx_ = leak * vx_ + (accel[0] - f0_[0] - tx) * dt;
+  vy_ = leak * vy_ + (accel[1] - f0_[1] - ty) * dt;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+// Mast-tip velocity estimate for apparent wind motion correction.
+//
+// Pitch and roll swing the masthead through the air, adding its velocity to
+// what the anemometer sees. This tracks the horizontal tip velocity in the
+// sensor frame (x forward, y athwartships, m/s) so it can be subtracted from
+// the apparent wind vector sample by sample.
+//
+// The masthead has an accelerometer and a magnetometer but no gyro. The
+// accelerometer reads the tip acceleration plus gravity, and as the mast
+// rolls and pitches gravity tips into its horizontal axes: g*sin(tilt) is
+// as large as the tip acceleration itself at wave periods. Static heel and
+// trim are the low-passed specific force f0 (and field m0). The dynamic
+// tilt comes from the field: a small rotation turns every earth-fixed
+// vector the same way in the sensor frame, so the change of the field
+// across the level plane, scaled by |f0|^2 / (m0.f0), is the change in
+// gravity's reading. Both are subtracted and the remainder goes through a
+// leaky (high-pass) integrator so bias does not drift into velocity.
+//
+// Yaw at wave frequency is not separable from tilt this way and leaks in
+// as yaw * (horizontal / vertical field). Without a field (no magnetometer,
+// or too close to the magnetic equator) only the static part is removed.
+// O(1) per sample.
+namespace motion {
+
+class MastMotion {
+public:
+  // tau_s: corner of the heel/trim low-pass and velocity leak. Must sit
+  // well above wave periods (2-8 s) so motion passes and heel does not.
+  explicit MastMotion(float tau_s = 20.0f) : tau_(tau_s) {}
+
+  // accel: specific force, m/s^2. field: calibrated magnetometer reading
+  // in the same frame (any unit), or nullptr.
+  void update(const float accel[3], const float field[3], float dt);
+  void reset();
+
+  float vx() const { return vx_; }
+  float vy() const { return vy_; }
+  bool tilt_tracked() const { return tilt_; }  // last update used the field
+
+private:
+  bool gravity_shift(const float field[3], float &tx, float &ty) const;
+
+  float tau_;
+  float f0_[3]{0, 0, 0};
+  float m0_[3]{0, 0, 0};
+  float vx_{0}, vy_{0};
+  bool primed_{false};
+  bool tilt_{false};
+};
+
+} // namespace motion
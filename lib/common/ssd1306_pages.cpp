@@ -0,0 +1,113 @@
+#include "ssd1306_pages.h"
+
+using namespace ssd1306;
+
+namespace {
+const uint8_t CTRL_CMD = 0x00;
+const uint8_t CTRL_DATA = 0x40;
+const uint8_t CMD_COLUMN_ADDR = 0x21;
+const uint8_t CMD_PAGE_ADDR = 0x22;
+const uint8_t CMD_DISPLAY_OFF = 0xAE;
+const uint8_t CMD_DISPLAY_ON = 0xAF;
+
+// Data bytes per transaction (the control byte takes one of the buffer)
+#if defined(I2C_BUFFER_LENGTH) && I2C_BUFFER_LENGTH > 32
+const uint8_t CHUNK = (I2C_BUFFER_LENGTH > 129 ? 129 : I2C_BUFFER_LENGTH) - 1;
+#else
+const uint8_t CHUNK = 31;
+#endif
+
+// Starting a new run costs a window command (address, control, 6 bytes)
+// plus another data header; a shorter gap is cheaper to resend
+const uint8_t MERGE_GAP = 10;
+
+// display(): page/column window, then 1 KB in CHUNK-sized transactions
+const uint32_t FULL_FRAME_BYTES =
+    8 + PageRenderer::WIDTH * PageRenderer::PAGES +
+    2 * ((PageRenderer::WIDTH * PageRenderer::PAGES + CHUNK - 1) / CHUNK);
+} // namespace
+
+void PageRenderer::begin() {
+  bus_.label(addr_, "ssd1306");
+  valid_ = false;
+  blanked_ = false;
+  last_wake_ = millis();
+}
+
+bool PageRenderer::command(const uint8_t *cmds, uint8_t len) {
+  uint8_t pkt[8];
+  pkt[0] = CTRL_CMD;
+  memcpy(pkt + 1, cmds, len);
+  stats_.bytes += 2 + len;
+  return bus_.write(addr_, pkt, 1 + len, i2cbus::PRIO_LOW);
+}
+
+bool PageRenderer::send_run(uint8_t page, uint8_t col0, uint8_t col1,
+                            const uint8_t *data) {
+  const uint8_t window[] = {CMD_COLUMN_ADDR, col0, col1,
+                            CMD_PAGE_ADDR, page, page};
+  if (!command(window, sizeof(window))) return false;
+
+  // The window auto-increments, so the run can span several transactions
+  uint8_t pkt[1 + CHUNK];
+  pkt[0] = CTRL_DATA;
+  for (uint16_t i = col0; i <= col1; i += CHUNK) {
+    uint8_t n = col1 + 1 - i < CHUNK ? col1 + 1 - i : CHUNK;
+    memcpy(pkt + 1, data + i, n);
+    stats_.bytes += 2 + n;
+    if (!bus_.write(addr_, pkt, 1 + n, i2cbus::PRIO_LOW)) return false;
+  }
+  stats_.runs++;
+  return true;
+}
+
+void PageRenderer::wake() {
+  last_wake_ = millis();
+  if (blanked_) {
+    const uint8_t on = CMD_DISPLAY_ON;
+    if (command(&on, 1)) blanked_ = false;
+  }
+}
+
+size_t PageRenderer::flush() {
+  stats_.frames++;
+  stats_.full_bytes += FULL_FRAME_BYTES;
+  const uint32_t before = stats_.bytes;
+
+  if (!blanked_ && idle_ms_ && millis() - last_wake_ >= idle_ms_) {
+    const uint8_t off = CMD_DISPLAY_OFF;
+    if (command(&off, 1)) {
+      blanked_ = true;
+      stats_.blanks++;
+    }
+  }
+  if (blanked_) return stats_.bytes - before;
+
+  const uint8_t *fb = display_.getBuffer();
+  for (uint8_t page = 0; page < PAGES; ++page) {
+    const uint8_t *now = fb + page * WIDTH;
+    uint8_t *was = sent_ + page * WIDTH;
+
+    int16_t start = -1, last = -1;
+    for (int16_t col = 0; col <= WIDTH; ++col) {
+      const bool changed =
+          col < WIDTH && (!valid_ || now[col] != was[col]);
+      if (changed) {
+        if (start < 0) start = col;
+        last = col;
+        continue;
+      }
+      // Close the run at the end of the page or after a long enough gap
+      if (start >= 0 && (col == WIDTH || col - last > MERGE_GAP)) {
+        if (!send_run(page, start, last, now)) {
+          valid_ = false;  // panel state unknown: resend everything next time
+          return stats_.bytes - before;
+        }
+        memcpy(was + start, now + start, last + 1 - start);
+        start = -1;
+      }
+    }
+  }
+  valid_ = true;
+  return stats_.bytes - before;
+}
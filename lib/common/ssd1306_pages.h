@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include "i2c_bus.h"
+
+// Incremental flush for a 128x64 SSD1306 on a shared I2C bus.
+//
+// Adafruit_SSD1306::display() ships the whole 1 KB framebuffer on every
+// call. PageRenderer keeps a copy of what the panel holds and, for each of
+// the eight 8-pixel-high pages, sends only the runs of columns that differ:
+// a column/page window command followed by the changed bytes. An unchanged
+// frame costs nothing on the bus. Draw with the Adafruit_SSD1306 API as
+// usual and call flush() instead of display().
+//
+// The panel is switched off when wake() has not been called for the idle
+// time and back on (RAM intact, so nothing is resent) on the next wake().
+//
+// Traffic goes through the shared i2cbus::Bus at low priority, one queued
+// transaction per command or data chunk, so sensor reads on other tasks
+// wait at most one chunk for the panel.
+namespace ssd1306 {
+
+struct Stats {
+  uint32_t frames;      // flush() calls
+  uint32_t runs;        // column runs sent
+  uint32_t bytes;       // I2C bytes including address, control and commands
+  uint32_t full_bytes;  // what display() would have sent for the same frames
+  uint32_t blanks;      // times the panel was switched off for idle
+};
+
+class PageRenderer {
+public:
+  static const uint8_t WIDTH = 128;
+  static const uint8_t PAGES = 8;
+
+  PageRenderer(Adafruit_SSD1306 &display, i2cbus::Bus &bus,
+               uint8_t addr = 0x3C)
+      : display_(display), bus_(bus), addr_(addr) {}
+
+  // Call after display.begin(); forgets the panel contents
+  void begin();
+
+  // Blank the panel after this long without wake(); 0 keeps it on
+  void set_idle_blank_ms(uint32_t ms) { idle_ms_ = ms; }
+  void wake();
+
+  // Send what changed since the last flush. Returns bytes sent. While
+  // blanked the panel is left alone and catches up on wake().
+  size_t flush();
+
+  // The next flush sends the whole frame
+  void invalidate() { valid_ = false; }
+
+  bool blanked() const { return blanked_; }
+  const Stats &stats() const { return stats_; }
+
+private:
+  bool command(const uint8_t *cmds, uint8_t len);
+  bool send_run(uint8_t page, uint8_t col0, uint8_t col1, const uint8_t *data);
+
+  Adafruit_SSD1306 &display_;
+  i2cbus::Bus &bus_;
+  uint8_t addr_;
+
+  uint8_t sent_[WIDTH * PAGES];
+  bool valid_{false};
+  bool blanked_{false};
+  uint32_t idle_ms_{0};
+  uint32_t last_wake_{0};
+  Stats stats_{};
+};
+
+} // namespace ssd1306
@@ -0,0 +1,93 @@
+#include "vane_cal.h"
+#include "crc8.h"
+#include <Preferences.h>
+
+using namespace vane;
+
+namespace {
+
+const char *NVS_NAMESPACE = "vane";
+
+// Signed shortest angular step a -> b in deg*10, (-1800, 1800]
+int32_t angle_step(uint16_t a, uint16_t b) {
+  int32_t d = ((int32_t)b - a + 3600) % 3600;
+  return d > 1800 ? d - 3600 : d;
+}
+
+// Fill lut[from..to) (codes may run past ADC_CODES and wrap) with a linear
+// ramp from angle a to angle b.
+void ramp(uint16_t *lut, uint32_t from, uint32_t to, uint16_t a, uint16_t b) {
+  const int32_t step = angle_step(a, b);
+  const uint32_t width = to - from;
+  for (uint32_t c = from; c < to; ++c) {
+    int32_t deg = a + step * (int32_t)(c - from) / (int32_t)width;
+    lut[c % ADC_CODES] = (uint16_t)((deg + 3600) % 3600);
+  }
+}
+
+} // namespace
+
+void Table::build_linear(uint16_t code_lo, uint16_t code_hi,
+                         uint16_t span_deg10) {
+  for (uint16_t c = 0; c < ADC_CODES; ++c)
+    lut_[c] = pot_deg10(c, code_lo, code_hi, span_deg10);
+}
+
+bool Table::build(Kind kind, const Point *pts, uint8_t n) {
+  if (n < 2 || n > MAX_POINTS) return false;
+
+  // Sort by ADC code (n is small)
+  Point p[MAX_POINTS];
+  for (uint8_t i = 0; i < n; ++i) {
+    Point v = pts[i];
+    uint8_t j = i;
+    for (; j > 0 && p[j - 1].code > v.code; --j) p[j] = p[j - 1];
+    p[j] = v;
+  }
+  for (uint8_t i = 1; i < n; ++i)
+    if (p[i].code == p[i - 1].code) return false; // two angles, one code
+
+  if (kind == DISCRETE) {
+    // Nearest calibrated position: switch over at the code midpoints
+    uint32_t c = 0;
+    for (uint8_t i = 0; i < n; ++i) {
+      uint32_t edge = (i + 1 < n) ? (p[i].code + p[i + 1].code + 1) / 2
+                                  : ADC_CODES;
+      for (; c < edge; ++c) lut_[c] = p[i].deg10 % 3600;
+    }
+    return true;
+  }
+
+  // Continuous pot: piecewise linear between points, then across the dead
+  // zone from the last point round to the first.
+  for (uint8_t i = 0; i + 1 < n; ++i)
+    ramp(lut_, p[i].code, p[i + 1].code, p[i].deg10, p[i + 1].deg10);
+  ramp(lut_, p[n - 1].code, p[0].code + ADC_CODES, p[n - 1].deg10,
+       p[0].deg10);
+  return true;
+}
+
+bool vane::load(Sweep &sweep) {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, true);
+  Sweep stored;
+  size_t n = prefs.getBytes("sweep", &stored, sizeof(stored));
+  uint8_t crc = prefs.getUChar("crc", 0);
+  prefs.end();
+
+  if (n != sizeof(stored) || stored.count < 2 || stored.count > MAX_POINTS)
+    return false;
+  if (crc8_dallas((const uint8_t *)&stored, sizeof(stored)) != crc)
+    return false;
+  sweep = stored;
+  return true;
+}
+
+bool vane::save(const Sweep &sweep) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) return false;
+  size_t n = prefs.putBytes("sweep", &sweep, sizeof(sweep));
+  prefs.putUChar("crc", crc8_dallas((const uint8_t *)&sweep, sizeof(sweep)));
+  prefs.end();
+  return n == sizeof(sweep);
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Wind vane ADC code -> direction lookup.
+//
+// A 4096-entry table maps every 12-bit ADC code straight to degrees*10, so a
+// read is one indexed load. The table is built at boot from either a
+// compile-time default or a calibration sweep stored in NVS: the vane is
+// stepped through known angles and the ADC code recorded at each one.
+// Continuous (potentiometer) vanes interpolate linearly between points and
+// across the dead zone where the wiper leaves the track; discrete (reed +
+// resistor ladder) vanes snap to the nearest calibrated position.
+namespace vane {
+
+const uint16_t ADC_CODES = 4096;
+const uint8_t MAX_POINTS = 32;
+
+enum Kind : uint8_t { POT = 0, DISCRETE = 1 };
+
+struct Point {
+  uint16_t code;
+  uint16_t deg10;
+};
+
+// Defaults, usable in constant expressions.
+// Linear pot spanning [code_lo, code_hi]; codes outside it are the dead zone,
+// spread evenly over the angular gap between 360 deg and the wrap to 0.
+constexpr uint16_t pot_deg10(uint16_t code, uint16_t code_lo = 0,
+                             uint16_t code_hi = ADC_CODES - 1,
+                             uint16_t span_deg10 = 3600) {
+  return code < code_lo
+             ? (uint16_t)((span_deg10 + (uint32_t)(3600 - span_deg10) *
+                                            (code + ADC_CODES - code_hi) /
+                                            (ADC_CODES - code_hi + code_lo)) %
+                          3600)
+         : code > code_hi
+             ? (uint16_t)((span_deg10 + (uint32_t)(3600 - span_deg10) *
+                                            (code - code_hi) /
+                                            (ADC_CODES - code_hi + code_lo)) %
+                          3600)
+             : (uint16_t)((uint32_t)span_deg10 * (code - code_lo) /
+                          (code_hi - code_lo ? code_hi - code_lo : 1) % 3600);
+}
+
+// ADC code for a ladder resistor read against a pull-up to the ADC reference.
+constexpr uint16_t resistor_code(uint32_t ohms, uint32_t pullup_ohms) {
+  return (uint16_t)((uint64_t)(ADC_CODES - 1) * ohms / (ohms + pullup_ohms));
+}
+
+class Table {
+public:
+  // Rebuild from calibration points (any order; angles in deg*10).
+  bool build(Kind kind, const Point *pts, uint8_t n);
+  void build_linear() { build_linear(0, ADC_CODES - 1, 3600); }
+  void build_linear(uint16_t code_lo, uint16_t code_hi, uint16_t span_deg10);
+
+  uint16_t lookup(uint16_t code) const { return lut_[code & (ADC_CODES - 1)]; }
+
+private:
+  uint16_t lut_[ADC_CODES];
+};
+
+// Code-domain hysteresis on top of a table: the reported angle only changes
+// once the ADC code moves more than `band` codes from the last accepted one,
+// which stops ladder vanes flickering between adjacent positions.
+class Reader {
+public:
+  explicit Reader(const Table &table, uint16_t band = 8)
+      : table_(table), band_(band) {}
+
+  uint16_t read(uint16_t code) {
+    uint16_t d = code > last_code_ ? code - last_code_ : last_code_ - code;
+    if (d > ADC_CODES / 2) d = ADC_CODES - d; // dead-zone wrap
+    if (!primed_ || d > band_) {
+      last_code_ = code;
+      last_deg10_ = table_.lookup(code);
+      primed_ = true;
+    }
+    return last_deg10_;
+  }
+  void set_band(uint16_t band) { band_ = band; }
+
+private:
+  const Table &table_;
+  uint16_t band_;
+  uint16_t last_code_{0};
+  uint16_t last_deg10_{0};
+  bool primed_{false};
+};
+
+// Calibration sweep, persisted to NVS (Preferences namespace "vane").
+struct Sweep {
+  Kind kind{POT};
+  uint8_t count{0};
+  Point pts[MAX_POINTS];
+
+  void reset(Kind k) { kind = k; count = 0; }
+  bool add(uint16_t code, uint16_t deg10) {
+    if (count >= MAX_POINTS) return false;
+    pts[count++] = {code, (uint16_t)(deg10 % 3600)};
+    return true;
+  }
+};
+
+bool load(Sweep &sweep);
+bool save(const Sweep &sweep);
+
+} // namespace vane
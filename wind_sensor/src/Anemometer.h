@@ -0,0 +1,218 @@
+#ifndef ANEMOMETER_H
+#define ANEMOMETER_H
+
+#include <Arduino.h>
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+
+// Frequency -> wind speed calibration. Either a linear fit
+// (speed = ms_per_hz * f + offset_ms, offset only once the cups turn) or,
+// when points are set, a piecewise-linear curve through (hz, m/s) pairs.
+struct AnemometerCurve {
+  static const uint8_t MAX_POINTS = 8;
+  float ms_per_hz = 1.0f;
+  float offset_ms = 0.0f;
+  uint8_t count = 0;
+  float hz[MAX_POINTS];
+  float ms[MAX_POINTS];
+
+  float toMs(float f) const {
+    if (f <= 0)
+      return 0;
+    if (count < 2)
+      return ms_per_hz * f + offset_ms;
+    uint8_t i = 1;
+    while (i < count - 1 && f > hz[i])
+      i++;
+    // Extrapolates past either end using the outermost segment
+    float t = (f - hz[i - 1]) / (hz[i] - hz[i - 1]);
+    float v = ms[i - 1] + t * (ms[i] - ms[i - 1]);
+    return v > 0 ? v : 0;
+  }
+};
+
+// Wind speed driver interface
+class Anemometer {
+public:
+  virtual ~Anemometer() {}
+  virtual bool begin() = 0;
+  virtual uint16_t getSpeedMms() = 0; // mm/s
+};
+
+// Analog output cups: 0.4 V (0 m/s) to 2.0 V (50 m/s)
+class AnalogAnemometer : public Anemometer {
+public:
+  static constexpr float VOLT_MIN = 0.4;
+  static constexpr float VOLT_MAX = 2.0;
+  static constexpr float SPEED_MAX_MS = 50.0;
+
+  explicit AnalogAnemometer(int pin) : pin(pin) {}
+
+  bool begin() override {
+    pinMode(pin, INPUT);
+    return true;
+  }
+
+  uint16_t getSpeedMms() override {
+    // Read voltage (average of 10 samples)
+    uint32_t sum = 0;
+    for (int i = 0; i < 10; i++) {
+      sum += analogRead(pin);
+      delay(1);
+    }
+    float voltage = (sum / 10.0) * (3.3 / 4095.0);
+
+    if (voltage <= VOLT_MIN)
+      return 0;
+
+    float speed_ms =
+        (voltage - VOLT_MIN) * (SPEED_MAX_MS / (VOLT_MAX - VOLT_MIN));
+    if (speed_ms < 0)
+      speed_ms = 0;
+
+    return (uint16_t)(speed_ms * 1000); // Convert to mm/s
+  }
+
+private:
+  int pin;
+};
+
+// Reed-switch / hall cups on a PCNT unit.
+// A hall sensor (debounce time 0) has clean edges: the counter's high limit
+// is the pulses per revolution, so the hardware counts every pulse and
+// interrupts once a revolution to timestamp it.
+// Reed contacts bounce for 0.1-1 ms on closing and again on opening, far
+// longer than the ~12.8 us the PCNT glitch filter can reject, so for them
+// the counter raises an interrupt per pulse and the ISR debounces: a pulse
+// is accepted only if it comes at least the debounce time, and a quarter of
+// the last accepted spacing, after the previous one. The proportional part
+// covers the opening bounce, which trails the accepted edge by the contact's
+// closed time and so grows with the period. Every pulses-per-rev accepted
+// pulses the revolution is timestamped.
+// Speed comes from whole revolutions over their measured period, so slow
+// cups read accurately and uneven magnets average out.
+class PulseAnemometer : public Anemometer {
+public:
+  static const uint32_t STALL_US = 5000000;  // no rev in 5 s: calm
+  static const uint16_t GLITCH_FILTER = 1023; // APB cycles (~12.8 us, max)
+
+  PulseAnemometer(int pin, pcnt_unit_t unit = PCNT_UNIT_0)
+      : pin(pin), unit(unit) {}
+
+  // Both take effect at begin()
+  void setPulsesPerRev(uint8_t ppr) { pulsesPerRev = ppr ? ppr : 1; }
+  void setDebounceUs(uint32_t us) { debounceUs = us; }
+  void setCurve(const AnemometerCurve &c) { curve = c; }
+
+  bool begin() override {
+    bool hall = debounceUs == 0;
+    pcnt_config_t cfg = {};
+    cfg.pulse_gpio_num = pin;
+    cfg.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+    cfg.channel = PCNT_CHANNEL_0;
+    cfg.unit = unit;
+    cfg.pos_mode = PCNT_COUNT_INC; // count rising edges only
+    cfg.neg_mode = PCNT_COUNT_DIS;
+    cfg.lctrl_mode = PCNT_MODE_KEEP;
+    cfg.hctrl_mode = PCNT_MODE_KEEP;
+    // Hall: interrupt once a revolution. Reed: on every pulse, to debounce.
+    cfg.counter_h_lim = hall ? pulsesPerRev : 1;
+    cfg.counter_l_lim = -1;
+    if (pcnt_unit_config(&cfg) != ESP_OK)
+      return false;
+
+    pcnt_set_filter_value(unit, GLITCH_FILTER);
+    pcnt_filter_enable(unit);
+    pcnt_event_enable(unit, PCNT_EVT_H_LIM);
+
+    pcnt_isr_service_install(0); // may already be installed: ignore
+    if (pcnt_isr_handler_add(unit, hall ? onRev : onPulse, this) != ESP_OK)
+      return false;
+
+    pcnt_counter_pause(unit);
+    pcnt_counter_clear(unit);
+    pcnt_counter_resume(unit);
+    return true;
+  }
+
+  uint16_t getSpeedMms() override {
+    portENTER_CRITICAL(&mux);
+    uint32_t revCount = revs;
+    int64_t revUs = lastRevUs;
+    portEXIT_CRITICAL(&mux);
+
+    int64_t now = esp_timer_get_time();
+
+    if (revCount != readRevs) {
+      if (readRevUs > 0 && revUs > readRevUs) {
+        revHz = (revCount - readRevs) * 1e6f / (float)(revUs - readRevUs);
+      }
+      readRevs = revCount;
+      readRevUs = revUs;
+    } else if (readRevUs == 0 || now - readRevUs > STALL_US) {
+      revHz = 0;
+    } else {
+      // No full revolution since the last one: the cups can't be turning
+      // faster than one rev in the time elapsed since
+      float bound = 1e6f / (float)(now - readRevUs);
+      if (bound < revHz)
+        revHz = bound;
+    }
+
+    return (uint16_t)(curve.toMs(revHz) * 1000);
+  }
+
+private:
+  // Hall mode: the counter just wrapped at pulsesPerRev
+  static void IRAM_ATTR onRev(void *arg) {
+    PulseAnemometer *self = (PulseAnemometer *)arg;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&self->mux);
+    self->revs++;
+    self->lastRevUs = now;
+    portEXIT_CRITICAL_ISR(&self->mux);
+  }
+
+  // Reed mode: debounce each pulse and count revolutions here
+  static void IRAM_ATTR onPulse(void *arg) {
+    PulseAnemometer *self = (PulseAnemometer *)arg;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&self->mux);
+    int64_t since = now - self->lastPulseUs;
+    int64_t lockout = self->debounceUs;
+    if (self->pulseSpacingUs / 4 > lockout)
+      lockout = self->pulseSpacingUs / 4;
+    if (self->lastPulseUs == 0 || since >= lockout) {
+      // After a stall the old spacing says nothing about the next one
+      self->pulseSpacingUs = since < STALL_US ? since : 0;
+      self->lastPulseUs = now;
+      if (++self->pulses >= self->pulsesPerRev) {
+        self->pulses = 0;
+        self->revs++;
+        self->lastRevUs = now;
+      }
+    }
+    portEXIT_CRITICAL_ISR(&self->mux);
+  }
+
+  int pin;
+  pcnt_unit_t unit;
+  uint8_t pulsesPerRev = 1;
+  uint32_t debounceUs = 2000;
+  AnemometerCurve curve;
+
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  volatile uint32_t revs = 0;
+  volatile int64_t lastRevUs = 0;
+  // onPulse only
+  uint8_t pulses = 0;
+  int64_t lastPulseUs = 0;
+  int64_t pulseSpacingUs = 0;
+
+  // Reader side (wind task only)
+  uint32_t readRevs = 0;
+  int64_t readRevUs = 0;
+  float revHz = 0;
+};
+
+#endif
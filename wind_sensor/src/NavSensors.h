@@ -1,6 +1,8 @@
 #ifndef NAV_SENSORS_H
 #define NAV_SENSORS_H
 
+#include "compass_cal.h"
+#include <Adafruit_LSM303_Accel.h>
 #include <Adafruit_LSM303_DLH_Mag.h>
 #include <Adafruit_Sensor.h>
 #include <Arduino.h>
@@ -11,18 +13,62 @@ class NavSensors {
 private:
   TinyGPSPlus gps;
   Adafruit_LSM303_DLH_Mag_Unified mag = Adafruit_LSM303_DLH_Mag_Unified(12345);
+  Adafruit_LSM303_Accel_Unified accel = Adafruit_LSM303_Accel_Unified(54321);
   HardwareSerial *gpsSerial;
 
+  compass::Calibration compassCal;
+  compass::Fitter compassFitter;
+  bool calibrating = false;
+  bool magPresent = false;
+
 public:
   void begin(HardwareSerial *serial) {
     gpsSerial = serial;
     gpsSerial->begin(9600); // Standard GPS baud
 
-    if (!mag.begin()) {
+    magPresent = mag.begin();
+    if (!magPresent) {
       Serial.println("Ooops, no LSM303 detected ... Check your wiring!");
     }
+    if (!accel.begin()) {
+      Serial.println("LSM303 accelerometer not found - heading not tilt compensated");
+    }
+
+    if (compass::load(compassCal)) {
+      Serial.printf("Compass calibration loaded (field %.1fuT, rms %.1f%%)\n",
+                    compassCal.field, compassCal.rms_error * 100);
+    } else {
+      Serial.println("No compass calibration stored - using raw magnetometer");
+    }
+  }
+
+  // Start logging a calibration rotation. Swing the sensor through slow
+  // full rolls and figure-eights; every getBoatHeading() call adds a sample.
+  void beginCompassCalibration() {
+    compassFitter.reset();
+    calibrating = true;
+  }
+
+  // Fit the logged rotation and persist it. Returns false (and keeps the
+  // previous calibration) if the rotation did not cover enough orientations.
+  bool finishCompassCalibration() {
+    calibrating = false;
+    compass::Calibration cal;
+    if (!compassFitter.solve(cal)) {
+      Serial.printf("Compass calibration failed (%u samples)\n",
+                    compassFitter.count());
+      return false;
+    }
+    compassCal = cal;
+    compass::save(compassCal);
+    Serial.printf("Compass calibrated: offset %.1f,%.1f,%.1f field %.1fuT rms %.1f%%\n",
+                  cal.offset[0], cal.offset[1], cal.offset[2], cal.field,
+                  cal.rms_error * 100);
+    return true;
   }
 
+  bool isCalibrating() const { return calibrating; }
+
   void update() {
     while (gpsSerial->available() > 0) {
       gps.encode(gpsSerial->read());
@@ -42,20 +88,44 @@ public:
   // Uses Compass for Heading (Magnetic), GPS for Course Over Ground
   // For True Wind, we usually want Heading (where bow points)
   uint16_t getBoatHeading() {
-    sensors_event_t event;
-    mag.getEvent(&event);
+    sensors_event_t magEvent, accelEvent;
+    mag.getEvent(&magEvent);
+    accel.getEvent(&accelEvent);
 
-    float Pi = 3.14159;
+    compass::Vec3 raw = {magEvent.magnetic.x, magEvent.magnetic.y,
+                         magEvent.magnetic.z};
+    if (calibrating) {
+      compassFitter.add(raw);
+    }
 
-    // Calculate the angle of the vector y,x
-    float heading = (atan2(event.magnetic.y, event.magnetic.x) * 180) / Pi;
+    // Hard/soft-iron correction, then tilt compensation from gravity
+    compass::Vec3 m = compassCal.valid() ? compass::apply(compassCal, raw) : raw;
+    compass::Vec3 g = {accelEvent.acceleration.x, accelEvent.acceleration.y,
+                       accelEvent.acceleration.z};
+    float heading = compass::tilt_heading(m, g);
 
-    // Normalize to 0-360
-    if (heading < 0) {
-      heading = 360 + heading;
-    }
+    return (uint16_t)(heading * 10) % 3600;
+  }
+
+  // Raw accelerometer reading (m/s^2) and the calibrated field, in the
+  // same sensor frame (x bow, y starboard), for masthead motion tracking.
+  // Returns false, leaving fieldOut alone, without a magnetometer.
+  bool getMotionSample(float accelOut[3], float fieldOut[3]) {
+    sensors_event_t event;
+    accel.getEvent(&event);
+    accelOut[0] = event.acceleration.x;
+    accelOut[1] = event.acceleration.y;
+    accelOut[2] = event.acceleration.z;
+    if (!magPresent)
+      return false;
 
-    return (uint16_t)(heading * 10);
+    mag.getEvent(&event);
+    compass::Vec3 raw = {event.magnetic.x, event.magnetic.y, event.magnetic.z};
+    compass::Vec3 m = compassCal.valid() ? compass::apply(compassCal, raw) : raw;
+    fieldOut[0] = m.x;
+    fieldOut[1] = m.y;
+    fieldOut[2] = m.z;
+    return true;
   }
 
   // Returns GPS COG in degrees * 10
@@ -1,60 +1,76 @@
 #ifndef WIND_SENSOR_H
 #define WIND_SENSOR_H
 
+#include "Anemometer.h"
+#include "config.h"
+#include "vane_cal.h"
 #include <Arduino.h>
 
 class WindSensor {
 public:
   // Config
-  static const int PIN_ANEMOMETER = 34; // Analog Input for Speed
+  static const int PIN_ANEMOMETER = 34; // Anemometer input (analog or pulse)
   static const int PIN_VANE = 36;       // Analog Input for Direction (Changed from 35 to avoid LoRa conflict)
 
-  // Calibration constants (based on design doc)
-  // Anemometer output: 0.4V (0 m/s) to 2.0V (50 m/s)
-  // ESP32 ADC: 0-3.3V -> 0-4095
-  static constexpr float VOLT_MIN = 0.4;
-  static constexpr float VOLT_MAX = 2.0;
-  static constexpr float SPEED_MAX_MS = 50.0;
-
-  void begin() {
+  // Select the speed driver: pulse cups are counted by PCNT (pin needs an
+  // external pull-up, GPIO34 has none), analog cups use the 0.4-2.0 V ADC
+  // driver.
+  void begin(const WindCfg &cfg) {
     analogReadResolution(12);
-    pinMode(PIN_ANEMOMETER, INPUT);
     pinMode(PIN_VANE, INPUT);
-  }
 
-  // Returns wind speed in mm/s
-  uint16_t getWindSpeed() {
-    // Read voltage (average of 10 samples)
-    uint32_t sum = 0;
-    for (int i = 0; i < 10; i++) {
-      sum += analogRead(PIN_ANEMOMETER);
-      delay(1);
+    if (cfg.pulse_anemometer) {
+      pulseAnemometer.setPulsesPerRev(cfg.pulses_per_rev);
+      pulseAnemometer.setDebounceUs(cfg.debounce_us);
+      AnemometerCurve curve;
+      curve.ms_per_hz = cfg.ms_per_hz;
+      curve.offset_ms = cfg.offset_ms;
+      pulseAnemometer.setCurve(curve);
+      anemometer = &pulseAnemometer;
+    } else {
+      anemometer = &analogAnemometer;
+    }
+    if (!anemometer->begin()) {
+      Serial.println("Anemometer init failed");
     }
-    float voltage = (sum / 10.0) * (3.3 / 4095.0);
-
-    if (voltage <= VOLT_MIN)
-      return 0;
-
-    float speed_ms =
-        (voltage - VOLT_MIN) * (SPEED_MAX_MS / (VOLT_MAX - VOLT_MIN));
-    if (speed_ms < 0)
-      speed_ms = 0;
 
-    return (uint16_t)(speed_ms * 1000); // Convert to mm/s
+    // Calibrated sweep from NVS, else a linear pot over the full ADC range
+    if (!vane::load(vaneSweep) ||
+        !vaneTable.build(vaneSweep.kind, vaneSweep.pts, vaneSweep.count)) {
+      vaneTable.build_linear();
+    }
   }
 
+  // Returns wind speed in mm/s
+  uint16_t getWindSpeed() { return anemometer->getSpeedMms(); }
+
   // Returns wind direction in degrees * 10 (0-3599)
-  uint16_t getWindDirection() {
-    // Read voltage
-    uint16_t reading = analogRead(PIN_VANE);
-    // 0-3.3V maps to 0-360 degrees
-    // ADC 0-4095 -> 0-360
-    // Simple linear mapping for now (assuming pot is linear and no dead zone)
-    // Design doc mentions 16 positions, but if it's a continuous pot:
-
-    float degrees = (reading / 4095.0) * 360.0;
-    return (uint16_t)(degrees * 10);
+  // One table load per read; the dead zone is interpolated in the table
+  uint16_t getWindDirection() { return vaneReader.read(analogRead(PIN_VANE)); }
+
+  // Vane calibration sweep: point the vane at known angles (e.g. 0 deg then
+  // 22.5 deg steps) and record each, then finish to rebuild and persist
+  void beginVaneCalibration() { vaneSweep.reset(vane::POT); }
+  bool addVanePoint(uint16_t deg10) {
+    return vaneSweep.add(analogRead(PIN_VANE), deg10);
   }
+  uint8_t vanePointCount() const { return vaneSweep.count; }
+  bool finishVaneCalibration() {
+    if (!vaneTable.build(vaneSweep.kind, vaneSweep.pts, vaneSweep.count)) {
+      Serial.println("Vane calibration failed - need distinct readings at 2+ positions");
+      return false;
+    }
+    return vane::save(vaneSweep);
+  }
+
+private:
+  AnalogAnemometer analogAnemometer{PIN_ANEMOMETER};
+  PulseAnemometer pulseAnemometer{PIN_ANEMOMETER};
+  Anemometer *anemometer = &analogAnemometer;
+
+  vane::Table vaneTable;
+  vane::Reader vaneReader{vaneTable, 4};
+  vane::Sweep vaneSweep;
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "NavSensors.h"
 #include "WindSensor.h"
 #include "config.h"
+#include "mast_motion.h"
 #include "proto.h"
 #include <Arduino.h>
 #include <RadioLib.h>
@@ -17,6 +18,7 @@ SX1276 radio =
     new Module(PIN_LORA_SS, PIN_LORA_DIO0, PIN_LORA_RST, PIN_LORA_BUSY);
 WindSensor wind;
 NavSensors nav;
+motion::MastMotion mast;
 
 static uint16_t NODE_ID = 0x05; // Wind Sensor
 static volatile uint32_t SEQ = 0;
@@ -31,7 +33,7 @@ void setup() {
   Wire.begin(4, 15); // SDA, SCL
 
   // Init sensors
-  wind.begin();
+  wind.begin(CFG.wind);
   nav.begin(&Serial1); // Assuming GPS is on Serial1, adjust pins if needed
                        // (e.g. Serial1 on pins 12,13 etc) Heltec WiFi LoRa 32
                        // V2 has Serial1? need to check pins. Default Serial1 is
@@ -49,6 +51,37 @@ void setup() {
 
 void loop() {
   nav.update(); // Poll GPS frequently in main loop or task
+
+  // Serial console: 'c' starts a compass calibration rotation, 'f' fits it.
+  // 'v' starts a vane sweep at 0 deg, 'n' records the current position and
+  // expects the next 22.5 deg step, 'w' writes the sweep. 'm' toggles
+  // masthead motion correction.
+  if (Serial.available()) {
+    char cmd = Serial.read();
+    if (cmd == 'c') {
+      Serial.println("Compass calibration: rotate sensor through all orientations, then send 'f'");
+      nav.beginCompassCalibration();
+    } else if (cmd == 'f') {
+      nav.finishCompassCalibration();
+    } else if (cmd == 'v') {
+      Serial.println("Vane calibration: point vane at 0 deg and send 'n'");
+      wind.beginVaneCalibration();
+    } else if (cmd == 'n') {
+      uint16_t deg10 = wind.vanePointCount() * 225;
+      if (wind.addVanePoint(deg10)) {
+        Serial.printf("Vane point %u.%u deg recorded\n", deg10 / 10, deg10 % 10);
+      }
+    } else if (cmd == 'w') {
+      if (wind.finishVaneCalibration()) {
+        Serial.println("Vane calibration saved");
+      }
+    } else if (cmd == 'm') {
+      CFG.wind.motion_correction = !CFG.wind.motion_correction;
+      Serial.printf("Masthead motion correction %s\n",
+                    CFG.wind.motion_correction ? "ON" : "OFF");
+    }
+  }
+
   delay(1);
 }
 
@@ -63,11 +96,53 @@ Vector toVector(float speed, float dir_deg) {
   return {speed * cos(rad), speed * sin(rad)};
 }
 
+// Sample the vane and anemometer at CFG.wind.sample_ms, subtract the
+// mast-tip velocity from each sample and vector-average over the report
+// period. Returns the averaged apparent wind vector (mm/s, bow-relative).
+Vector sample_apparent_wind() {
+  // At least one sample per report, whatever the config says
+  const uint32_t sample_ms = CFG.wind.sample_ms ? CFG.wind.sample_ms : 1;
+  const uint32_t samples =
+      CFG.wind.report_ms > sample_ms ? CFG.wind.report_ms / sample_ms : 1;
+  const float dt = sample_ms / 1000.0f;
+  Vector sum = {0, 0};
+
+  for (uint32_t i = 0; i < samples; i++) {
+    // Feed the compass fitter while a calibration is being logged (same
+    // task, so no I2C contention)
+    if (nav.isCalibrating())
+      nav.getBoatHeading();
+
+    // Gravity tipped in by roll and pitch is removed using the field
+    float accel[3], field[3];
+    bool hasField = nav.getMotionSample(accel, field);
+    mast.update(accel, hasField ? field : nullptr, dt);
+
+    Vector aw = toVector(wind.getWindSpeed(), wind.getWindDirection() / 10.0);
+    if (CFG.wind.motion_correction) {
+      // Wind "from" vector: the tip moving into the wind adds to it
+      aw.x -= mast.vx() * 1000.0f;
+      aw.y -= mast.vy() * 1000.0f;
+    }
+    sum.x += aw.x;
+    sum.y += aw.y;
+
+    vTaskDelay(pdMS_TO_TICKS(sample_ms));
+  }
+
+  return {sum.x / samples, sum.y / samples};
+}
+
 void task_wind_loop(void *) {
   for (;;) {
-    // 1. Read Raw Data
-    uint16_t aws_mms = wind.getWindSpeed();
-    uint16_t awd_deg10 = wind.getWindDirection();
+    // 1. Read Raw Data (apparent wind is motion corrected and averaged)
+    Vector v_aw_bow = sample_apparent_wind();
+    float aw_dir_bow = degrees(atan2(v_aw_bow.y, v_aw_bow.x));
+    if (aw_dir_bow < 0)
+      aw_dir_bow += 360;
+    uint16_t aws_mms =
+        (uint16_t)sqrt(v_aw_bow.x * v_aw_bow.x + v_aw_bow.y * v_aw_bow.y);
+    uint16_t awd_deg10 = (uint16_t)(aw_dir_bow * 10) % 3600;
     uint16_t bsp_mms = nav.getBoatSpeed();
     uint16_t bhd_deg10 = nav.getBoatHeading();
     uint16_t cog_deg10 =
@@ -128,8 +203,6 @@ void task_wind_loop(void *) {
     size_t n = proto::encode(buf, sizeof(buf), h, &wp, sizeof(wp));
     if (n)
       xQueueSend(q_tx, buf, 0);
-
-    vTaskDelay(pdMS_TO_TICKS(1000)); // 1Hz update
   }
 }
 